@@ -84,6 +84,7 @@ class DICEAuthenticator(DICEAuthenticatorListener,ABC):
         self._last_get_assertion_params =  None
         self._last_get_assertion_time = None
         self._last_get_assertion_idx = None
+        self._current_cid = None
         self._storage = None
         self._usbdevice = None
         self._usbhid = None
@@ -213,7 +214,8 @@ class DICEAuthenticator(DICEAuthenticatorListener,ABC):
         Returns:
             bytes: CBOR encoded response to be wrapped and sent back to the client
         """
-        if not bytes is None:
+        self._current_cid = cid
+        if not cid is None:
             self.check_get_last_assertion_cid(cid)
 
         cmd = cbor_data[:1]
@@ -292,6 +294,20 @@ class DICEAuthenticator(DICEAuthenticatorListener,ABC):
         self._last_get_assertion_params =  None
         self._last_get_assertion_time = None
         self._last_get_assertion_idx = None
+        self.end_get_assertion()
+
+    def end_get_assertion(self):
+        """Called when the current GetAssertion is cleared. A concrete authenticator
+        that prepares GetNextAssertion responses in advance should discard them.
+        """
+
+    def get_current_cid(self)->bytes:
+        """Get the channel ID of the request being processed
+
+        Returns:
+            bytes: channel id, or None if the request did not come in on a channel
+        """
+        return self._current_cid
 
     def get_last_assertion_cid(self)->bytes:
         """Get the channel ID of the currently set GetAssertion
@@ -313,7 +329,7 @@ class DICEAuthenticator(DICEAuthenticatorListener,ABC):
         """
         auth.debug("Checking last assertion Channel: %s with incoming: %s",
             self.get_last_assertion_cid(), cid)
-        if not self.get_last_assertion_cid() is None and self._last_get_assertion_cid != bytes:
+        if not self.get_last_assertion_cid() is None and self._last_get_assertion_cid != cid:
             auth.debug("Channels don't match, clearing last assertion")
             self.clear_get_last_assertion()
             return False
@@ -10,6 +10,7 @@ Structs:
  * :class:`KeyECCPoint`
  * :class:`RelyingPartyKey`
  * :class:`ECDSASig`
+ * :class:`WebAuthnStatus`
 
 Wrapper Classes:
 
@@ -51,6 +52,7 @@ Classes:
 """
 import ctypes
 import os
+from enum import IntEnum
 
 
 
@@ -106,6 +108,68 @@ class ECDSASig(ctypes.Structure):
                 ('sig_s', ByteArray)]
 
 
+class TPMError(IntEnum):
+    """Why a TPM call failed, matches Web_authn_error in
+    Web_authn_structures.h
+    """
+    OK = 0
+    BAD_PARAMETER = 1
+    AUTH_FAILED = 2
+    LOCKOUT = 3
+    KEY_NOT_LOADED = 4
+    BAD_KEY_BLOB = 5
+    TPM_BUSY = 6
+    TPM_ERROR = 7
+    TSS_ERROR = 8
+    INTERNAL_ERROR = 9
+    NOT_ALLOWED = 10
+
+class TPMStage(IntEnum):
+    """The stage of the TPM call that failed, matches Web_authn_stage in
+    Web_authn_structures.h
+    """
+    NONE = 0
+    SETUP = 1
+    FLUSH = 2
+    UNMARSHAL = 3
+    CREATE = 4
+    LOAD = 5
+    SIGN = 6
+
+class RequestContext(ctypes.Structure):
+    """Ctypes structure for the host request the TPM calls are made for,
+    the id is chosen by the host and the tag is the CTAP command
+    """
+    _fields_ = [('id', ctypes.c_uint64),
+                ('tag', ctypes.c_uint32)]
+
+class WebAuthnStatus(ctypes.Structure):
+    """Ctypes structure for the status of the last failed TPM call,
+    the error, the stage and the TPM return code split into its fields
+    """
+    _fields_ = [('error', ctypes.c_uint32),
+                ('stage', ctypes.c_uint32),
+                ('tpm_rc', ctypes.c_uint32),
+                ('rc_layer', ctypes.c_uint32),
+                ('rc_parameter', ctypes.c_uint32),
+                ('rc_handle', ctypes.c_uint32),
+                ('rc_session', ctypes.c_uint32)]
+
+    def should_retry(self)->bool:
+        """The failure was transient, the call can be retried
+        """
+        return self.error == TPMError.TPM_BUSY
+
+    def needs_reload(self)->bool:
+        """The key was not loaded, reload it and retry
+        """
+        return self.error == TPMError.KEY_NOT_LOADED
+
+    def __str__(self):
+        return "{} in stage {}, rc=0x{:x}".format(TPMError(self.error).name,
+            TPMStage(self.stage).name, self.tpm_rc)
+
+
 class DICEECDSASig():
     """Class to hold the ECDSA Signature
     Provides a function to return it to a valid ctypes
@@ -142,36 +206,92 @@ class DICEECDSASig():
 class DICEKeyPoint():
     """Holds a reference to an EC point and provides a method to encode it
     as a ctypes KeyECCPoint to be passed to C
+
+    The point can be stored in SEC1 compressed form (set STORE_COMPRESSED),
+    in which case a point loaded from storage is only decompressed when x_point
+    or y_point is first used.
     """
+    STORE_COMPRESSED = False
+    COORD_SIZE = 32
+
     def __init__(self, point:KeyECCPoint, empty=False):
+        self._x_point = None
+        self._y_point = None
+        self._compressed = None
         if empty:
             return
-        self.x_point = bytes(ctypes.string_at(point.x_coord.data,
+        self._x_point = bytes(ctypes.string_at(point.x_coord.data,
             ctypes.sizeof(ctypes.c_byte) * point.x_coord.size))
-        self.y_point = bytes(ctypes.string_at(point.y_coord.data,
+        self._y_point = bytes(ctypes.string_at(point.y_coord.data,
             ctypes.sizeof(ctypes.c_byte) * point.y_coord.size))
 
+    @property
+    def x_point(self)->bytes:
+        if self._x_point is None:
+            self._decompress()
+        return self._x_point
+
+    @x_point.setter
+    def x_point(self, value:bytes):
+        self._x_point = value
+
+    @property
+    def y_point(self)->bytes:
+        if self._y_point is None:
+            self._decompress()
+        return self._y_point
+
+    @y_point.setter
+    def y_point(self, value:bytes):
+        self._y_point = value
+
+    def _decompress(self):
+        public_key = EllipticCurvePublicKey.from_encoded_point(ec.SECP256R1(),
+            self._compressed)
+        numbers = public_key.public_numbers()
+        self._x_point = numbers.x.to_bytes(DICEKeyPoint.COORD_SIZE, "big")
+        self._y_point = numbers.y.to_bytes(DICEKeyPoint.COORD_SIZE, "big")
+
+    def get_compressed(self)->bytes:
+        """Gets the point in SEC1 compressed form, 02 or 03 (the parity of y)
+        followed by x
+
+        Returns:
+            bytes: compressed point
+        """
+        if self._compressed is None:
+            prefix = 3 if self.y_point[-1] & 1 else 2
+            self._compressed = bytes([prefix]) + \
+                self.x_point.rjust(DICEKeyPoint.COORD_SIZE, b"\x00")
+        return self._compressed
+
     def as_json(self)->dict:
         """Generates a JSON compatible dictionary for storing
 
         Returns:
-            dict: dictionary contain x and y
+            dict: dictionary contain x and y, or the compressed point
         """
         out = {}
-        out["x"] = self.x_point.hex()
-        out["y"] = self.y_point.hex()
+        if DICEKeyPoint.STORE_COMPRESSED:
+            out["compressed"] = self.get_compressed().hex()
+        else:
+            out["x"] = self.x_point.hex()
+            out["y"] = self.y_point.hex()
         return out
 
     @classmethod
     def from_json(cls, load:dict)->'DICEKeyPoint':
-        """Creates an instace from JSON
+        """Creates an instace from JSON, either form of the point is accepted
 
         Returns:
             DICEKeyPoint: new instance from JSON
         """
         new_key_point = DICEKeyPoint(None,True)
-        new_key_point.x_point = bytes.fromhex(load["x"])
-        new_key_point.y_point = bytes.fromhex(load["y"])
+        if "compressed" in load:
+            new_key_point._compressed = bytes.fromhex(load["compressed"])
+        else:
+            new_key_point.x_point = bytes.fromhex(load["x"])
+            new_key_point.y_point = bytes.fromhex(load["y"])
         return new_key_point
 
     def get_as_key_ec_point_struct(self)->KeyECCPoint:
@@ -307,10 +427,12 @@ class TPMException(Exception):
 
     Attributes:
         message -- explanation of the error
+        status -- the WebAuthnStatus of the failed call, or None
     """
 
-    def __init__(self, message="Incorrect transaction state"):
+    def __init__(self, message="Incorrect transaction state", status:WebAuthnStatus=None):
         self.message = message
+        self.status = status
         super().__init__(self.message)
 class TPM():
     """A class for communicating with a TPM to perform the necessary crypto
@@ -318,6 +440,8 @@ class TPM():
     set and that the TPM can be communicated with.
     """
     LIB_PATH = "./tpm/lib/libwatpm.so"
+    # Number of times a call is retried when the TPM reports a transient failure
+    MAX_RETRIES = 2
     def __init__(self):
         """Initialises the TPM wrapper and loads the shared library.
 
@@ -357,6 +481,15 @@ class TPM():
 
         #Get Last Error
         self._tpm.get_last_error.restype = ctypes.POINTER(ctypes.c_char)
+        self._tpm.get_last_error.argtypes = [ctypes.c_void_p]
+
+        #Get Last Status
+        self._tpm.get_last_status.restype = ctypes.c_uint32
+        self._tpm.get_last_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(WebAuthnStatus)]
+
+        #Set the request the calls on this thread are made for
+        self._tpm.set_request_context.restype = ctypes.c_uint32
+        self._tpm.set_request_context.argtypes = [ctypes.c_void_p, ctypes.POINTER(RequestContext)]
 
         #create and load user key
         self._tpm.create_and_load_user_key.restype = KeyData
@@ -381,6 +514,16 @@ class TPM():
         self._tpm.sign_using_rp_key.argtypes = [ctypes.c_void_p,
             ByteArrayStr,ByteArray,ByteArrayStr]
 
+        #Sign the credentials for a getAssertion
+        self._tpm.begin_assertions.restype = ECDSASig
+        self._tpm.begin_assertions.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint32,
+            ctypes.POINTER(KeyData), ctypes.POINTER(ByteArrayStr), ctypes.POINTER(ByteArray),
+            ByteArrayStr]
+        self._tpm.next_assertion.restype = ECDSASig
+        self._tpm.next_assertion.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+        self._tpm.end_assertions.restype = ctypes.c_int
+        self._tpm.end_assertions.argtypes = [ctypes.c_void_p]
+
         #Flush data
         self._tpm.flush_data.restype = ctypes.c_int
         self._tpm.flush_data.argtypes = [ctypes.c_void_p]
@@ -446,9 +589,43 @@ class TPM():
             TPMException: Raised if a non-zero response is received from the TPM
         """
         if response != 0:
-            self._check_started()
-            error_string = self.get_last_error()
-            raise TPMException("Error running TPM command: " + str(error_string))
+            self._raise_error()
+
+    def _raise_error(self):
+        """Raises a TPMException for the last failed call, with its status
+
+        Raises:
+            TPMException: always
+        """
+        self._check_started()
+        status = self.get_last_status()
+        error_string = self.get_last_error()
+        raise TPMException("Error running TPM command: " + str(error_string), status)
+
+    def _call_with_retry(self, call, failed):
+        """Makes a TPM call, retrying if it fails with a transient error.
+        The decision uses the status, not the error message.
+
+        Args:
+            call: the call to make
+            failed: returns True if the call's result shows it failed
+
+        Returns:
+            the result of the call
+
+        Raises:
+            TPMException: Raised if the call fails and should not be retried
+        """
+        for _ in range(TPM.MAX_RETRIES):
+            result = call()
+            if not failed(result):
+                return result
+            if not self.get_last_status().should_retry():
+                self._raise_error()
+        result = call()
+        if failed(result):
+            self._raise_error()
+        return result
 
 
     #def setup_tpm(self, simulator:bool,data_dir:str, log_file:str)->int:
@@ -458,6 +635,17 @@ class TPM():
         if not self.tpm_started:
             raise TPMException("TPM not started, you must call start_up_tpm first")
 
+    def get_last_status(self)->WebAuthnStatus:
+        """Gets the status of the last failed call
+
+        Returns:
+            WebAuthnStatus: error is TPMError.OK if no call has failed
+        """
+        status = WebAuthnStatus()
+        if self._tpm.get_last_status(self._tpm_ptr, ctypes.byref(status)) != 0:
+            raise TPMException("Unable to get the TPM status")
+        return status
+
     def get_last_error(self)->str:
         """Gets the last error
 
@@ -484,8 +672,10 @@ class TPM():
         self._check_started()
         username_byte_array = ByteArrayStr(len(username),username.encode())
         password_byte_array = ByteArrayStr(len(pwd),pwd.encode())
-        response_value = self._tpm.create_and_load_user_key(self._tpm_ptr, username_byte_array,
-            password_byte_array)
+        response_value = self._call_with_retry(
+            lambda: self._tpm.create_and_load_user_key(self._tpm_ptr, username_byte_array,
+                password_byte_array),
+            lambda key_data: key_data.private_data.size == 0)
         return DICEKeyData(response_value,username,pwd)
 
     def load_user_key(self, user_key:DICEKeyData):
@@ -521,8 +711,10 @@ class TPM():
         relying_p = ByteArrayStr(len(relying_party),relying_party.encode())
         user_a = ByteArrayStr(len(user_auth),user_auth.encode())
         rp_key_a = ByteArrayStr(len(rp_key_auth),rp_key_auth.encode())
-        return DICERelyingPartyKey(self._tpm.create_and_load_rp_key(self._tpm_ptr,
-            relying_p,user_a,rp_key_a),relying_party,rp_key_auth)
+        response_value = self._call_with_retry(
+            lambda: self._tpm.create_and_load_rp_key(self._tpm_ptr, relying_p, user_a, rp_key_a),
+            lambda rp_key: rp_key.key_blob.private_data.size == 0)
+        return DICERelyingPartyKey(response_value,relying_party,rp_key_auth)
 
 
     def load_rp_key(self, rp_key_data:DICERelyingPartyKey, user_password:str):
@@ -537,9 +729,11 @@ class TPM():
         user_password_byte_array = ByteArrayStr(len(user_password.encode()),user_password.encode())
         relying_party_byte_array = ByteArrayStr(len(rp_key_data.username.encode()),
             rp_key_data.username.encode())
-        self._tpm.load_rp_key(self._tpm_ptr,
-            rp_key_data.rp_key.get_as_key_data_struct(),
-            relying_party_byte_array, user_password_byte_array)
+        key_data = rp_key_data.rp_key.get_as_key_data_struct()
+        self._call_with_retry(
+            lambda: self._tpm.load_rp_key(self._tpm_ptr, key_data,
+                relying_party_byte_array, user_password_byte_array),
+            lambda key_point: key_point.x_coord.size == 0)
 
 
     def sign_using_rp_key(self, relying_party:str, digest:bytes,
@@ -561,10 +755,81 @@ class TPM():
         relying_party = ByteArrayStr(len(relying_party),relying_party.encode())
         ptr_digest = ctypes.cast(digest, ctypes.POINTER(ctypes.c_byte))
         digest_to_sign = ByteArray(len(digest),ptr_digest)
-        return DICEECDSASig(self._tpm.sign_using_rp_key(self._tpm_ptr,relying_party,
-            digest_to_sign, relying_party_password))
+        return DICEECDSASig(self._call_with_retry(
+            lambda: self._tpm.sign_using_rp_key(self._tpm_ptr, relying_party,
+                digest_to_sign, relying_party_password),
+            lambda sig: sig.sig_r.size == 0))
 
 
+    def begin_assertions(self, channel:int, rp_keys:[DICERelyingPartyKey], digests:[bytes],
+            user_password:str)->DICEECDSASig:
+        """Signs the first of the credentials for a getAssertion and starts
+        signing the next in the background, ready for next_assertion. Each key
+        is loaded for its signature only, so the loaded relying party key is
+        not changed.
+
+        Args:
+            channel (int): channel the getAssertion came in on
+            rp_keys ([DICERelyingPartyKey]): relying party keys in the order
+                they will be returned
+            digests ([bytes]): SHA256 digest to sign for each key
+            user_password (str): user password
+
+        Returns:
+            DICEECDSASig: signature for the first credential
+        """
+        self._check_started()
+        count = len(rp_keys)
+        keys = (KeyData * count)(*[key.rp_key.get_as_key_data_struct() for key in rp_keys])
+        auths = (ByteArrayStr * count)(*[ByteArrayStr(len(key.password.encode()),
+            key.password.encode()) for key in rp_keys])
+        # digests holds the bytes the ByteArrays point to
+        digest_arrays = (ByteArray * count)(*[ByteArray(len(digest),
+            ctypes.cast(digest, ctypes.POINTER(ctypes.c_byte))) for digest in digests])
+        user_a = ByteArrayStr(len(user_password.encode()),user_password.encode())
+        return DICEECDSASig(self._call_with_retry(
+            lambda: self._tpm.begin_assertions(self._tpm_ptr, channel, count, keys, auths,
+                digest_arrays, user_a),
+            lambda sig: sig.sig_r.size == 0))
+
+    def next_assertion(self, channel:int)->DICEECDSASig:
+        """Gets the signature for the next credential of the getAssertion
+        started by begin_assertions. It is not retried, the getAssertion
+        has ended if it fails.
+
+        Args:
+            channel (int): channel the getNextAssertion came in on
+
+        Returns:
+            DICEECDSASig: signature for the next credential
+
+        Raises:
+            TPMException: with status error TPMError.NOT_ALLOWED if the
+                getAssertion has expired, or the channel has changed
+        """
+        self._check_started()
+        sig = self._tpm.next_assertion(self._tpm_ptr, channel)
+        if sig.sig_r.size == 0:
+            self._raise_error()
+        return DICEECDSASig(sig)
+
+    def end_assertions(self):
+        """Ends the getAssertion, discarding any signature made in advance
+        """
+        self._check_started()
+        self._check_error(self._tpm.end_assertions(self._tpm_ptr))
+
+    def set_request_context(self, request_id:int, tag:int):
+        """Tags the TPM calls made on this instance with the host's request,
+        in the TPM log and flight record, until it is set again
+
+        Args:
+            request_id (int): the request's 64 bit id, 0 for no request
+            tag (int): the operation, e.g. the CTAP command code
+        """
+        request = RequestContext(request_id, tag)
+        self._check_error(self._tpm.set_request_context(self._tpm_ptr, ctypes.byref(request)))
+
     def flush(self):
         """Flushes the TPM data
 
@@ -52,6 +52,11 @@ from crypto.crypto_provider import (AuthenticatorCryptoProvider,
 
 from crypto.tpm.ibmtpm import TPM,DICEKeyData, DICERelyingPartyKey
 
+def _sha256(msg:bytes)->bytes:
+    hash_alg = hashes.Hash(hashes.SHA256(),default_backend())
+    hash_alg.update(msg)
+    return hash_alg.finalize()
+
 class TPMECCryptoKeyPair(AuthenticatorCryptoKeyPair):
     """Creates Elliptic Curve Key Pair
     """
@@ -87,10 +92,7 @@ class TPMECCryptoPrivateKey(AuthenticatorCryptoPrivateKey):
         return self._private_key
 
     def sign(self,msg:bytes):
-        hash_alg = hashes.Hash(hashes.SHA256(),default_backend())
-        hash_alg.update(msg)
-        digest= hash_alg.finalize()
-        return self._tpm.sign_using_rp_key(self._private_key.username,digest,
+        return self._tpm.sign_using_rp_key(self._private_key.username,_sha256(msg),
             self._private_key.password).get_as_der_encoded_signature()
 
     def get_encoded(self)->bytes:
@@ -176,6 +178,39 @@ class TPMES256CryptoProvider(AuthenticatorCryptoProvider):
     def public_key_from_cose(self, cose_data:{})->TPMECCryptoPublicKey:
         return TPMECCryptoPublicKey.from_cose(cose_data)
 
+    def begin_assertions(self, channel:int, private_keys:[TPMECCryptoPrivateKey],
+            msgs:[bytes])->bytes:
+        """Signs the first message for a GetAssertion, the next is signed in
+        the background ready for next_assertion
+
+        Args:
+            channel (int): channel the GetAssertion came in on
+            private_keys ([TPMECCryptoPrivateKey]): key for each credential
+            msgs ([bytes]): message to sign for each credential
+
+        Returns:
+            bytes: DER encoded signature of the first message
+        """
+        return self._tpm.begin_assertions(channel,
+            [key.get_private_key() for key in private_keys],[_sha256(msg) for msg in msgs],
+            self._user_key_data.password).get_as_der_encoded_signature()
+
+    def next_assertion(self, channel:int)->bytes:
+        """Gets the signature of the next message for the GetAssertion
+
+        Args:
+            channel (int): channel the GetNextAssertion came in on
+
+        Returns:
+            bytes: DER encoded signature
+        """
+        return self._tpm.next_assertion(channel).get_as_der_encoded_signature()
+
+    def end_assertions(self):
+        """Ends the GetAssertion, discarding any signature made in advance
+        """
+        self._tpm.end_assertions()
+
     def shutdown(self):
         self.clean_up()
     def clean_up(self):
@@ -43,7 +43,8 @@ from cryptography.hazmat.primitives.kdf.pbkdf2 import PBKDF2HMAC
 from cryptography.hazmat.backends import default_backend
 
 from crypto.crypto_provider import AuthenticatorCryptoProvider,CRYPTO_PROVIDERS
-from crypto.tpm_es256_crypto_provider import TPMES256CryptoProvider
+from crypto.tpm_es256_crypto_provider import TPMES256CryptoProvider, TPMECCryptoPrivateKey
+from crypto.tpm.ibmtpm import TPMException
 from crypto.es256_crypto_provider import ES256CryptoProvider
 from crypto.aes_credential_wrapper import AESCredentialWrapper
 from crypto.algs import PUBLIC_KEY_ALG
@@ -102,6 +103,10 @@ class DICEKey(DICEAuthenticator,DICEAuthenticatorListener):
         self._user_verification_capable = False
 
         self._providers = []
+        self._tpm_crypto_provider = None
+        # Credentials and authenticator data for the GetAssertion being signed by the TPM
+        self._assertion_creds = None
+        self._assertion_auth_data = None
 
         self._credential_wrapper = AESCredentialWrapper()
 
@@ -226,6 +231,7 @@ class DICEKey(DICEAuthenticator,DICEAuthenticatorListener):
 
             AuthenticatorCryptoProvider.add_provider(tpm_crypto_provider)
             self._providers.append(tpm_crypto_provider.get_alg())
+            self._tpm_crypto_provider = tpm_crypto_provider
         else:
 
             crypto_provider = ES256CryptoProvider()
@@ -423,7 +429,18 @@ class DICEKey(DICEAuthenticator,DICEAuthenticatorListener):
         #   numberOfCredentials 	0x05 	unsigned integer(CBOR major type 0).
         response = {}
         response[2]=authenticator_data
-        response[3]=credential_source.get_private_key().sign(authenticator_data + params.get_hash())
+        if self._can_sign_assertions_in_advance(creds):
+            # The TPM signs the first credential now and each of the others in the
+            # background, while the previous response is being read
+            auth_data = [authenticator_data] + [
+                self._get_authenticator_data_minus_creds(cred,True) for cred in creds[1:]]
+            response[3]=self._tpm_crypto_provider.begin_assertions(self._get_channel(),
+                [cred.get_private_key() for cred in creds],
+                [data + params.get_hash() for data in auth_data])
+            self._assertion_creds = creds
+            self._assertion_auth_data = auth_data
+        else:
+            response[3]=credential_source.get_private_key().sign(authenticator_data + params.get_hash())
         credential_source.increment_signature_counter()
         response[4]=credential_source.get_user_entity()
         response[5]=number_of_credentials
@@ -436,6 +453,8 @@ class DICEKey(DICEAuthenticator,DICEAuthenticatorListener):
 
     def authenticator_get_next_assertion(self, params:AuthenticatorGetAssertionParameters,idx:int,
             keep_alive:CTAPHIDKeepAlive) -> GetAssertionResp:
+        if not self._assertion_creds is None:
+            return self._get_next_assertion_signed_in_advance(params, idx)
         creds = self._storage.get_credential_source_by_rp(params.get_rp_entity().get_id(),
             params.get_allow_list())
         #Now check for any non-resident creds
@@ -481,6 +500,44 @@ class DICEKey(DICEAuthenticator,DICEAuthenticatorListener):
         self._storage.update_credential_source(params.get_rp_id(),credential_source)
         return GetAssertionResp(response,number_of_credentials)
 
+    def _can_sign_assertions_in_advance(self, creds:[PublicKeyCredentialSource])->bool:
+        return (not self._tpm_crypto_provider is None and len(creds) > 1 and
+            all(isinstance(cred.get_private_key(), TPMECCryptoPrivateKey) for cred in creds))
+
+    def _get_channel(self)->int:
+        cid = self.get_current_cid()
+        return 0 if cid is None else int.from_bytes(cid, "big")
+
+    def _get_next_assertion_signed_in_advance(self, params:AuthenticatorGetAssertionParameters,
+            idx:int) -> GetAssertionResp:
+        number_of_credentials = len(self._assertion_creds)
+        if idx >= number_of_credentials:
+            raise DICEAuthenticatorException(ctap.constants.CTAP_STATUS_CODE.CTAP2_ERR_NOT_ALLOWED)
+        try:
+            signature = self._tpm_crypto_provider.next_assertion(self._get_channel())
+        except TPMException as exp:
+            self.end_get_assertion()
+            raise DICEAuthenticatorException(
+                ctap.constants.CTAP_STATUS_CODE.CTAP2_ERR_NOT_ALLOWED, str(exp)) from exp
+
+        credential_source = self._assertion_creds[idx]
+        response = {}
+        response[2]=self._assertion_auth_data[idx]
+        response[3]=signature
+        credential_source.increment_signature_counter()
+        response[4]=credential_source.get_user_entity()
+        response[5]=number_of_credentials
+        response[1]=credential_source.get_public_key_credential_descriptor()
+
+        self._storage.update_credential_source(params.get_rp_id(),credential_source)
+        return GetAssertionResp(response,number_of_credentials)
+
+    def end_get_assertion(self):
+        if not self._assertion_creds is None:
+            self._assertion_creds = None
+            self._assertion_auth_data = None
+            self._tpm_crypto_provider.end_assertions()
+
     def authenticator_reset(self, keep_alive:CTAPHIDKeepAlive) -> ResetResp:
         if self._storage.reset():
             return ResetResp()
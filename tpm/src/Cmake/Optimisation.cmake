@@ -0,0 +1,65 @@
+#
+# Build variants for libwatpm:
+#
+#   - gprof instrumentation (ENABLE_GPROF), kept out of production builds
+#   - link time optimisation (ENABLE_IPO), -fno-plt (ENABLE_NO_PLT) and only
+#     exporting the C API from the library (ENABLE_HIDDEN_VISIBILITY)
+#   - profile guided optimisation (PGO_MODE), see pgo_build.sh for the
+#     generate/train/use pipeline
+#
+# CMakePresets.json has presets combining these.
+#
+
+option(ENABLE_GPROF "Build with gprof instrumentation (-pg)" OFF)
+option(ENABLE_IPO "Enable interprocedural optimisation (link time optimisation)" OFF)
+option(ENABLE_NO_PLT "Call external library functions through the GOT (-fno-plt)" OFF)
+option(ENABLE_HIDDEN_VISIBILITY "Only export the C API from libwatpm" OFF)
+
+set(PGO_MODE "OFF" CACHE STRING "Profile guided optimisation: OFF, GENERATE or USE")
+set_property(CACHE PGO_MODE PROPERTY STRINGS OFF GENERATE USE)
+set(PGO_PROFILE_DIR "${CMAKE_BINARY_DIR}/pgo-profile" CACHE PATH "Directory for the PGO profile data")
+
+# Must be called before the targets are created, so that IPO is picked up
+function(enable_optimisations project_name)
+  if(ENABLE_IPO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT ipo_ok OUTPUT ipo_output)
+    if(ipo_ok)
+      set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON PARENT_SCOPE)
+    else()
+      message(SEND_ERROR "IPO is not supported: ${ipo_output}")
+    endif()
+  endif()
+
+  if(ENABLE_GPROF)
+    target_compile_options(${project_name} INTERFACE -pg)
+    target_link_options(${project_name} INTERFACE -pg)
+  endif()
+
+  if(ENABLE_NO_PLT)
+    target_compile_options(${project_name} INTERFACE -fno-plt)
+  endif()
+
+  if(PGO_MODE STREQUAL "GENERATE")
+    target_compile_options(${project_name} INTERFACE -fprofile-generate=${PGO_PROFILE_DIR} -fprofile-update=atomic)
+    target_link_options(${project_name} INTERFACE -fprofile-generate=${PGO_PROFILE_DIR})
+  elseif(PGO_MODE STREQUAL "USE")
+    if(NOT EXISTS ${PGO_PROFILE_DIR})
+      message(SEND_ERROR "PGO_MODE=USE but there is no profile data in ${PGO_PROFILE_DIR}")
+    endif()
+    # Code not run during training has no profile, that is expected
+    target_compile_options(${project_name} INTERFACE -fprofile-use=${PGO_PROFILE_DIR} -fprofile-correction -Wno-missing-profile)
+  elseif(NOT PGO_MODE STREQUAL "OFF")
+    message(SEND_ERROR "Invalid PGO_MODE: ${PGO_MODE}, should be OFF, GENERATE or USE")
+  endif()
+endfunction()
+
+function(set_library_visibility library_name)
+  if(ENABLE_HIDDEN_VISIBILITY)
+    set_target_properties(${library_name} PROPERTIES
+      CXX_VISIBILITY_PRESET hidden
+      VISIBILITY_INLINES_HIDDEN ON)
+    # The static utilities are linked into the library, hide them too
+    target_link_options(${library_name} PRIVATE -Wl,--exclude-libs,ALL)
+  endif()
+endfunction()
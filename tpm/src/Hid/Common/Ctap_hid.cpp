@@ -0,0 +1,87 @@
+/*******************************************************************************
+* File:        Ctap_hid.cpp
+* Description: CTAPHID framing, the reports sent over the HID gadget device
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "Ctap_hid.h"
+
+namespace Ctap_hid
+{
+namespace
+{
+void set_channel(Report &report, uint32_t channel)
+{
+    report[0] = static_cast<Byte>(channel >> 24);
+    report[1] = static_cast<Byte>(channel >> 16);
+    report[2] = static_cast<Byte>(channel >> 8);
+    report[3] = static_cast<Byte>(channel);
+}
+}// namespace
+
+std::vector<Report> fragment_message(uint32_t channel, uint8_t command, Byte_buffer const &payload)
+{
+    std::size_t size = payload.size();
+    if (size > max_payload_size) {
+        throw(std::runtime_error("CTAPHID message too long"));
+    }
+    std::vector<Report> reports;
+    reports.reserve(size <= init_data_size ? 1 : 1 + (size - init_data_size + cont_data_size - 1) / cont_data_size);
+
+    Report report{};
+    set_channel(report, channel);
+    report[4] = static_cast<Byte>(command | init_bit);
+    report[5] = static_cast<Byte>(size >> 8);
+    report[6] = static_cast<Byte>(size);
+    std::size_t sent = std::min(size, init_data_size);
+    std::copy_n(payload.cdata(), sent, report.begin() + 7);
+    reports.push_back(report);
+
+    for (uint8_t sequence = 0; sent < size; ++sequence) {
+        report.fill(0);
+        set_channel(report, channel);
+        report[4] = sequence;
+        std::size_t part = std::min(size - sent, cont_data_size);
+        std::copy_n(payload.cdata() + sent, part, report.begin() + 5);
+        reports.push_back(report);
+        sent += part;
+    }
+    return reports;
+}
+
+}// namespace Ctap_hid
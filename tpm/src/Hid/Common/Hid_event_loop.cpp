@@ -0,0 +1,399 @@
+/*******************************************************************************
+* File:        Hid_event_loop.cpp
+* Description: Single threaded epoll loop for the CTAPHID device
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "Hid_event_loop.h"
+
+namespace
+{
+void set_non_blocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        throw(std::system_error(errno, std::generic_category(), "fcntl"));
+    }
+}
+
+void add_to_epoll(int epoll_fd, int fd, uint32_t events)
+{
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        throw(std::system_error(errno, std::generic_category(), "epoll_ctl"));
+    }
+}
+}// namespace
+
+Hid_event_loop::Hid_event_loop(int read_fd, int write_fd, Request_handler handler, Settings settings)
+  : read_fd_(read_fd), write_fd_(write_fd), handler_(std::move(handler)), settings_(settings),
+    transaction_timer_([this]() { transaction_timed_out(); }), keep_alive_timer_([this]() { send_keep_alive(); })
+{
+    set_non_blocking(read_fd_);
+    if (write_fd_ != read_fd_) {
+        set_non_blocking(write_fd_);
+    }
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1) {
+        throw(std::system_error(errno, std::generic_category(), "epoll_create1"));
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ == -1) {
+        int error = errno;
+        close(epoll_fd_);
+        throw(std::system_error(error, std::generic_category(), "eventfd"));
+    }
+    try {
+        add_to_epoll(epoll_fd_, wake_fd_, EPOLLIN);
+        add_to_epoll(epoll_fd_, read_fd_, EPOLLIN);
+        if (write_fd_ != read_fd_) {
+            // Only watched while a write is waiting for the device
+            add_to_epoll(epoll_fd_, write_fd_, 0);
+        }
+    } catch (...) {
+        close(wake_fd_);
+        close(epoll_fd_);
+        throw;
+    }
+}
+
+Hid_event_loop::~Hid_event_loop()
+{
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+void Hid_event_loop::run()
+{
+    stop_ = false;
+    while (!stop_ && !device_closed_) {
+        run_once(std::chrono::minutes(1));
+    }
+}
+
+void Hid_event_loop::stop()
+{
+    stop_ = true;
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+void Hid_event_loop::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+int Hid_event_loop::wait_ms(std::chrono::milliseconds limit) const
+{
+    auto now = Clock::now();
+    auto until = now + limit;
+    if (auto next = timers_.next_expiry()) {
+        until = std::min(until, *next);
+    }
+    if (until <= now) {
+        return 0;
+    }
+    // Round up, so the loop does not wake just before the deadline
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(until - now).count());
+}
+
+void Hid_event_loop::run_once(std::chrono::milliseconds timeout)
+{
+    constexpr int max_events = 4;
+    epoll_event events[max_events];
+    int n = epoll_wait(epoll_fd_, events, max_events, wait_ms(timeout));
+    if (n == -1 && errno != EINTR) {
+        throw(std::system_error(errno, std::generic_category(), "epoll_wait"));
+    }
+    for (int i = 0; i < n; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == wake_fd_) {
+            uint64_t count;
+            (void)!read(wake_fd_, &count, sizeof(count));
+            run_tasks();
+            continue;
+        }
+        if (fd == read_fd_ && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+            read_device();
+        }
+        if (fd == write_fd_ && (events[i].events & (EPOLLOUT | EPOLLERR)) != 0 && waiting_to_write_) {
+            write_device();
+        }
+    }
+    timers_.advance(Clock::now());
+}
+
+void Hid_event_loop::run_tasks()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex_);
+        tasks.swap(tasks_);
+    }
+    for (auto &task : tasks) {
+        task();
+    }
+}
+
+void Hid_event_loop::read_device()
+{
+    Byte buffer[Ctap_hid::report_size * 8];
+    while (!device_closed_) {
+        ssize_t n = read(read_fd_, buffer, sizeof(buffer));
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                device_closed_ = true;
+                device_error_ = errno;
+            }
+            return;
+        }
+        if (n == 0) {
+            device_closed_ = true;
+            return;
+        }
+        for (Byte const *p = buffer; p < buffer + n;) {
+            std::size_t part = std::min(static_cast<std::size_t>(buffer + n - p), Ctap_hid::report_size - in_size_);
+            std::copy_n(p, part, in_.begin() + static_cast<std::ptrdiff_t>(in_size_));
+            in_size_ += part;
+            p += part;
+            if (in_size_ == Ctap_hid::report_size) {
+                in_size_ = 0;
+                handle_report(in_);
+            }
+        }
+    }
+}
+
+void Hid_event_loop::handle_report(Ctap_hid::Report const &report)
+{
+    if (Ctap_hid::is_init_report(report)) {
+        handle_init_report(report);
+        return;
+    }
+    // Continuation reports that are not part of the request being received are ignored
+    uint32_t channel = Ctap_hid::report_channel(report);
+    if (!receiving_ || channel != channel_) {
+        return;
+    }
+    if (Ctap_hid::report_sequence(report) != next_sequence_) {
+        receiving_ = false;
+        transaction_timer_.cancel();
+        send_error(channel, Ctap_hid::err_invalid_seq);
+        return;
+    }
+    ++next_sequence_;
+    std::size_t part = std::min(length_ - payload_.size(), Ctap_hid::cont_data_size);
+    payload_ += Byte_buffer(report.data() + 5, part);
+    timers_.arm(transaction_timer_, settings_.transaction_timeout);
+    if (payload_.size() == length_) {
+        dispatch();
+    }
+}
+
+void Hid_event_loop::handle_init_report(Ctap_hid::Report const &report)
+{
+    uint32_t channel = Ctap_hid::report_channel(report);
+    uint8_t command = Ctap_hid::report_command(report);
+    std::size_t length = Ctap_hid::report_length(report);
+
+    if (busy_) {
+        // Only a cancel, for the request being processed, gets through
+        if (channel == busy_channel_ && command == Ctap_hid::cmd_cancel) {
+            handler_(Request{ channel, command, Byte_buffer() });
+        } else {
+            send_error(channel, Ctap_hid::err_channel_busy);
+        }
+        return;
+    }
+    if (receiving_ && channel != channel_) {
+        send_error(channel, Ctap_hid::err_channel_busy);
+        return;
+    }
+    if (receiving_ && command != Ctap_hid::cmd_init) {
+        // A new request on the same channel before the last one is complete, only INIT resynchronises
+        receiving_ = false;
+        transaction_timer_.cancel();
+        send_error(channel, Ctap_hid::err_invalid_seq);
+        return;
+    }
+    if (length > Ctap_hid::max_payload_size) {
+        receiving_ = false;
+        transaction_timer_.cancel();
+        send_error(channel, Ctap_hid::err_invalid_len);
+        return;
+    }
+    receiving_ = true;
+    channel_ = channel;
+    command_ = command;
+    length_ = length;
+    next_sequence_ = 0;
+    payload_ = Byte_buffer(report.data() + 7, std::min(length, Ctap_hid::init_data_size));
+    timers_.arm(transaction_timer_, settings_.transaction_timeout);
+    if (payload_.size() == length_) {
+        dispatch();
+    }
+}
+
+void Hid_event_loop::dispatch()
+{
+    receiving_ = false;
+    transaction_timer_.cancel();
+    busy_ = true;
+    busy_channel_ = channel_;
+    keep_alive_status_ = Ctap_hid::status_processing;
+    Request request{ channel_, command_, std::move(payload_) };
+    payload_ = Byte_buffer();
+    try {
+        handler_(request);
+    } catch (std::exception const &) {
+        if (busy_ && busy_channel_ == request.channel) {
+            send_error(request.channel, Ctap_hid::err_other);
+        }
+        return;
+    }
+    if (busy_ && busy_channel_ == request.channel) {
+        // Still being processed, tell the host
+        keep_alive_end_ = Clock::now() + settings_.keep_alive_limit;
+        timers_.arm(keep_alive_timer_, settings_.keep_alive_interval);
+    }
+}
+
+void Hid_event_loop::send_response(uint32_t channel, uint8_t command, Byte_buffer const &payload)
+{
+    if (busy_ && channel == busy_channel_) {
+        busy_ = false;
+        keep_alive_timer_.cancel();
+    }
+    queue_message(channel, command, payload);
+}
+
+void Hid_event_loop::send_error(uint32_t channel, uint8_t error)
+{
+    send_response(channel, Ctap_hid::cmd_error, Byte_buffer{ error });
+}
+
+void Hid_event_loop::set_keep_alive_status(uint8_t status)
+{
+    keep_alive_status_ = status;
+}
+
+void Hid_event_loop::queue_message(uint32_t channel, uint8_t command, Byte_buffer const &payload)
+{
+    auto reports = Ctap_hid::fragment_message(channel, command, payload);
+    out_.insert(out_.end(), reports.begin(), reports.end());
+    if (!waiting_to_write_) {
+        write_device();
+    }
+}
+
+void Hid_event_loop::write_device()
+{
+    while (!out_.empty() && !device_closed_) {
+        auto const &report = out_.front();
+        ssize_t n = write(write_fd_, report.data() + out_offset_, report.size() - out_offset_);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                watch_writes(true);
+            } else {
+                device_closed_ = true;
+                device_error_ = errno;
+            }
+            return;
+        }
+        out_offset_ += static_cast<std::size_t>(n);
+        if (out_offset_ == report.size()) {
+            out_offset_ = 0;
+            out_.pop_front();
+        }
+    }
+    watch_writes(false);
+}
+
+void Hid_event_loop::watch_writes(bool watch)
+{
+    if (watch == waiting_to_write_) {
+        return;
+    }
+    waiting_to_write_ = watch;
+    epoll_event ev{};
+    ev.data.fd = write_fd_;
+    if (write_fd_ == read_fd_) {
+        ev.events = EPOLLIN | (watch ? EPOLLOUT : 0u);
+    } else {
+        ev.events = watch ? EPOLLOUT : 0u;
+    }
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, write_fd_, &ev) == -1) {
+        throw(std::system_error(errno, std::generic_category(), "epoll_ctl"));
+    }
+}
+
+void Hid_event_loop::transaction_timed_out()
+{
+    receiving_ = false;
+    send_error(channel_, Ctap_hid::err_msg_timeout);
+}
+
+void Hid_event_loop::send_keep_alive()
+{
+    if (Clock::now() >= keep_alive_end_) {
+        return;
+    }
+    // Skip a keep-alive rather than queue them behind a slow device
+    if (out_.empty()) {
+        queue_message(busy_channel_, Ctap_hid::cmd_keepalive, Byte_buffer{ keep_alive_status_ });
+    }
+    timers_.arm(keep_alive_timer_, settings_.keep_alive_interval);
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+* File:        Ctap_hid.h
+* Description: CTAPHID framing, the reports sent over the HID gadget device
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Byte_buffer.h"
+
+// CTAPHID (see the CTAP 2 specification, section 11.2) sends each message as
+// an initialisation report followed by up to 128 continuation reports:
+//
+//  initialisation  | channel (4) | command | 0x80 (1) | length (2) | data (57) |
+//  continuation    | channel (4) | sequence (1) | data (59) |
+//
+namespace Ctap_hid
+{
+constexpr std::size_t report_size{ 64 };
+constexpr std::size_t init_data_size{ report_size - 7 };
+constexpr std::size_t cont_data_size{ report_size - 5 };
+constexpr std::size_t max_sequence{ 0x80 };
+constexpr std::size_t max_payload_size{ init_data_size + max_sequence * cont_data_size };
+
+constexpr uint8_t init_bit{ 0x80 };
+constexpr uint32_t broadcast_channel{ 0xffffffff };
+
+// Commands
+constexpr uint8_t cmd_ping{ 0x01 };
+constexpr uint8_t cmd_msg{ 0x03 };
+constexpr uint8_t cmd_lock{ 0x04 };
+constexpr uint8_t cmd_init{ 0x06 };
+constexpr uint8_t cmd_wink{ 0x08 };
+constexpr uint8_t cmd_cbor{ 0x10 };
+constexpr uint8_t cmd_cancel{ 0x11 };
+constexpr uint8_t cmd_keepalive{ 0x3b };
+constexpr uint8_t cmd_error{ 0x3f };
+
+// Keep-alive status
+constexpr uint8_t status_processing{ 0x01 };
+constexpr uint8_t status_upneeded{ 0x02 };
+
+// Errors
+constexpr uint8_t err_invalid_cmd{ 0x01 };
+constexpr uint8_t err_invalid_par{ 0x02 };
+constexpr uint8_t err_invalid_len{ 0x03 };
+constexpr uint8_t err_invalid_seq{ 0x04 };
+constexpr uint8_t err_msg_timeout{ 0x05 };
+constexpr uint8_t err_channel_busy{ 0x06 };
+constexpr uint8_t err_invalid_channel{ 0x0b };
+constexpr uint8_t err_other{ 0x7f };
+
+using Report = std::array<Byte, report_size>;
+
+inline uint32_t report_channel(Report const &report)
+{
+    return static_cast<uint32_t>(report[0]) << 24 | static_cast<uint32_t>(report[1]) << 16
+           | static_cast<uint32_t>(report[2]) << 8 | report[3];
+}
+
+inline bool is_init_report(Report const &report) { return (report[4] & init_bit) != 0; }
+
+// Only valid for an initialisation report
+inline uint8_t report_command(Report const &report) { return static_cast<uint8_t>(report[4] & ~init_bit); }
+inline std::size_t report_length(Report const &report) { return static_cast<std::size_t>(report[5]) << 8 | report[6]; }
+
+// Only valid for a continuation report
+inline uint8_t report_sequence(Report const &report) { return report[4]; }
+
+/**
+ * Splits a message into its reports, the last report is padded with zeros.
+ * The payload must be no longer than max_payload_size.
+ */
+std::vector<Report> fragment_message(uint32_t channel, uint8_t command, Byte_buffer const &payload);
+
+}// namespace Ctap_hid
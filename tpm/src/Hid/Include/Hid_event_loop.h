@@ -0,0 +1,186 @@
+/*******************************************************************************
+* File:        Hid_event_loop.h
+* Description: Single threaded epoll loop for the CTAPHID device
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "Byte_buffer.h"
+#include "Ctap_hid.h"
+#include "Timer_wheel.h"
+
+/**
+ * Owns the HID device (/dev/hidg<n>, or a uhid device) with epoll on a single thread. It reads the
+ * reports, reassembles the CTAPHID messages and hands each complete request to the request handler.
+ * Responses are split into reports and written as the device accepts them. While a request is being
+ * processed the loop sends keep-alives on its channel, answers other channels with ERR_CHANNEL_BUSY and
+ * times out requests whose continuation reports stop arriving. Its timers, and any the host arms on
+ * timers(), e.g. per channel timeouts, share one timer wheel, so they cost no thread or allocation each.
+ *
+ * The handler runs on the loop's thread. It can respond before it returns, or hand the work to another
+ * thread which posts the response back to the loop with post(). Apart from stop() and post() the member
+ * functions must only be called on the loop's thread.
+ *
+ * The descriptors are not owned by the loop, they are made non-blocking. Reading and writing can use
+ * different descriptors, so a pair of pipes, or a socketpair, can stand in for the device.
+ *
+ * There is no binding for the Python authenticator yet, it still uses the threads in hid/usb.py.
+ */
+class Hid_event_loop
+{
+  public:
+    using Clock = Timer_wheel::Clock;
+
+    struct Request
+    {
+        uint32_t channel;
+        uint8_t command;
+        Byte_buffer payload;
+    };
+
+    using Request_handler = std::function<void(Request const &)>;
+
+    struct Settings
+    {
+        // The longest wait for the next report of a request
+        std::chrono::milliseconds transaction_timeout{ 500 };
+        std::chrono::milliseconds keep_alive_interval{ 100 };
+        // Keep-alives stop after this long, the host will have given up
+        std::chrono::milliseconds keep_alive_limit{ std::chrono::minutes(2) };
+    };
+
+    Hid_event_loop(int read_fd, int write_fd, Request_handler handler, Settings settings);
+    Hid_event_loop(int read_fd, int write_fd, Request_handler handler) : Hid_event_loop(read_fd, write_fd, std::move(handler), Settings()) {}
+    Hid_event_loop(int device_fd, Request_handler handler) : Hid_event_loop(device_fd, device_fd, std::move(handler), Settings()) {}
+    Hid_event_loop(Hid_event_loop const &) = delete;
+    Hid_event_loop &operator=(Hid_event_loop const &) = delete;
+    ~Hid_event_loop();
+
+    /**
+	 * Runs until stop() is called or the device is closed
+	 */
+    void run();
+
+    /**
+	 * Handles the events that arrive within the timeout, for hosts that drive the loop themselves
+	 */
+    void run_once(std::chrono::milliseconds timeout);
+
+    // Thread safe
+    void stop();
+    void post(std::function<void()> task);
+
+    /**
+	 * Sends a response, which ends the request being processed if it is on the same channel
+	 */
+    void send_response(uint32_t channel, uint8_t command, Byte_buffer const &payload);
+    void send_error(uint32_t channel, uint8_t error);
+
+    /**
+	 * Changes the status sent in the keep-alives, e.g. to status_upneeded while waiting for the user
+	 */
+    void set_keep_alive_status(uint8_t status);
+
+    /**
+	 * The loop's timer wheel, the callbacks run on the loop's thread
+	 */
+    Timer_wheel &timers() { return timers_; }
+
+    bool busy() const { return busy_; }
+    bool device_closed() const { return device_closed_; }
+    // The errno that closed the device, 0 for end of file
+    int device_error() const { return device_error_; }
+
+  private:
+    int read_fd_;
+    int write_fd_;
+    int epoll_fd_{ -1 };
+    int wake_fd_{ -1 };
+    Request_handler handler_;
+    Settings settings_;
+    Timer_wheel timers_;
+
+    std::atomic<bool> stop_{ false };
+    std::mutex tasks_mutex_;
+    std::vector<std::function<void()>> tasks_;
+
+    bool device_closed_{ false };
+    int device_error_{ 0 };
+
+    // Bytes of a report, read devices that are not packet based return partial reports
+    Ctap_hid::Report in_{};
+    std::size_t in_size_{ 0 };
+
+    // The request being received
+    bool receiving_{ false };
+    uint32_t channel_{ 0 };
+    uint8_t command_{ 0 };
+    std::size_t length_{ 0 };
+    uint8_t next_sequence_{ 0 };
+    Byte_buffer payload_;
+    Timer_wheel::Timer transaction_timer_;
+
+    // The request being processed
+    bool busy_{ false };
+    uint32_t busy_channel_{ 0 };
+    uint8_t keep_alive_status_{ Ctap_hid::status_processing };
+    Timer_wheel::Timer keep_alive_timer_;
+    Clock::time_point keep_alive_end_{};
+
+    std::deque<Ctap_hid::Report> out_;
+    std::size_t out_offset_{ 0 };
+    bool waiting_to_write_{ false };
+
+    void read_device();
+    void handle_report(Ctap_hid::Report const &report);
+    void handle_init_report(Ctap_hid::Report const &report);
+    void dispatch();
+    void queue_message(uint32_t channel, uint8_t command, Byte_buffer const &payload);
+    void write_device();
+    void watch_writes(bool watch);
+    void run_tasks();
+    void transaction_timed_out();
+    void send_keep_alive();
+    int wait_ms(std::chrono::milliseconds limit) const;
+};
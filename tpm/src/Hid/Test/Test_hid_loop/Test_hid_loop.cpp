@@ -0,0 +1,292 @@
+/*******************************************************************************
+* File:        Test_hid_loop.cpp
+* Description: Test of the CTAPHID event loop, with a socketpair or pipes for the device
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Byte_buffer.h"
+#include "Ctap_hid.h"
+#include "Hid_event_loop.h"
+#include "Timer_wheel.h"
+
+namespace
+{
+struct Message
+{
+    uint32_t channel;
+    uint8_t command;
+    Byte_buffer payload;
+};
+
+void check(bool ok, std::string const &what)
+{
+    if (!ok) {
+        throw(std::runtime_error("Check failed: " + what));
+    }
+}
+
+void write_reports(int fd, std::vector<Ctap_hid::Report> const &reports)
+{
+    for (auto const &report : reports) {
+        check(write(fd, report.data(), report.size()) == static_cast<ssize_t>(report.size()), "host write");
+    }
+}
+
+// Runs the loop until a whole message has been written to the host, the host side reads are blocking
+Message read_message(Hid_event_loop &loop, int fd, std::chrono::milliseconds timeout = std::chrono::seconds(2))
+{
+    auto end = std::chrono::steady_clock::now() + timeout;
+    Message message{ 0, 0, Byte_buffer() };
+    std::size_t length = 0;
+    bool started = false;
+    while (std::chrono::steady_clock::now() < end) {
+        pollfd pfd{ fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) != 1) {
+            loop.run_once(std::chrono::milliseconds(10));
+            continue;
+        }
+        Ctap_hid::Report report{};
+        check(read(fd, report.data(), report.size()) == static_cast<ssize_t>(report.size()), "host read");
+        if (!started) {
+            check(Ctap_hid::is_init_report(report), "response starts with an initialisation report");
+            started = true;
+            message.channel = Ctap_hid::report_channel(report);
+            message.command = Ctap_hid::report_command(report);
+            length = Ctap_hid::report_length(report);
+            message.payload = Byte_buffer(report.data() + 7, std::min(length, Ctap_hid::init_data_size));
+        } else {
+            std::size_t part = std::min(length - message.payload.size(), Ctap_hid::cont_data_size);
+            message.payload += Byte_buffer(report.data() + 5, part);
+        }
+        if (message.payload.size() == length) {
+            return message;
+        }
+    }
+    throw(std::runtime_error("Timed out waiting for a response"));
+}
+
+Byte_buffer test_payload(std::size_t size)
+{
+    Byte_buffer bb(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        bb[i] = static_cast<Byte>(i * 7);
+    }
+    return bb;
+}
+
+bool is_error(Message const &m, uint32_t channel, uint8_t error)
+{
+    return m.channel == channel && m.command == Ctap_hid::cmd_error && m.payload == Byte_buffer{ error };
+}
+
+// Timers up to six hours away, past the range of the wheel's levels, some cancelled and some re-armed
+// from their callbacks, on a simulated clock
+void test_timer_wheel()
+{
+    using Clock = Timer_wheel::Clock;
+    constexpr std::size_t timer_count = 10000;
+    auto start = Clock::now();
+    Timer_wheel wheel(std::chrono::milliseconds(1), start);
+    std::mt19937_64 random(1);
+    std::uniform_int_distribution<int64_t> after_ms(0, 6 * 3600 * 1000);
+
+    struct Entry
+    {
+        std::unique_ptr<Timer_wheel::Timer> timer;
+        Clock::time_point expiry;
+        int fired;
+        bool rearm;
+    };
+    std::vector<Entry> entries(timer_count);
+    Clock::time_point now = start;
+    Clock::time_point previous = start;
+    for (std::size_t i = 0; i < timer_count; ++i) {
+        Entry &e = entries[i];
+        e.timer = std::make_unique<Timer_wheel::Timer>([&, i]() {
+            Entry &entry = entries[i];
+            check(now >= entry.expiry && entry.expiry > previous, "timer fired on time");
+            ++entry.fired;
+            if (entry.rearm) {
+                entry.rearm = false;
+                entry.expiry = now + std::chrono::milliseconds(after_ms(random) / 1000);
+                wheel.arm_at(*entry.timer, entry.expiry);
+            }
+        });
+        e.expiry = start + std::chrono::milliseconds(after_ms(random));
+        e.fired = 0;
+        e.rearm = i % 10 == 0;
+        wheel.arm_at(*e.timer, e.expiry);
+    }
+    for (std::size_t i = 1; i < timer_count; i += 10) {
+        entries[i].timer->cancel();
+    }
+    check(wheel.size() == timer_count - timer_count / 10, "armed timers");
+
+    // Steps of up to a minute, each timer must fire in the step it expires in
+    std::uniform_int_distribution<int64_t> step_ms(1, 60000);
+    while (wheel.size() != 0) {
+        auto next = wheel.next_expiry();
+        check(next.has_value(), "next expiry");
+        previous = now;
+        now = std::max(now + std::chrono::milliseconds(step_ms(random)), *next);
+        wheel.advance(now);
+        check(now < start + std::chrono::hours(7), "all timers fired");
+    }
+    for (std::size_t i = 0; i < timer_count; ++i) {
+        check(entries[i].fired == (i % 10 == 1 ? 0 : i % 10 == 0 ? 2 : 1), "each timer fired once");
+    }
+}
+}// namespace
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    constexpr uint32_t channel = 0x01020304;
+    constexpr uint32_t other_channel = 0x0a0b0c0d;
+    Hid_event_loop::Settings settings;
+    settings.transaction_timeout = std::chrono::milliseconds(100);
+    settings.keep_alive_interval = std::chrono::milliseconds(50);
+
+    try {
+        test_timer_wheel();
+        std::cout << "Timer wheel OK\n";
+
+        int fds[2];
+        check(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0, "socketpair");
+        int host = fds[0];
+
+        // Pings are echoed at once, CBOR requests are answered from another thread
+        std::thread worker;
+        Hid_event_loop *loop_ptr = nullptr;
+        int cancels = 0;
+        Hid_event_loop loop(fds[1], fds[1], [&](Hid_event_loop::Request const &request) {
+            if (request.command == Ctap_hid::cmd_ping) {
+                loop_ptr->send_response(request.channel, request.command, request.payload);
+            } else if (request.command == Ctap_hid::cmd_cbor) {
+                worker = std::thread([&, request]() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                    loop_ptr->post([&, request]() { loop_ptr->send_response(request.channel, request.command, request.payload); });
+                });
+            } else if (request.command == Ctap_hid::cmd_cancel) {
+                ++cancels;
+            } else {
+                loop_ptr->send_error(request.channel, Ctap_hid::err_invalid_cmd);
+            }
+        },
+          settings);
+        loop_ptr = &loop;
+
+        // A request in several reports
+        Byte_buffer payload = test_payload(1000);
+        write_reports(host, Ctap_hid::fragment_message(channel, Ctap_hid::cmd_ping, payload));
+        Message m = read_message(loop, host);
+        check(m.channel == channel && m.command == Ctap_hid::cmd_ping && m.payload == payload, "ping echoed");
+        std::cout << "Reassembly OK\n";
+
+        // A slow request, with keep-alives, a cancel, and other channels told the device is busy
+        write_reports(host, Ctap_hid::fragment_message(channel, Ctap_hid::cmd_cbor, test_payload(100)));
+        m = read_message(loop, host);
+        check(m.channel == channel && m.command == Ctap_hid::cmd_keepalive && m.payload == Byte_buffer{ Ctap_hid::status_processing },
+          "keep-alive");
+        write_reports(host, Ctap_hid::fragment_message(other_channel, Ctap_hid::cmd_ping, test_payload(10)));
+        m = read_message(loop, host);
+        while (m.command == Ctap_hid::cmd_keepalive) {
+            m = read_message(loop, host);
+        }
+        check(is_error(m, other_channel, Ctap_hid::err_channel_busy), "busy");
+        write_reports(host, Ctap_hid::fragment_message(channel, Ctap_hid::cmd_cancel, Byte_buffer()));
+        int keep_alives = 1;
+        do {
+            m = read_message(loop, host);
+            keep_alives += m.command == Ctap_hid::cmd_keepalive;
+        } while (m.command == Ctap_hid::cmd_keepalive);
+        worker.join();
+        check(m.channel == channel && m.command == Ctap_hid::cmd_cbor && m.payload == test_payload(100), "posted response");
+        check(keep_alives >= 3 && !loop.busy() && cancels == 1, "keep-alives and cancel");
+        std::cout << "Keep-alives OK (" << keep_alives << " sent)\n";
+
+        // The rest of a request that never arrives
+        auto reports = Ctap_hid::fragment_message(channel, Ctap_hid::cmd_ping, payload);
+        write_reports(host, { reports[0] });
+        m = read_message(loop, host);
+        check(is_error(m, channel, Ctap_hid::err_msg_timeout), "timeout");
+        write_reports(host, { reports[0], reports[2] });
+        m = read_message(loop, host);
+        check(is_error(m, channel, Ctap_hid::err_invalid_seq), "sequence");
+        std::cout << "Timeout and sequence errors OK\n";
+
+        close(host);
+        loop.run();
+        check(loop.device_closed(), "device closed");
+        close(fds[1]);
+
+        // Pipes, with the reports split across writes
+        int to_device[2];
+        int from_device[2];
+        check(pipe(to_device) == 0 && pipe(from_device) == 0, "pipe");
+        Hid_event_loop pipe_loop(to_device[0], from_device[1], [&](Hid_event_loop::Request const &request) {
+            loop_ptr->send_response(request.channel, request.command, request.payload);
+        });
+        loop_ptr = &pipe_loop;
+        payload = test_payload(200);
+        for (auto const &report : Ctap_hid::fragment_message(channel, Ctap_hid::cmd_ping, payload)) {
+            check(write(to_device[1], report.data(), 20) == 20, "pipe write");
+            pipe_loop.run_once(std::chrono::milliseconds(0));
+            check(write(to_device[1], report.data() + 20, report.size() - 20) == static_cast<ssize_t>(report.size() - 20), "pipe write");
+        }
+        m = read_message(pipe_loop, from_device[0]);
+        check(m.channel == channel && m.payload == payload, "pipe echo");
+        for (int fd : { to_device[0], to_device[1], from_device[0], from_device[1] }) {
+            close(fd);
+        }
+        std::cout << "Pipes OK\n";
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
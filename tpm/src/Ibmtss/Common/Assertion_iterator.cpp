@@ -0,0 +1,171 @@
+/*******************************************************************************
+* File:        Assertion_iterator.cpp
+* Description: Signs the credentials for a getAssertion in turn, speculatively signing the next one in the background
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Tpm_status.h"
+#include "Tpm_worker.h"
+#include "Assertion_iterator.h"
+
+Result<Assertion_signature> Assertion_iterator::begin(uint64_t channel, std::vector<Assertion_credential> credentials, Assertion_stages stages)
+{
+    end();
+    if (credentials.empty()) {
+        return Tpm_status("begin_assertions", Web_authn_stage::none, "No credentials to sign with", Web_authn_error::bad_parameter);
+    }
+
+    channel_ = channel;
+    credentials_ = std::move(credentials);
+    stages_ = std::move(stages);
+
+    prepare();
+    execute();
+    Result<Assertion_signature> first = advance();
+    if (!first.ok()) {
+        end();
+        return first;
+    }
+    deadline_ = Clock::now() + window_;
+
+    return first;
+}
+
+Result<Assertion_signature> Assertion_iterator::next(uint64_t channel)
+{
+    static constexpr char const *op = "next_assertion";
+    if (!active()) {
+        return Tpm_status(op, Web_authn_stage::none, "No getAssertion in progress", Web_authn_error::not_allowed);
+    }
+    if (channel != channel_) {
+        end();
+        return Tpm_status(op, Web_authn_stage::none, "The channel has changed", Web_authn_error::not_allowed);
+    }
+    auto now = Clock::now();
+    if (now > deadline_) {
+        end();
+        return Tpm_status(op, Web_authn_stage::none, "The getAssertion has expired", Web_authn_error::not_allowed);
+    }
+    if (!executed_.valid()) {
+        end();
+        return Tpm_status(op, Web_authn_stage::none, "No more credentials", Web_authn_error::not_allowed);
+    }
+
+    if (executed_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        speculative_hits_++;
+    }
+    Result<Assertion_signature> result = advance();
+    if (!result.ok()) {
+        end();
+        return result;
+    }
+    // As for CTAP, each getNextAssertion restarts the timer
+    deadline_ = now + window_;
+
+    return result;
+}
+
+void Assertion_iterator::end()
+{
+    if (executed_.valid()) {
+        // A TPM command can't be cancelled, wait for it before the result is thrown away
+        executed_.wait();
+        executed_ = std::future<void>();
+        speculative_discards_++;
+    }
+    executing_.reset();
+    ready_.reset();
+    credentials_.clear();
+    stages_ = Assertion_stages();
+    next_ = 0;
+}
+
+void Assertion_iterator::wait() const
+{
+    if (executed_.valid()) {
+        executed_.wait();
+    }
+}
+
+void Assertion_iterator::prepare()
+{
+    if (next_ >= credentials_.size()) {
+        return;
+    }
+    ready_ = std::make_unique<Prepared_credential>();
+    stages_.prepare(credentials_[next_], *ready_);
+    next_++;
+}
+
+void Assertion_iterator::execute()
+{
+    if (!ready_) {
+        return;
+    }
+    executing_ = std::move(ready_);
+    Prepared_credential *prepared = executing_.get();
+    executed_ = worker_.submit([this, prepared]() {
+        if (prepared->status.ok()) {
+            stages_.execute(*prepared);
+        }
+    });
+}
+
+Result<Assertion_signature> Assertion_iterator::advance()
+{
+    // The host work for the next credential overlaps the TPM commands for this one
+    if (!ready_) {
+        prepare();
+    }
+    executed_.get();
+    std::unique_ptr<Prepared_credential> done = std::move(executing_);
+
+    // Then keep the TPM busy with the next credential while this one is
+    // finished and the one after is prepared
+    execute();
+    prepare();
+
+    if (!done->status.ok()) {
+        return done->status;
+    }
+    return stages_.finish(*done);
+}
@@ -0,0 +1,145 @@
+/*******************************************************************************
+* File:        Context_save.cpp
+* Description: Save and restore the context of a loaded key
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "Tss_includes.h"
+#include "Tss_execute.h"
+#include "Io_utils.h"
+#include "Sha.h"
+#include "Context_save.h"
+
+TPM_RC context_save(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle,
+Byte_buffer* context_blob
+)
+{
+    ContextSave_In in;
+    ContextSave_Out out;
+
+    in.saveHandle=handle;
+    TPM_RC rc = tss_execute(tss_context, handle,
+        reinterpret_cast<RESPONSE_PARAMETERS *>(&out),
+        reinterpret_cast<COMMAND_PARAMETERS *>(&in),
+        nullptr,
+        TPM_CC_ContextSave,
+        TPM_RH_NULL, NULL, 0);
+    if (rc!=0)
+    {
+        return rc;
+    }
+
+    uint16_t size=0;
+    uint8_t* buffer=nullptr;
+    rc=TSS_Structure_Marshal(&buffer,&size,&out.context,(MarshalFunction_t)TSS_TPMS_CONTEXT_Marshal);
+    if (rc==0)
+    {
+        *context_blob=Byte_buffer(buffer,size);
+    }
+    free(buffer);
+    return rc;
+}
+
+TPM_RC context_load(
+TSS_CONTEXT* tss_context,
+std::string const& data_dir,
+Byte_buffer const& context_blob,
+TPM_HANDLE* handle,
+bool keep_tss_files
+)
+{
+    ContextLoad_In in;
+    ContextLoad_Out out;
+
+    // The TSS unmarshalling functions only read the buffer
+    Byte* buffer=const_cast<Byte*>(context_blob.cdata());
+    auto size=static_cast<int32_t>(context_blob.size());
+    TPM_RC rc=TPMS_CONTEXT_Unmarshal(&in.context,&buffer,&size);
+    if (rc!=0)
+    {
+        return rc;
+    }
+
+    rc = tss_execute(tss_context, 0,
+        reinterpret_cast<RESPONSE_PARAMETERS *>(&out),
+        reinterpret_cast<COMMAND_PARAMETERS *>(&in),
+        nullptr,
+        TPM_CC_ContextLoad,
+        TPM_RH_NULL, NULL, 0);
+    if (rc!=0)
+    {
+        return rc;
+    }
+    *handle=out.loadedHandle;
+
+    if (keep_tss_files)
+    {
+        return 0;
+    }
+    for (auto const& file : context_tss_files(context_blob))
+    {
+        std::remove(make_filename(data_dir,file).c_str());
+    }
+    return 0;
+}
+
+std::vector<std::string> context_tss_files(
+Byte_buffer const& context_blob
+)
+{
+#if defined(TPM_TSS_NOFILE)
+    (void)context_blob;
+    return {};
+#else
+    TPMS_CONTEXT context;
+    Byte* buffer=const_cast<Byte*>(context_blob.cdata());
+    auto size=static_cast<int32_t>(context_blob.size());
+    if (TPMS_CONTEXT_Unmarshal(&context,&buffer,&size)!=0)
+    {
+        return {};
+    }
+    // The TSS names these files with the SHA256 hash of the context blob
+    std::string hash=sha256_bb(Byte_buffer(context.contextBlob.t.buffer,context.contextBlob.t.size)).to_hex_string();
+    return {"h"+hash+".bin","hp"+hash+".bin"};
+#endif
+}
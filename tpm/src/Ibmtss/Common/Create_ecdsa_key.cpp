@@ -43,6 +43,8 @@
 #include "Tpm_error.h"
 #include "Tss_setup.h"
 #include "Tpm_timer.h"
+#include "Key_template.h"
+#include "Tss_execute.h"
 #include "Create_ecdsa_key.h"
 
 /*
@@ -86,40 +88,22 @@ Create_Out* out
 		memcpy(in.inSensitive.sensitive.userAuth.t.buffer,auth.data(),auth.size());
 	}
 	in.inSensitive.sensitive.data.t.size = 0;
-	TPMT_PUBLIC& tpmt_public = in.inPublic.publicArea;
-	tpmt_public.type = TPM_ALG_ECC;
-	tpmt_public.nameAlg = TPM_ALG_SHA256;
-
-	/* Table 32 - TPMA_OBJECT objectAttributes */
-	tpmt_public.objectAttributes.val = TPMA_OBJECT_FIXEDTPM |
-		TPMA_OBJECT_NODA |
-		TPMA_OBJECT_FIXEDPARENT |
-		TPMA_OBJECT_SENSITIVEDATAORIGIN |
-		TPMA_OBJECT_USERWITHAUTH |
-		TPMA_OBJECT_SIGN;
-
-	/* Table 181 - Definition of {ECC} TPMS_ECC_PARMS Structure eccDetail */
-	/* Table 129 - Definition of TPMT_SYM_DEF_OBJECT Structure symmetric */
-	/* Non-storage keys must have TPM_ALG_NULL for the symmetric algorithm */
-	tpmt_public.parameters.eccDetail.symmetric.algorithm = TPM_ALG_NULL;
-
-	tpmt_public.parameters.eccDetail.scheme.scheme = TPM_ALG_ECDSA;
-	tpmt_public.parameters.eccDetail.scheme.details.ecdsa.hashAlg = TPM_ALG_SHA256;
-	tpmt_public.parameters.eccDetail.curveID = curve_ID;
-	// Although the curve requires a particular KDF algorithm this seems to be ignored 
-	// here unlike the signing scheme!
-	tpmt_public.parameters.eccDetail.kdf.scheme = TPM_ALG_NULL;
-	/* Table 177 - TPMU_PUBLIC_ID unique */
-	/* Table 177 - Definition of TPMU_PUBLIC_ID */
-	tpmt_public.unique.ecc.x.t.size = 0;
-	tpmt_public.unique.ecc.y.t.size = 0;
-
-	tpmt_public.authPolicy.t.size=0;
+	/* Table 184 - TPM2B_PUBLIC inPublic, built at compile time */
+	switch (curve_ID) {
+	case TPM_ECC_NIST_P256:
+		in.inPublic = Ecdsa_p256_template::tpm2b_public();
+		break;
+	case TPM_ECC_NIST_P384:
+		in.inPublic = Ecdsa_p384_template::tpm2b_public();
+		break;
+	default:
+		return TPM_RC_CURVE;
+	}
 
 	in.outsideInfo.t.size = 0;
 	/* Table 102 - TPML_PCR_SELECTION creationPCR */
 	in.creationPCR.count = 0;
-	rc = TSS_Execute(tss_context,
+	rc = tss_execute(tss_context, in.parentHandle,
 		reinterpret_cast<RESPONSE_PARAMETERS *>(out),
 		reinterpret_cast<COMMAND_PARAMETERS *>(&in),
 		nullptr,
@@ -47,6 +47,8 @@
 #include "Tpm_timer.h"
 #include "Tpm_param.h"
 #include "Tpm_error.h"
+#include "Key_template.h"
+#include "Tss_execute.h"
 #include "Create_primary_rsa_key.h"
 
 // Create a primary key in the given hierarchy
@@ -180,33 +182,16 @@ TPM_RC create_primary_rsa_key(
     in.inSensitive.sensitive.userAuth.t.size = 0;
     in.inSensitive.sensitive.data.t.size = 0;
 
-    // construct the template using the default IWG template
+    // construct the template from the compile time RSA 2048 template, the
+    // attributes and policy are given by the caller
+    in.inPublic = Primary_rsa_2048_template::tpm2b_public();
     TPMT_PUBLIC &tpmt_public = in.inPublic.publicArea;
-    tpmt_public.type = TPM_ALG_RSA;
-    tpmt_public.nameAlg = TPM_ALG_SHA256;
     tpmt_public.objectAttributes.val = attributes;
-    /*    tpmt_public.objectAttributes.val = TPMA_OBJECT_FIXEDTPM |
-				       TPMA_OBJECT_FIXEDPARENT |
-    			       TPMA_OBJECT_SENSITIVEDATAORIGIN |
-				       TPMA_OBJECT_USERWITHAUTH |
-                       TPMA_OBJECT_RESTRICTED |
-                       TPMA_OBJECT_NODA |
-				       TPMA_OBJECT_DECRYPT;
-*/
-
     tpmt_public.authPolicy = bb_to_tpm2b<TPM2B_DIGEST>(policy);
 
-    tpmt_public.parameters.rsaDetail.symmetric.algorithm = TPM_ALG_AES;
-    tpmt_public.parameters.rsaDetail.symmetric.keyBits.aes = aes_key_bits;
-    tpmt_public.parameters.rsaDetail.symmetric.mode.aes = TPM_ALG_CFB;
-    tpmt_public.parameters.rsaDetail.scheme.scheme = TPM_ALG_NULL;
-    tpmt_public.parameters.rsaDetail.keyBits = 2048;
-    tpmt_public.parameters.rsaDetail.exponent = 0;
-    tpmt_public.unique.rsa.t.size = 0;
-
     in.outsideInfo.t.size = 0;
     in.creationPCR.count = 0;
-    rc = TSS_Execute(tss_context,
+    rc = tss_execute(tss_context, in.primaryHandle,
       reinterpret_cast<RESPONSE_PARAMETERS *>(out),
       reinterpret_cast<COMMAND_PARAMETERS *>(&in),
       nullptr,
@@ -44,7 +44,8 @@
 #include "Tss_setup.h"
 #include "Tpm_timer.h"
 #include "Tss_includes.h"
-#include "Tss_key_helpers.h"
+#include "Tss_execute.h"
+#include "Key_template.h"
 #include "Create_storage_key.h"
 
 /*
@@ -87,38 +88,14 @@ Create_Out* out
 
 	in.inSensitive.sensitive.data.t.size = 0;
 	
-	TPMT_PUBLIC& tpmt_public = in.inPublic.publicArea;
-	tpmt_public.type = TPM_ALG_ECC;
-	tpmt_public.nameAlg = TPM_ALG_SHA256;
-
-	/* Table 32 - TPMA_OBJECT objectAttributes */ // Use NODA, for now
-	tpmt_public.objectAttributes.val = obj_storage | TPMA_OBJECT_NODA | TPMA_OBJECT_USERWITHAUTH;
-
-	/* Table 181 - Definition of {ECC} TPMS_ECC_PARMS Structure eccDetail */
-	/* Table 129 - Definition of TPMT_SYM_DEF_OBJECT Structure symmetric */
-	tpmt_public.parameters.eccDetail.symmetric.algorithm = TPM_ALG_AES;
-    tpmt_public.parameters.eccDetail.symmetric.keyBits.aes = 128;
-    /* Table 126 - TPMU_SYM_MODE mode */
-    tpmt_public.parameters.eccDetail.symmetric.mode.aes = TPM_ALG_CFB;
-
-	tpmt_public.parameters.eccDetail.scheme.scheme = TPM_ALG_NULL;
-	tpmt_public.parameters.eccDetail.scheme.details.anySig.hashAlg =0;
-	tpmt_public.parameters.eccDetail.curveID = TPM_ECC_NIST_P256;
-    tpmt_public.parameters.eccDetail.kdf.scheme = TPM_ALG_NULL;
-    tpmt_public.parameters.eccDetail.kdf.details.mgf1.hashAlg = 0;
-	
-		/* Table 177 - TPMU_PUBLIC_ID unique */
-	/* Table 177 - Definition of TPMU_PUBLIC_ID */
-	tpmt_public.unique.ecc.x.t.size = 0;
-	tpmt_public.unique.ecc.y.t.size = 0;
-
-	tpmt_public.authPolicy.t.size=0;
+	/* Table 184 - TPM2B_PUBLIC inPublic, built at compile time */
+	in.inPublic = Storage_p256_template::tpm2b_public();
 
 	in.outsideInfo.t.size = 0;
 	/* Table 102 - TPML_PCR_SELECTION creationPCR */
 	in.creationPCR.count = 0;
 
-	rc = TSS_Execute(tss_context,
+	rc = tss_execute(tss_context, in.parentHandle,
 		reinterpret_cast<RESPONSE_PARAMETERS *>(out),
 		reinterpret_cast<COMMAND_PARAMETERS *>(&in),
 		nullptr,
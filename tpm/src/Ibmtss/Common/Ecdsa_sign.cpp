@@ -42,6 +42,7 @@
 #include <cstring>
 #include "Byte_buffer.h"
 #include "Tss_includes.h"
+#include "Tss_execute.h"
 #include "Ecdsa_sign.h"
 
 TPM_RC ecdsa_sign(
@@ -52,28 +53,43 @@ std::string const& ecdsa_auth,
 Sign_Out* sign_out
 )
 {
-    TPM_RC rc=0;
     Sign_In sign_in;
-    
-    sign_in.keyHandle=handle;
-    sign_in.inScheme.scheme=TPM_ALG_ECDSA;
-    sign_in.inScheme.details.ecdsa.hashAlg=TPM_ALG_SHA256;
-    sign_in.digest.t.size = static_cast<uint16_t>(digest_to_sign.size());
-    memcpy(&sign_in.digest.t.buffer,digest_to_sign.cdata(),digest_to_sign.size());
 
-    sign_in.validation.tag = TPM_ST_HASHCHECK;
-    sign_in.validation.hierarchy = TPM_RH_NULL;
-    sign_in.validation.digest.t.size = 0;
-        
-    if (rc == 0) {
-        rc = TSS_Execute(tss_context,
-            reinterpret_cast<RESPONSE_PARAMETERS *>(sign_out),
-            reinterpret_cast<COMMAND_PARAMETERS *>(&sign_in),
-            nullptr,
-            TPM_CC_Sign,
-            TPM_RS_PW, (ecdsa_auth.size()==0?nullptr:ecdsa_auth.c_str()), 0,            
-            TPM_RH_NULL, NULL, 0);
-    }
+    ecdsa_sign_in(handle, digest_to_sign, &sign_in);
+    return ecdsa_sign(tss_context, ecdsa_auth, &sign_in, sign_out);
+}
+
+void ecdsa_sign_in(
+TPM_HANDLE handle,
+Byte_buffer const& digest_to_sign,
+Sign_In* sign_in
+)
+{
+    sign_in->keyHandle=handle;
+    sign_in->inScheme.scheme=TPM_ALG_ECDSA;
+    sign_in->inScheme.details.ecdsa.hashAlg=TPM_ALG_SHA256;
+    sign_in->digest.t.size = static_cast<uint16_t>(digest_to_sign.size());
+    memcpy(&sign_in->digest.t.buffer,digest_to_sign.cdata(),digest_to_sign.size());
+
+    sign_in->validation.tag = TPM_ST_HASHCHECK;
+    sign_in->validation.hierarchy = TPM_RH_NULL;
+    sign_in->validation.digest.t.size = 0;
+}
+
+TPM_RC ecdsa_sign(
+TSS_CONTEXT* tss_context,
+std::string const& ecdsa_auth,
+Sign_In* sign_in,
+Sign_Out* sign_out
+)
+{
+    TPM_RC rc = tss_execute(tss_context, sign_in->keyHandle,
+        reinterpret_cast<RESPONSE_PARAMETERS *>(sign_out),
+        reinterpret_cast<COMMAND_PARAMETERS *>(sign_in),
+        nullptr,
+        TPM_CC_Sign,
+        TPM_RS_PW, (ecdsa_auth.size()==0?nullptr:ecdsa_auth.c_str()), 0,
+        TPM_RH_NULL, NULL, 0);
     return rc;
 }
 
@@ -0,0 +1,126 @@
+/*******************************************************************************
+* File:        Flight_recorder.cpp
+* Description: An in-memory record of the most recent TPM commands
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include "Tpm_error.h"
+#include "Request_scope.h"
+#include "Flight_recorder.h"
+
+namespace
+{
+thread_local char const *current_op = nullptr;
+
+int64_t to_microseconds(Tpm_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+}// namespace
+
+Flight_recorder::Operation::Operation(char const *op) : previous_(current_op)
+{
+    current_op = op;
+}
+
+Flight_recorder::Operation::~Operation()
+{
+    current_op = previous_;
+}
+
+char const *Flight_recorder::current_operation()
+{
+    return current_op == nullptr ? "" : current_op;
+}
+
+void Flight_recorder::command_completed(TPM_CC command, TPM_HANDLE handle, TPM_RC rc, Tpm_clock::time_point start,
+  Tpm_clock::time_point end)
+{
+    Request_context request = current_request();
+    Record record{ current_operation(),
+        request.id,
+        request.tag,
+        to_microseconds(start),
+        static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()),
+        command,
+        handle,
+        rc };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_[count_ % capacity] = record;
+    ++count_;
+}
+
+std::vector<Flight_recorder::Record> Flight_recorder::records() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Record> records;
+    uint64_t first = count_ > capacity ? count_ - capacity : 0;
+    records.reserve(count_ - first);
+    for (uint64_t i = first; i < count_; ++i) {
+        records.push_back(ring_[i % capacity]);
+    }
+    return records;
+}
+
+std::string Flight_recorder::to_string() const
+{
+    auto records = this->records();
+    int64_t now_us = to_microseconds(Tpm_clock::now());
+
+    std::ostringstream os;
+    os << "TPM flight record, the last " << records.size() << " commands:";
+    for (auto const &r : records) {
+        os << "\n  " << std::fixed << std::setprecision(6) << static_cast<double>(r.start_us - now_us) / 1e6 << " s"
+           << "  " << (r.op[0] == '\0' ? "-" : r.op);
+        if (r.request_id != 0) {
+            os << "  request 0x" << std::hex << r.request_id << '/' << std::dec << r.request_tag;
+        }
+        os
+           << "  " << tpm_command_name(r.command) << " (0x" << std::hex << r.command << ')'
+           << "  handle 0x" << r.handle
+           << "  rc 0x" << r.rc << std::dec
+           << "  " << r.duration_us << " us";
+        if (r.rc != 0) {
+            os << "  " << get_tpm_error(r.rc);
+        }
+    }
+    return os.str();
+}
@@ -38,6 +38,7 @@
 *******************************************************************************/
 
 #include "Tss_includes.h"
+#include "Tss_execute.h"
 #include "Tpm_error.h"
 #include "Tpm_timer.h"
 #include "Flush_context.h"
@@ -58,7 +59,7 @@ typedef struct {
     TPMI_DH_CONTEXT     flushHandle;
 } FlushContext_In;
 */    
-    rc = TSS_Execute(tssContext,
+    rc = tss_execute(tssContext, handle,
                         nullptr, 
                         reinterpret_cast<COMMAND_PARAMETERS *>(&in),
                         nullptr,
@@ -0,0 +1,108 @@
+/*******************************************************************************
+* File:        Key_blob_tag.cpp
+* Description: A host-side tag on the key blobs, checked before they are sent to the TPM
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include "Hmac.h"
+#include "Openssl_utils.h"
+#include "Key_blob_tag.h"
+
+namespace
+{
+// Keeps the tags apart from any other use of the key
+const Byte_buffer tag_label(std::string("watpm key blob"));
+
+Byte_buffer key_blob_tag(
+Byte_buffer const& tag_key,
+Byte_buffer const& public_data,
+Byte_buffer const& private_data
+)
+{
+    Byte_buffer tag = hmac_sha256(tag_key, tag_label + public_data + private_data);
+    tag.resize(key_blob_tag_bytes);
+    return tag;
+}
+}// namespace
+
+Byte_buffer new_key_blob_tag_key()
+{
+    Byte_buffer tag_key(key_blob_tag_key_bytes, 0);
+    if (RAND_bytes(&tag_key[0], static_cast<int>(tag_key.size())) != 1) {
+        throw Openssl_error("Unable to generate the key blob tag key");
+    }
+    return tag_key;
+}
+
+Byte_buffer add_key_blob_tag(
+Byte_buffer const& tag_key,
+Byte_buffer const& public_data,
+Byte_buffer const& private_data
+)
+{
+    return private_data + key_blob_tag(tag_key, public_data, private_data);
+}
+
+Key_blob_tag_check check_key_blob_tag(
+Byte_buffer const& tag_key,
+Byte_buffer const& public_data,
+Byte_buffer* private_data
+)
+{
+    // The private data is a marshalled TPM2B_PRIVATE, its size field says whether a tag follows
+    size_t size = private_data->size();
+    if (size < 2) {
+        return Key_blob_tag_check::bad_tag;
+    }
+    size_t marshalled_size = 2 + ((static_cast<size_t>((*private_data)[0]) << 8) | (*private_data)[1]);
+    if (size == marshalled_size) {
+        return Key_blob_tag_check::untagged;
+    }
+    if (size != marshalled_size + key_blob_tag_bytes) {
+        return Key_blob_tag_check::bad_tag;
+    }
+
+    Byte_buffer untagged(private_data->cdata(), marshalled_size);
+    Byte_buffer tag = key_blob_tag(tag_key, public_data, untagged);
+    if (CRYPTO_memcmp(tag.cdata(), private_data->cdata() + marshalled_size, key_blob_tag_bytes) != 0) {
+        return Key_blob_tag_check::bad_tag;
+    }
+    *private_data = untagged;
+    return Key_blob_tag_check::tagged;
+}
@@ -0,0 +1,227 @@
+/*******************************************************************************
+* File:        Latency_watchdog.cpp
+* Description: Watches the TPM commands for ones that take longer than their budget
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include "Latency_watchdog.h"
+#include "Request_scope.h"
+
+namespace
+{
+uint32_t to_us(std::chrono::microseconds us)
+{
+    return static_cast<uint32_t>(us.count());
+}
+}// namespace
+
+Latency_watchdog::Latency_watchdog() : default_budget_(std::chrono::milliseconds(500))
+{
+    // Generating keys, and running the self test at startup, can take a hardware TPM several seconds
+    commands_[TPM_CC_CreatePrimary].budget = std::chrono::seconds(30);
+    commands_[TPM_CC_Create].budget = std::chrono::seconds(5);
+    commands_[TPM_CC_Startup].budget = std::chrono::seconds(5);
+}
+
+Latency_watchdog::~Latency_watchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+Latency_watchdog::Command_entry &Latency_watchdog::entry(TPM_CC command)
+{
+    auto it = commands_.find(command);
+    if (it == commands_.end()) {
+        it = commands_.emplace(command, Command_entry{ default_budget_ }).first;
+    }
+    return it->second;
+}
+
+Latency_watchdog::Request_stats &Latency_watchdog::request_entry(uint64_t request_id)
+{
+    for (auto &r : requests_) {
+        if (r.id == request_id) {
+            return r.stats;
+        }
+    }
+    Request_entry &r = requests_[next_request_];
+    next_request_ = (next_request_ + 1) % recent_requests;
+    r = Request_entry{ request_id, Request_stats{} };
+    return r.stats;
+}
+
+void Latency_watchdog::set_budget(TPM_CC command, Microseconds budget)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry(command).budget = budget;
+}
+
+Latency_watchdog::Microseconds Latency_watchdog::budget(TPM_CC command) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = commands_.find(command);
+    return it == commands_.end() ? default_budget_ : it->second.budget;
+}
+
+void Latency_watchdog::set_event_handler(Event_handler handler, std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    event_handler_ = std::move(handler);
+    event_interval_ = interval;
+}
+
+void Latency_watchdog::set_overrun_handler(Overrun_handler handler)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    overrun_handler_ = std::move(handler);
+    if (overrun_handler_ && !thread_.joinable()) {
+        thread_ = std::thread(&Latency_watchdog::watch, this);
+    }
+}
+
+Latency_watchdog::Command_stats Latency_watchdog::stats(TPM_CC command) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = commands_.find(command);
+    if (it == commands_.end()) {
+        return Command_stats{ 0, 0, to_us(default_budget_), 0 };
+    }
+    auto const &e = it->second;
+    return Command_stats{ e.commands, e.over_budget, to_us(e.budget), e.worst_us };
+}
+
+Latency_watchdog::Request_stats Latency_watchdog::request_stats(uint64_t request_id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto const &r : requests_) {
+        if (request_id != 0 && r.id == request_id) {
+            return r.stats;
+        }
+    }
+    return Request_stats{};
+}
+
+void Latency_watchdog::command_started(TPM_CC command, TPM_HANDLE /*handle*/, Tpm_clock::time_point start)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_progress_ = true;
+    ++sequence_;
+    current_command_ = command;
+    started_ = start;
+    deadline_ = start + entry(command).budget;
+    if (overrun_handler_) {
+        wake_.notify_one();
+    }
+}
+
+void Latency_watchdog::command_completed(TPM_CC command, TPM_HANDLE handle, TPM_RC rc, Tpm_clock::time_point start,
+  Tpm_clock::time_point end)
+{
+    auto duration = std::chrono::duration_cast<Microseconds>(end - start);
+    // The request is the sending thread's, the getAssertion and preload workers take on their caller's
+    uint64_t request_id = current_request().id;
+
+    Slow_command slow{};
+    Event_handler handler;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_progress_ = false;
+        Command_entry &e = entry(command);
+        ++e.commands;
+        if (to_us(duration) > e.worst_us) {
+            e.worst_us = to_us(duration);
+        }
+        if (request_id != 0) {
+            Request_stats &r = request_entry(request_id);
+            ++r.commands;
+            r.tpm_us += to_us(duration);
+            if (to_us(duration) >= r.worst_us) {
+                r.worst_us = to_us(duration);
+                r.worst_command = command;
+            }
+        }
+        if (duration <= e.budget) {
+            return;
+        }
+        ++e.over_budget;
+        if (!event_handler_) {
+            return;
+        }
+        if (event_sent_ && end - last_event_ < event_interval_) {
+            ++suppressed_;
+            return;
+        }
+        slow = Slow_command{ command, handle, rc, to_us(duration), to_us(e.budget), e.over_budget, suppressed_ };
+        event_sent_ = true;
+        last_event_ = end;
+        suppressed_ = 0;
+        handler = event_handler_;
+    }
+    handler(slow);
+}
+
+void Latency_watchdog::watch()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (!in_progress_ || reported_sequence_ == sequence_ || !overrun_handler_) {
+            wake_.wait(lock);
+            continue;
+        }
+        uint64_t sequence = sequence_;
+        if (wake_.wait_until(lock, deadline_) != std::cv_status::timeout) {
+            continue;
+        }
+        if (stop_ || !in_progress_ || sequence != sequence_ || !overrun_handler_) {
+            continue;
+        }
+        reported_sequence_ = sequence;
+        TPM_CC command = current_command_;
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Tpm_clock::now() - started_);
+        Overrun_handler handler = overrun_handler_;
+        lock.unlock();
+        handler(command, static_cast<uint32_t>(elapsed.count()));
+        lock.lock();
+    }
+}
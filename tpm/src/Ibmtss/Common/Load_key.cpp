@@ -41,6 +41,7 @@
 #include <string>
 #include "Byte_buffer.h"
 #include "Tss_includes.h"
+#include "Tss_execute.h"
 #include "Load_key.h"
 
 TPM_RC load_key(
@@ -57,9 +58,19 @@ Load_Out* out
     load_key_in.parentHandle=parent_handle;
     load_key_in.inPrivate=tpm_private;
     load_key_in.inPublic=tpm_public;
-    TPM_RC rc = TSS_Execute(tss_context,
+    return load_key(tss_context, parent_auth, &load_key_in, out);
+}
+
+TPM_RC load_key(
+TSS_CONTEXT* tss_context,
+std::string const& parent_auth,
+Load_In* load_key_in,
+Load_Out* out
+)
+{
+    TPM_RC rc = tss_execute(tss_context, load_key_in->parentHandle,
         reinterpret_cast<RESPONSE_PARAMETERS *>(out),
-        reinterpret_cast<COMMAND_PARAMETERS *>(&load_key_in),
+        reinterpret_cast<COMMAND_PARAMETERS *>(load_key_in),
         nullptr,
         TPM_CC_Load,
         TPM_RS_PW, (parent_auth.size()==0?nullptr:parent_auth.c_str()), 0,
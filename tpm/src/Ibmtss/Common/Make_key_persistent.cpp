@@ -38,6 +38,7 @@
 *******************************************************************************/
 #include <cstring>
 #include "Tss_includes.h"
+#include "Tss_execute.h"
 #include "Tpm_error.h"
 
 TPM_RC make_key_persistent(
@@ -62,7 +63,7 @@ typedef struct {
     in.objectHandle = key_handle;
     in.persistentHandle = persistent_handle;
     /* call TSS to execute the command */
-        rc = TSS_Execute(tssContext,
+        rc = tss_execute(tssContext, key_handle,
                          nullptr, 
                          reinterpret_cast<COMMAND_PARAMETERS *>(&in),
                          nullptr,
@@ -81,13 +81,14 @@ TPM2B_PUBLIC* public_data
 }
 
 TSS_RC unmarshal_public_data_B(
-Byte_buffer& pd_bb,
+Byte_buffer const& pd_bb,
 TPM2B_PUBLIC* public_data_ptr
 )
 {
 	TSS_RC rc=0;
 
-	Byte* tmp_bb=&pd_bb[0];
+	// The TSS unmarshalling functions only read the buffer
+	Byte* tmp_bb=const_cast<Byte*>(pd_bb.cdata());
 	auto tmp_size=static_cast<int32_t>(pd_bb.size());
 	rc = TPM2B_PUBLIC_Unmarshal(public_data_ptr, &tmp_bb, &tmp_size, YES);
 
@@ -116,13 +117,14 @@ TPM2B_PRIVATE* private_data
 }
 
 TSS_RC unmarshal_private_data_B(
-Byte_buffer& pd_bb,
+Byte_buffer const& pd_bb,
 TPM2B_PRIVATE* private_data_ptr
 )
 {
 	TSS_RC rc=0;
 
-	Byte* tmp_bb=&pd_bb[0];
+	// The TSS unmarshalling functions only read the buffer
+	Byte* tmp_bb=const_cast<Byte*>(pd_bb.cdata());
 	auto tmp_size=static_cast<int32_t>(pd_bb.size());
 	rc = TPM2B_PRIVATE_Unmarshal(private_data_ptr, &tmp_bb, &tmp_size);
 
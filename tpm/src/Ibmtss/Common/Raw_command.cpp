@@ -0,0 +1,322 @@
+/*******************************************************************************
+* File:        Raw_command.cpp
+* Description: Pre-marshalled TPM2_Load, TPM2_Sign and TPM2_FlushContext commands
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <cstring>
+#include "Tss_execute.h"
+#include "Raw_command.h"
+
+namespace
+{
+// Every command and response starts with the tag, the size and the command
+// (or response) code. The handles follow
+constexpr std::size_t header_size=10;
+constexpr std::size_t size_offset=2;
+constexpr std::size_t code_offset=6;
+constexpr std::size_t handle_offset=header_size;
+
+constexpr auto load_header=hex_bytes("8002" "00000000" "00000157");
+constexpr auto sign_header=hex_bytes("8002" "00000000" "0000015d");
+constexpr auto flush_command=hex_bytes("8001" "0000000e" "00000165" "00000000");
+// TPM_RS_PW, an empty nonce and continueSession, the password follows
+constexpr auto password_session=hex_bytes("40000009" "0000" "01");
+// After the digest: the ECDSA scheme with SHA256 and a NULL hash check ticket
+constexpr auto ecdsa_sha256_no_ticket=hex_bytes("0018" "000b" "8024" "40000007" "0000");
+
+template<std::size_t N>
+constexpr uint32_t u32_at(Byte_block<N> const& bytes, std::size_t offset)
+{
+    return static_cast<uint32_t>(bytes[offset])<<24 | static_cast<uint32_t>(bytes[offset+1])<<16 |
+           static_cast<uint32_t>(bytes[offset+2])<<8 | static_cast<uint32_t>(bytes[offset+3]);
+}
+
+static_assert(u32_at(load_header,code_offset)==TPM_CC_Load,"Load command code");
+static_assert(u32_at(sign_header,code_offset)==TPM_CC_Sign,"Sign command code");
+static_assert(u32_at(flush_command,code_offset)==TPM_CC_FlushContext,"FlushContext command code");
+static_assert(u32_at(flush_command,2)==flush_command.size(),"FlushContext command size");
+static_assert(u32_at(password_session,0)==TPM_RS_PW,"Password session handle");
+
+void put_u32(Byte* buffer, uint32_t value)
+{
+    buffer[0]=static_cast<Byte>(value>>24);
+    buffer[1]=static_cast<Byte>(value>>16);
+    buffer[2]=static_cast<Byte>(value>>8);
+    buffer[3]=static_cast<Byte>(value);
+}
+
+uint32_t get_u32(Byte const* buffer)
+{
+    return static_cast<uint32_t>(buffer[0])<<24 | static_cast<uint32_t>(buffer[1])<<16 |
+           static_cast<uint32_t>(buffer[2])<<8 | static_cast<uint32_t>(buffer[3]);
+}
+
+// Appends to a command, a write that would overflow the buffer fails the
+// whole command
+class Command_writer
+{
+  public:
+    explicit Command_writer(Raw_command* command) : command_(command) { command_->size=0; }
+    template<std::size_t N>
+    void bytes(Byte_block<N> const& bytes) { this->bytes(bytes.data(),N); }
+    void bytes(Byte const* data, std::size_t size)
+    {
+        if (!ok_ || size>command_->buffer.size()-command_->size)
+        {
+            ok_=false;
+            return;
+        }
+        memcpy(command_->buffer.data()+command_->size,data,size);
+        command_->size+=static_cast<uint32_t>(size);
+    }
+    void u16(uint16_t value)
+    {
+        Byte buffer[2]{static_cast<Byte>(value>>8),static_cast<Byte>(value)};
+        bytes(buffer,sizeof(buffer));
+    }
+    void u32(uint32_t value)
+    {
+        Byte buffer[4];
+        put_u32(buffer,value);
+        bytes(buffer,sizeof(buffer));
+    }
+    void tpm2b(Byte const* data, std::size_t size)
+    {
+        if (size>UINT16_MAX)
+        {
+            ok_=false;
+            return;
+        }
+        u16(static_cast<uint16_t>(size));
+        bytes(data,size);
+    }
+    void password_session(std::string const& auth)
+    {
+        u32(static_cast<uint32_t>(::password_session.size()+2+auth.size()));
+        bytes(::password_session);
+        tpm2b(reinterpret_cast<Byte const*>(auth.data()),auth.size());
+    }
+    // Fill in the command size
+    TPM_RC finish()
+    {
+        if (!ok_)
+        {
+            command_->size=0;
+            return TSS_RC_INSUFFICIENT_BUFFER;
+        }
+        put_u32(command_->buffer.data()+size_offset,command_->size);
+        return 0;
+    }
+
+  private:
+    Raw_command* command_;
+    bool ok_=true;
+};
+
+// Reads the parameters of a successful response, reading past the end fails
+class Response_reader
+{
+  public:
+    Response_reader(Byte const* response, uint32_t size) : next_(response+header_size), end_(response+size) {}
+    bool ok() const { return ok_; }
+    uint16_t u16()
+    {
+        if (!available(2))
+            return 0;
+        uint16_t value=static_cast<uint16_t>(next_[0]<<8 | next_[1]);
+        next_+=2;
+        return value;
+    }
+    uint32_t u32()
+    {
+        if (!available(4))
+            return 0;
+        uint32_t value=static_cast<uint32_t>(next_[0])<<24 | static_cast<uint32_t>(next_[1])<<16 |
+                       static_cast<uint32_t>(next_[2])<<8 | static_cast<uint32_t>(next_[3]);
+        next_+=4;
+        return value;
+    }
+    // A TPM2B of at most N bytes
+    template<std::size_t N>
+    uint16_t tpm2b(Byte_block<N>& bytes)
+    {
+        uint16_t size=u16();
+        if (size>N || !available(size))
+        {
+            ok_=false;
+            return 0;
+        }
+        memcpy(bytes.data(),next_,size);
+        next_+=size;
+        return size;
+    }
+
+  private:
+    Byte const* next_;
+    Byte const* end_;
+    bool ok_=true;
+
+    bool available(std::size_t size)
+    {
+        ok_=ok_ && static_cast<std::size_t>(end_-next_)>=size;
+        return ok_;
+    }
+};
+
+// Send the command, the result is the TSS's error or the TPM's response code.
+// Each of the commands has one handle
+TPM_RC transmit(
+TSS_CONTEXT* tss_context,
+Byte const* command,
+uint32_t command_size,
+Byte* response,
+uint32_t* response_size,
+char const* message
+)
+{
+    TPM_RC rc=tss_transmit(tss_context,get_u32(command+handle_offset),get_u32(command+code_offset),
+                           response,response_size,command,command_size,message);
+    if (rc==0 && *response_size<header_size)
+    {
+        rc=TSS_RC_MALFORMED_RESPONSE;
+    }
+    return rc;
+}
+}
+
+TPM_RC raw_load_command(
+TPM_HANDLE parent_handle,
+std::string const& parent_auth,
+Byte_buffer const& public_data,
+Byte_buffer const& private_data,
+Raw_command* command
+)
+{
+    Command_writer writer(command);
+    writer.bytes(load_header);
+    writer.u32(parent_handle);
+    writer.password_session(parent_auth);
+    // Both are stored already marshalled as TPM2Bs, the private part comes first
+    writer.bytes(private_data.cdata(),private_data.size());
+    writer.bytes(public_data.cdata(),public_data.size());
+    return writer.finish();
+}
+
+TPM_RC raw_ecdsa_sign_command(
+TPM_HANDLE key_handle,
+std::string const& key_auth,
+Byte_buffer const& digest,
+Raw_command* command
+)
+{
+    Command_writer writer(command);
+    writer.bytes(sign_header);
+    writer.u32(key_handle);
+    writer.password_session(key_auth);
+    writer.tpm2b(digest.cdata(),digest.size());
+    writer.bytes(ecdsa_sha256_no_ticket);
+    return writer.finish();
+}
+
+void raw_set_handle(
+Raw_command* command,
+TPM_HANDLE handle
+)
+{
+    put_u32(command->buffer.data()+handle_offset,handle);
+}
+
+TPM_RC raw_load_key(
+TSS_CONTEXT* tss_context,
+Raw_command const& command,
+TPM_HANDLE* handle
+)
+{
+    std::array<Byte,MAX_RESPONSE_SIZE> response;
+    uint32_t response_size=0;
+    TPM_RC rc=transmit(tss_context,command.buffer.data(),command.size,response.data(),&response_size,"raw_load_key");
+    if (rc!=0)
+    {
+        return rc;
+    }
+
+    // Only the handle is needed, the name is not
+    Response_reader reader(response.data(),response_size);
+    *handle=reader.u32();
+    return reader.ok()?0:TSS_RC_MALFORMED_RESPONSE;
+}
+
+TPM_RC raw_ecdsa_sign(
+TSS_CONTEXT* tss_context,
+Raw_command const& command,
+Raw_ecdsa_signature* signature
+)
+{
+    std::array<Byte,MAX_RESPONSE_SIZE> response;
+    uint32_t response_size=0;
+    TPM_RC rc=transmit(tss_context,command.buffer.data(),command.size,response.data(),&response_size,"raw_ecdsa_sign");
+    if (rc!=0)
+    {
+        return rc;
+    }
+
+    Response_reader reader(response.data(),response_size);
+    reader.u32(); // parameter size
+    TPM_ALG_ID sig_alg=reader.u16();
+    reader.u16(); // hash
+    signature->r_size=reader.tpm2b(signature->r);
+    signature->s_size=reader.tpm2b(signature->s);
+    if (!reader.ok() || sig_alg!=TPM_ALG_ECDSA)
+    {
+        return TSS_RC_MALFORMED_RESPONSE;
+    }
+    return 0;
+}
+
+TPM_RC raw_flush_context(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle
+)
+{
+    auto command=flush_command;
+    put_u32(command.data()+handle_offset,handle);
+
+    std::array<Byte,MAX_RESPONSE_SIZE> response;
+    uint32_t response_size=0;
+    return transmit(tss_context,command.data(),static_cast<uint32_t>(command.size()),response.data(),&response_size,"raw_flush_context");
+}
@@ -0,0 +1,175 @@
+/*******************************************************************************
+* File:        Rp_key_usage.cpp
+* Description: Per-user usage statistics for the relying party keys, used to predict the keys to preload
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "Sha.h"
+#include "Rp_key_usage.h"
+
+namespace
+{
+constexpr uint32_t format_version = 1;
+
+uint32_t bb_to_uint32(Byte_buffer const &bb)
+{
+    if (bb.size() != 4) {
+        throw(std::runtime_error("Rp_key_usage: bad number in the usage data"));
+    }
+    return (static_cast<uint32_t>(bb[0]) << 24) | (static_cast<uint32_t>(bb[1]) << 16) | (static_cast<uint32_t>(bb[2]) << 8) | bb[3];
+}
+}// namespace
+
+void Rp_key_usage::record_use(Byte_buffer const &user_public_data, Byte_buffer const &public_data, Byte_buffer const &private_data)
+{
+    clock_++;
+    changed_ = true;
+
+    Byte_buffer user_digest = sha256_bb(user_public_data);
+    auto user = std::find_if(users_.begin(), users_.end(), [&user_digest](User const &u) { return u.user_digest == user_digest; });
+    if (user == users_.end()) {
+        if (users_.size() >= max_users) {
+            users_.erase(std::min_element(users_.begin(), users_.end(), [](User const &a, User const &b) { return a.last_use < b.last_use; }));
+        }
+        users_.push_back(User{ user_digest, 0, {} });
+        user = users_.end() - 1;
+    }
+    user->last_use = clock_;
+
+    Byte_buffer key_digest = sha256_bb(public_data);
+    auto entry = std::find_if(user->entries.begin(), user->entries.end(), [&key_digest](Entry const &e) { return e.key_digest == key_digest; });
+    if (entry != user->entries.end()) {
+        // The score carries on from where it had decayed to
+        entry->uses = static_cast<uint32_t>(std::lround(score(*entry))) + 1;
+        entry->last_use = clock_;
+        entry->key.private_data = private_data;
+        return;
+    }
+    if (user->entries.size() >= max_keys) {
+        user->entries.erase(std::min_element(user->entries.begin(), user->entries.end(),
+          [this](Entry const &a, Entry const &b) { return score(a) < score(b); }));
+    }
+    user->entries.push_back(Entry{ key_digest, Key{ public_data, private_data }, 1, clock_ });
+}
+
+std::vector<Rp_key_usage::Key> Rp_key_usage::predict(Byte_buffer const &user_public_data, size_t count) const
+{
+    Byte_buffer user_digest = sha256_bb(user_public_data);
+    auto user = std::find_if(users_.begin(), users_.end(), [&user_digest](User const &u) { return u.user_digest == user_digest; });
+    if (user == users_.end()) {
+        return {};
+    }
+
+    std::vector<Entry const *> ranked;
+    for (auto const &entry : user->entries) {
+        ranked.push_back(&entry);
+    }
+    count = std::min(count, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(count), ranked.end(),
+      [this](Entry const *a, Entry const *b) { return score(*a) > score(*b); });
+
+    std::vector<Key> keys;
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back(ranked[i]->key);
+    }
+    return keys;
+}
+
+Byte_buffer Rp_key_usage::serialise()
+{
+    std::vector<Byte_buffer> bbs{ uint32_to_bb(format_version), uint32_to_bb(clock_), uint32_to_bb(static_cast<uint32_t>(users_.size())) };
+    for (auto const &user : users_) {
+        bbs.push_back(user.user_digest);
+        bbs.push_back(uint32_to_bb(user.last_use));
+        bbs.push_back(uint32_to_bb(static_cast<uint32_t>(user.entries.size())));
+        for (auto const &entry : user.entries) {
+            bbs.push_back(entry.key.public_data);
+            bbs.push_back(entry.key.private_data);
+            bbs.push_back(uint32_to_bb(entry.uses));
+            bbs.push_back(uint32_to_bb(entry.last_use));
+        }
+    }
+    changed_ = false;
+    return serialise_byte_buffers(bbs);
+}
+
+void Rp_key_usage::deserialise(Byte_buffer const &bb)
+{
+    std::vector<Byte_buffer> bbs = deserialise_byte_buffers(bb);
+    size_t next = 0;
+    auto take = [&bbs, &next]() -> Byte_buffer const & {
+        if (next >= bbs.size()) {
+            throw(std::runtime_error("Rp_key_usage: the usage data is truncated"));
+        }
+        return bbs[next++];
+    };
+
+    if (bb_to_uint32(take()) != format_version) {
+        throw(std::runtime_error("Rp_key_usage: unknown usage data format"));
+    }
+    uint32_t clock = bb_to_uint32(take());
+    uint32_t user_count = bb_to_uint32(take());
+    std::vector<User> users;
+    for (uint32_t u = 0; u < user_count && u < max_users; ++u) {
+        User user;
+        user.user_digest = take();
+        user.last_use = bb_to_uint32(take());
+        uint32_t entry_count = bb_to_uint32(take());
+        for (uint32_t e = 0; e < entry_count && e < max_keys; ++e) {
+            Entry entry;
+            entry.key.public_data = take();
+            entry.key.private_data = take();
+            entry.key_digest = sha256_bb(entry.key.public_data);
+            entry.uses = bb_to_uint32(take());
+            entry.last_use = bb_to_uint32(take());
+            user.entries.push_back(entry);
+        }
+        users.push_back(user);
+    }
+
+    clock_ = clock;
+    users_ = std::move(users);
+    changed_ = false;
+}
+
+double Rp_key_usage::score(Entry const &entry) const
+{
+    return entry.uses * std::exp2(-static_cast<double>(clock_ - entry.last_use) / half_life);
+}
@@ -0,0 +1,175 @@
+/*******************************************************************************
+* File:        Span_tracer.cpp
+* Description: Records operations and TPM commands as spans, for a trace viewer
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <iomanip>
+#include "Request_scope.h"
+#include "Span_tracer.h"
+
+namespace
+{
+std::atomic<uint32_t> threads_numbered{ 0 };
+thread_local uint32_t thread_number = 0;
+// The spans open on the calling thread
+thread_local uint32_t open_spans = 0;
+
+uint32_t current_thread()
+{
+    if (thread_number == 0) {
+        thread_number = ++threads_numbered;
+    }
+    return thread_number;
+}
+
+// Fractional microseconds, so the viewer can order spans shorter than a microsecond
+double microseconds(Tpm_clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+void write_json_string(std::ostream &os, char const *str)
+{
+    os << '"';
+    for (char const *c = str; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            os << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            os << ' ';
+        } else {
+            os << *c;
+        }
+    }
+    os << '"';
+}
+}// namespace
+
+Span_tracer::Span::Span(Span_tracer &tracer, char const *name)
+  : tracer_(tracer.tracing() ? &tracer : nullptr), name_(name), depth_(open_spans++), start_(Tpm_clock::now())
+{
+}
+
+Span_tracer::Span::~Span()
+{
+    --open_spans;
+    if (tracer_ != nullptr) {
+        Request_context request = current_request();
+        tracer_->add(Event{ name_, 0, 0, request.id, request.tag, current_thread(), depth_, start_, Tpm_clock::now() });
+    }
+}
+
+void Span_tracer::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.clear();
+    dropped_ = 0;
+    epoch_ = Tpm_clock::now();
+    tracing_ = true;
+}
+
+void Span_tracer::stop()
+{
+    tracing_ = false;
+}
+
+void Span_tracer::command_completed(TPM_CC command, TPM_HANDLE /*handle*/, TPM_RC rc, Tpm_clock::time_point start,
+  Tpm_clock::time_point end)
+{
+    if (!tracing()) {
+        return;
+    }
+    Request_context request = current_request();
+    add(Event{ nullptr, command, rc, request.id, request.tag, current_thread(), open_spans, start, end });
+}
+
+void Span_tracer::add(Event const &event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!tracing()) {
+        return;
+    }
+    if (events_.size() == capacity) {
+        ++dropped_;
+        return;
+    }
+    events_.push_back(event);
+}
+
+std::vector<Span_tracer::Event> Span_tracer::events() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return events_;
+}
+
+void Span_tracer::write_chrome_trace(std::ostream &os) const
+{
+    std::vector<Event> events;
+    Tpm_clock::time_point epoch;
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events = events_;
+        epoch = epoch_;
+        dropped = dropped_;
+    }
+
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":" << dropped << "},\"traceEvents\":[";
+    char const *separator = "\n";
+    for (auto const &e : events) {
+        os << separator << "{\"name\":";
+        write_json_string(os, e.name != nullptr ? e.name : tpm_command_name(e.command));
+        os << ",\"cat\":\"" << (e.name != nullptr ? "operation" : "tpm") << "\",\"ph\":\"X\""
+           << ",\"ts\":" << microseconds(e.start - epoch) << ",\"dur\":" << microseconds(e.end - e.start)
+           << ",\"pid\":1,\"tid\":" << e.thread << ",\"args\":{\"depth\":" << e.depth;
+        if (e.request_id != 0) {
+            os << ",\"request\":\"0x" << std::hex << e.request_id << '/' << std::dec << e.request_tag << '"';
+        }
+        if (e.name == nullptr) {
+            os << ",\"command\":\"0x" << std::hex << e.command << "\",\"rc\":\"0x" << e.rc << '"' << std::dec;
+        }
+        os << "}}";
+        separator = ",\n";
+    }
+    os << "\n]}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -42,6 +42,7 @@
 #include <ctime>
 #include <string>
 #include "Tss_includes.h"
+#include "Tss_execute.h"
 #include "Io_utils.h"
 #include "Logging.h"
 #include "Tpm_error.h"
@@ -82,13 +83,13 @@ TPM_RC powerup(Tss_setup const &tps)
     return rc;
 }
 
-TPM_RC startup(TSS_CONTEXT *tss_context)
+TPM_RC startup(TSS_CONTEXT *tss_context, TPM_SU startup_type)
 {
     TPM_RC rc = 0;
 
     Startup_In in;
-    in.startupType = TPM_SU_CLEAR;
-    rc = TSS_Execute(tss_context,
+    in.startupType = startup_type;
+    rc = tss_execute(tss_context, 0,
       nullptr,
       reinterpret_cast<COMMAND_PARAMETERS *>(&in),
       nullptr,
@@ -100,13 +101,13 @@ TPM_RC startup(TSS_CONTEXT *tss_context)
     return rc;
 }
 
-TPM_RC shutdown(TSS_CONTEXT *tss_context)
+TPM_RC shutdown(TSS_CONTEXT *tss_context, TPM_SU shutdown_type)
 {
     TPM_RC rc = TPM_RC_SUCCESS;
 
     Shutdown_In in;
-    in.shutdownType = TPM_SU_CLEAR;
-    rc = TSS_Execute(tss_context,
+    in.shutdownType = shutdown_type;
+    rc = tss_execute(tss_context, 0,
       nullptr,
       reinterpret_cast<COMMAND_PARAMETERS *>(&in),
       nullptr,
@@ -129,7 +130,7 @@ bool persistent_key_available(TSS_CONTEXT *tss_context, TPM_HANDLE handle)
     in.capability = TPM_CAP_TPM_PROPERTIES;
     in.property = TPM_PT_HR_PERSISTENT;
     in.propertyCount = 1;
-    rc = TSS_Execute(tss_context,
+    rc = tss_execute(tss_context, 0,
       reinterpret_cast<RESPONSE_PARAMETERS *>(&out),
       reinterpret_cast<COMMAND_PARAMETERS *>(&in),
       nullptr,
@@ -156,6 +157,30 @@ bool persistent_key_available(TSS_CONTEXT *tss_context, TPM_HANDLE handle)
     return key_available;
 }
 
+TPM_RC transient_slots_available(TSS_CONTEXT *tss_context, uint32_t *available)
+{
+    GetCapability_In in;
+    GetCapability_Out out;
+    in.capability = TPM_CAP_TPM_PROPERTIES;
+    in.property = TPM_PT_HR_TRANSIENT_AVAIL;
+    in.propertyCount = 1;
+    TPM_RC rc = tss_execute(tss_context, 0,
+      reinterpret_cast<RESPONSE_PARAMETERS *>(&out),
+      reinterpret_cast<COMMAND_PARAMETERS *>(&in),
+      nullptr,
+      TPM_CC_GetCapability,
+      TPM_RH_NULL,
+      NULL,
+      0);
+    if (rc != 0) {
+        return rc;
+    }
+
+    auto const &properties = out.capabilityData.data.tpmProperties;
+    *available = (properties.count == 1 && properties.tpmProperty[0].property == TPM_PT_HR_TRANSIENT_AVAIL) ? properties.tpmProperty[0].value : 0;
+    return 0;
+}
+
 std::vector<TPM_HANDLE> retrieve_persistent_handles(TSS_CONTEXT *tss_context, uint32_t ph_count)
 {
     //!!!!!!!Need to fix this for the case where there is more data
@@ -171,7 +196,7 @@ std::vector<TPM_HANDLE> retrieve_persistent_handles(TSS_CONTEXT *tss_context, ui
     in.capability = TPM_CAP_HANDLES;
     in.property = static_cast<uint32_t>(TPM_HT_PERSISTENT) << 24;
     in.propertyCount = ph_count;
-    rc = TSS_Execute(tss_context,
+    rc = tss_execute(tss_context, 0,
       reinterpret_cast<RESPONSE_PARAMETERS *>(&out),
       reinterpret_cast<COMMAND_PARAMETERS *>(&in),
       nullptr,
@@ -0,0 +1,131 @@
+/*******************************************************************************
+* File:        Tpm_status.cpp
+* Description: Exception-free error reporting for the TPM calls
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <string>
+#include "Io_utils.h"
+#include "Tpm_error.h"
+#include "Tpm_status.h"
+
+// Only the TPM layer's codes are classified, bits 16-23 of a TSS code are non-zero
+static constexpr TPM_RC rc_layer_mask = 0xff0000;
+
+static Web_authn_error classify_tpm_rc(TPM_RC rc)
+{
+    if ((rc & rc_layer_mask) != 0) {
+        return Web_authn_error::tss_error;
+    }
+
+    if ((rc & RC_FMT1) != 0) {
+        // Remove the parameter, handle or session number
+        switch (rc & (RC_FMT1 | 0x3f)) {
+        case TPM_RC_AUTH_FAIL:
+        case TPM_RC_BAD_AUTH:
+        case TPM_RC_POLICY_FAIL:
+            return Web_authn_error::auth_failed;
+        case TPM_RC_HANDLE:
+            return Web_authn_error::key_not_loaded;
+        case TPM_RC_INTEGRITY:
+            return Web_authn_error::bad_key_blob;
+        default:
+            return Web_authn_error::tpm_error;
+        }
+    }
+
+    if (rc >= TPM_RC_REFERENCE_H0 && rc <= TPM_RC_REFERENCE_H6) {
+        return Web_authn_error::key_not_loaded;
+    }
+    switch (rc) {
+    case TPM_RC_LOCKOUT:
+        return Web_authn_error::lockout;
+    case TPM_RC_RETRY:
+    case TPM_RC_YIELDED:
+    case TPM_RC_TESTING:
+    case TPM_RC_CANCELED:
+    case TPM_RC_NV_RATE:
+    case TPM_RC_NV_UNAVAILABLE:
+    case TPM_RC_OBJECT_MEMORY:
+    case TPM_RC_SESSION_MEMORY:
+    case TPM_RC_OBJECT_HANDLES:
+        return Web_authn_error::tpm_busy;
+    default:
+        return Web_authn_error::tpm_error;
+    }
+}
+
+Web_authn_error Tpm_status::error() const
+{
+    if (ok()) {
+        return Web_authn_error::ok;
+    }
+    if (error_ != Web_authn_error::ok) {
+        return error_;
+    }
+    // The key data is checked by the TSS before it gets to the TPM
+    if (stage_ == Web_authn_stage::unmarshal) {
+        return Web_authn_error::bad_key_blob;
+    }
+    return classify_tpm_rc(rc_);
+}
+
+Web_authn_status Tpm_status::web_authn_status() const
+{
+    Web_authn_status status{ error(), stage_, rc_, (rc_ & rc_layer_mask) >> 16, 0, 0, 0 };
+    if ((rc_ & rc_layer_mask) == 0 && (rc_ & RC_FMT1) != 0) {
+        uint32_t number = (rc_ & TPM_RC_N_MASK) >> 8;
+        if ((rc_ & TPM_RC_P) != 0) {
+            status.rc_parameter = number;
+        } else if ((rc_ & TPM_RC_S) != 0) {
+            status.rc_session = number & 0x7;
+        } else {
+            status.rc_handle = number & 0x7;
+        }
+    }
+    return status;
+}
+
+std::string Tpm_status::message() const
+{
+    if (ok()) {
+        return "No error";
+    }
+    if (rc_ == 0) {
+        return vars_to_string(op(), ": ", what());
+    }
+    return vars_to_string(op(), ": ", what(), ": ", get_tpm_error(rc_));
+}
@@ -45,6 +45,7 @@
 #include "Ibmtss_helpers.h"
 #include "Io_utils.h"
 #include "Tpm_error.h"
+#include "Tss_execute.h"
 #include "Tpm_utils.h"
 
 // Can be replaced by tpm2b_to_bb, but keep this for now
@@ -146,7 +147,7 @@ std::ostream& os
     ECC_Parameters_In ep_in;
     ECC_Parameters_Out ep_out;
     ep_in.curveID=curve_id;
-	rc = TSS_Execute(tss_context,
+	rc = tss_execute(tss_context, 0,
 		reinterpret_cast<RESPONSE_PARAMETERS *>(&ep_out),
 		reinterpret_cast<COMMAND_PARAMETERS *>(&ep_in),
 		nullptr,
@@ -0,0 +1,140 @@
+/*******************************************************************************
+* File:        Tss_execute.cpp
+* Description: Sends TPM commands, reporting each one to an observer
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "Tss_execute.h"
+
+namespace
+{
+// There are only ever a few contexts, so a vector is searched
+std::mutex observers_mutex;
+std::vector<std::pair<TSS_CONTEXT*,Tpm_command_observer*>> observers;
+}
+
+void set_command_observer(
+TSS_CONTEXT* tss_context,
+Tpm_command_observer* observer
+)
+{
+    std::lock_guard<std::mutex> lock(observers_mutex);
+    for (auto it=observers.begin();it!=observers.end();++it)
+    {
+        if (it->first==tss_context)
+        {
+            if (observer==nullptr)
+            {
+                observers.erase(it);
+            }
+            else
+            {
+                it->second=observer;
+            }
+            return;
+        }
+    }
+    if (observer!=nullptr)
+    {
+        observers.emplace_back(tss_context,observer);
+    }
+}
+
+Tpm_command_observer* command_observer(
+TSS_CONTEXT* tss_context
+)
+{
+    std::lock_guard<std::mutex> lock(observers_mutex);
+    for (auto const& o : observers)
+    {
+        if (o.first==tss_context)
+        {
+            return o.second;
+        }
+    }
+    return nullptr;
+}
+
+TPM_RC tss_transmit(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle,
+TPM_CC command,
+uint8_t* response,
+uint32_t* read,
+uint8_t const* command_buffer,
+uint32_t written,
+char const* message
+)
+{
+    Tpm_command_observer* observer=command_observer(tss_context);
+    if (observer==nullptr)
+    {
+        return TSS_Transmit(tss_context,response,read,command_buffer,written,message);
+    }
+    auto start=Tpm_clock::now();
+    observer->command_started(command,handle,start);
+    TPM_RC rc=TSS_Transmit(tss_context,response,read,command_buffer,written,message);
+    observer->command_completed(command,handle,rc,start,Tpm_clock::now());
+    return rc;
+}
+
+char const* tpm_command_name(
+TPM_CC command
+)
+{
+    // The commands the library sends
+    switch (command)
+    {
+        case TPM_CC_Startup:        return "Startup";
+        case TPM_CC_Shutdown:       return "Shutdown";
+        case TPM_CC_GetCapability:  return "GetCapability";
+        case TPM_CC_ReadPublic:     return "ReadPublic";
+        case TPM_CC_CreatePrimary:  return "CreatePrimary";
+        case TPM_CC_Create:         return "Create";
+        case TPM_CC_Load:           return "Load";
+        case TPM_CC_Sign:           return "Sign";
+        case TPM_CC_EvictControl:   return "EvictControl";
+        case TPM_CC_FlushContext:   return "FlushContext";
+        case TPM_CC_ContextSave:    return "ContextSave";
+        case TPM_CC_ContextLoad:    return "ContextLoad";
+        case TPM_CC_ECC_Parameters: return "ECC_Parameters";
+        default:                    return "Unknown";
+    }
+}
@@ -43,6 +43,8 @@
 #include <chrono>
 #include <array>
 #include <fstream>
+#include <utility>
+#include <vector>
 #include "Tss_setup.h"
 #include "Web_authn_structures.h"
 #include "Web_authn_tpm.h"
@@ -60,8 +62,6 @@ void *install_tpm()
     return v_ptr;
 }
 
-#define WEB_AUTHN_ERROR uint32_t(-1)// Define this properly later to not clash with other return values
-
 TPM_RC setup_tpm(void *v_tpm_ptr, bool use_hw_tpm, const char *tpm_data_dir, const char *log_filename)
 {
     if (v_tpm_ptr == nullptr) {
@@ -92,6 +92,72 @@ TPM_RC set_log_level(void *v_tpm_ptr, int log_level)
     return tpm_ptr->set_log_level(log_level);
 }
 
+TPM_RC set_component_log_level(void *v_tpm_ptr, int component, int log_level)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_component_log_level(component, log_level);
+}
+
+TPM_RC set_debug_sampling(void *v_tpm_ptr, uint32_t one_in)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_debug_sampling(one_in);
+}
+
+TPM_RC set_request_context(void *v_tpm_ptr, Request_context const *request)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_request_context(request);
+}
+
+TPM_RC set_preserve_state(void *v_tpm_ptr, bool preserve_state)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_preserve_state(preserve_state);
+}
+
+TPM_RC set_tss_state_in_memory(void *v_tpm_ptr, bool in_memory)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_tss_state_in_memory(in_memory);
+}
+
+TPM_RC set_require_key_blob_tags(void *v_tpm_ptr, bool require_tags)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_require_key_blob_tags(require_tags);
+}
+
 const char *get_last_error(void *v_tpm_ptr)
 {
     if (v_tpm_ptr == nullptr) {
@@ -100,11 +166,124 @@ const char *get_last_error(void *v_tpm_ptr)
 
     auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
 
-    static std::string last_error = tpm_ptr->get_last_error();
+    // Keeps the string alive for the caller until the next call on this thread
+    thread_local std::string last_error;
+    last_error = tpm_ptr->get_last_error();
 
     return last_error.c_str();
 }
 
+TPM_RC get_last_status(void *v_tpm_ptr, Web_authn_status *status)
+{
+    if (v_tpm_ptr == nullptr || status == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    *status = tpm_ptr->get_last_status();
+
+    return 0;
+}
+
+const char *get_flight_record(void *v_tpm_ptr)
+{
+    if (v_tpm_ptr == nullptr) {
+        return "NULL pointer passed for the TPM";
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    // Keeps the string alive for the caller until the next call on this thread
+    thread_local std::string flight_record;
+    flight_record = tpm_ptr->get_flight_record();
+
+    return flight_record.c_str();
+}
+
+TPM_RC dump_flight_record(void *v_tpm_ptr)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    tpm_ptr->dump_flight_record();
+
+    return 0;
+}
+
+TPM_RC set_tracing(void *v_tpm_ptr, bool tracing)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_tracing(tracing);
+}
+
+TPM_RC write_trace(void *v_tpm_ptr, const char *filename)
+{
+    if (v_tpm_ptr == nullptr || filename == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->write_trace(filename);
+}
+
+TPM_RC set_command_budget(void *v_tpm_ptr, uint32_t command_code, uint32_t budget_ms)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_command_budget(command_code, budget_ms);
+}
+
+TPM_RC set_slow_command_callback(void *v_tpm_ptr, Slow_command_callback callback, void *user_data)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->set_slow_command_callback(callback, user_data);
+}
+
+TPM_RC get_command_stats(void *v_tpm_ptr, uint32_t command_code, Tpm_command_stats *stats)
+{
+    if (v_tpm_ptr == nullptr || stats == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    *stats = tpm_ptr->get_command_stats(command_code);
+
+    return 0;
+}
+
+TPM_RC get_request_stats(void *v_tpm_ptr, uint64_t request_id, Tpm_request_stats *stats)
+{
+    if (v_tpm_ptr == nullptr || stats == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    *stats = tpm_ptr->get_request_stats(request_id);
+
+    return 0;
+}
+
 Key_data create_and_load_user_key(void *v_tpm_ptr, Byte_array user, Byte_array key_auth)
 {
     if (v_tpm_ptr == nullptr) {
@@ -161,6 +340,32 @@ Key_ecc_point load_rp_key(void *v_tpm_ptr, Key_data kd, Byte_array relying_party
     return tpm_ptr->load_rp_key(kd, rp_str, user_auth_str);
 }
 
+TPM_RC preload_rp_keys(void *v_tpm_ptr, Byte_array user_auth, uint32_t count)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    std::string user_auth_str = byte_array_to_string(user_auth);
+
+    return tpm_ptr->preload_rp_keys(user_auth_str, count);
+}
+
+TPM_RC get_preload_stats(void *v_tpm_ptr, Rp_key_preload_stats *stats)
+{
+    if (v_tpm_ptr == nullptr || stats == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    *stats = tpm_ptr->get_preload_stats();
+
+    return 0;
+}
+
 Ecdsa_sig sign_using_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_array signing_data, Byte_array rp_key_auth)
 {
     if (v_tpm_ptr == nullptr) {
@@ -176,6 +381,49 @@ Ecdsa_sig sign_using_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_arra
     return tpm_ptr->sign_using_rp_key(rp_str, digest_to_sign, rp_key_auth_str);
 }
 
+Ecdsa_sig begin_assertions(void *v_tpm_ptr, uint64_t channel, uint32_t count, Key_data const *keys,
+  Byte_array const *rp_key_auths, Byte_array const *digests, Byte_array user_auth)
+{
+    if (v_tpm_ptr == nullptr || keys == nullptr || rp_key_auths == nullptr || digests == nullptr) {
+        return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    std::vector<Assertion_credential> credentials;
+    credentials.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        credentials.push_back(Assertion_credential{ byte_array_to_bb(keys[i].public_data), byte_array_to_bb(keys[i].private_data),
+          byte_array_to_string(rp_key_auths[i]), byte_array_to_bb(digests[i]) });
+    }
+    std::string user_auth_str = byte_array_to_string(user_auth);
+
+    return tpm_ptr->begin_assertions(channel, std::move(credentials), user_auth_str);
+}
+
+Ecdsa_sig next_assertion(void *v_tpm_ptr, uint64_t channel)
+{
+    if (v_tpm_ptr == nullptr) {
+        return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+
+    return tpm_ptr->next_assertion(channel);
+}
+
+TPM_RC end_assertions(void *v_tpm_ptr)
+{
+    if (v_tpm_ptr == nullptr) {
+        return WEB_AUTHN_ERROR;
+    }
+
+    auto *tpm_ptr = reinterpret_cast<Web_authn_tpm *>(v_tpm_ptr);
+    tpm_ptr->end_assertions();
+
+    return 0;
+}
+
 TPM_RC flush_data(void *v_tpm_ptr)
 {
     if (v_tpm_ptr == nullptr) {
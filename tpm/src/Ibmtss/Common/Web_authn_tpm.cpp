@@ -37,13 +37,23 @@
 *                                                                              *
 *******************************************************************************/
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
 #include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <openssl/crypto.h>
 #include "Tss_includes.h"
 #include "Tss_setup.h"
 #include "Ibmtss_helpers.h"
@@ -51,12 +61,17 @@
 #include "Flush_context.h"
 #include "Io_utils.h"
 #include "Tpm_error.h"
+#include "Tpm_status.h"
 #include "Create_primary_rsa_key.h"
 #include "Create_storage_key.h"
 #include "Create_ecdsa_key.h"
 #include "Load_key.h"
 #include "Ecdsa_sign.h"
 #include "Marshal_data.h"
+#include "Raw_command.h"
+#include "Context_save.h"
+#include "Key_blob_tag.h"
+#include "Hmac.h"
 #include "Openssl_ec_utils.h"
 #include "Clock_utils.h"
 #include "Tss_setup.h"
@@ -65,28 +80,132 @@
 #include "Tpm_timer.h"
 #include "Tpm_param.h"
 #include "Byte_array.h"
+#include "Assertion_iterator.h"
+#include "Flight_recorder.h"
+#include "Request_scope.h"
 #include "Web_authn_structures.h"
 #include "Web_authn_tpm.h"
 
+// The contexts saved by a state preserving shutdown, in the data directory
+constexpr char saved_contexts_filename[] = "saved_contexts.txt";
+constexpr char key_blob_tag_key_filename[] = "key_blob_tag_key.txt";
+constexpr char rp_key_usage_filename[] = "rp_key_usage.txt";
+
+namespace
+{
+#if !defined(TPM_TSS_NOFILE)
+// A directory only this process can use, on tmpfs if there is one
+std::string make_tmpfs_dir()
+{
+    std::string base = std::filesystem::is_directory("/dev/shm") ? "/dev/shm" : std::filesystem::temp_directory_path().string();
+    std::string dir = base + "/watpm-XXXXXX";
+    if (mkdtemp(dir.data()) == nullptr) {
+        throw(std::runtime_error(vars_to_string("Unable to create a directory for the TSS state in ", base)));
+    }
+    return dir;
+}
+#endif
+
+// Moves the files the TSS keeps for a saved context, between its directory and the data directory
+void move_tss_files(Byte_buffer const &context_blob, std::string const &from, std::string const &to)
+{
+    for (auto const &file : context_tss_files(context_blob)) {
+        std::error_code ec;
+        std::filesystem::copy_file(make_filename(from, file), make_filename(to, file), std::filesystem::copy_options::overwrite_existing, ec);
+        std::filesystem::remove(make_filename(from, file), ec);
+    }
+}
+
+// Writes the data, in hex, to a file only the owner can read. It is written to a temporary file, created
+// with only the owner's permissions, and renamed over the file, so the data is never readable by others
+bool write_private_file(std::string const &filename, Byte_buffer const &data)
+{
+    std::string contents = vars_to_string(data, '\n');
+    std::string temp_filename = filename + ".XXXXXX";
+    int fd = mkstemp(temp_filename.data());
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    bool ok = written == contents.size() && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The authenticator's key for the key blob tags, created the first time the data directory is used
+Byte_buffer read_key_blob_tag_key(std::string const &data_dir)
+{
+    std::string filename = make_filename(data_dir, key_blob_tag_key_filename);
+    Byte_buffer tag_key;
+    std::ifstream is(filename);
+    if (is) {
+        is >> tag_key;
+        if (tag_key.size() == key_blob_tag_key_bytes) {
+            return tag_key;
+        }
+        throw(std::runtime_error(vars_to_string("The key blob tag key in ", filename, " is corrupt")));
+    }
+
+    tag_key = new_key_blob_tag_key();
+    if (!write_private_file(filename, tag_key)) {
+        throw(std::runtime_error(vars_to_string("Unable to write the key blob tag key to ", filename)));
+    }
+    return tag_key;
+}
+}// namespace
+
 
 TPM_RC Web_authn_tpm::setup(Tss_setup const &tps, std::string const &log_filename)
 {
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording("setup");
+    Span_tracer::Span span(span_tracer_, "setup");
     TPM_RC rc = 0;
     try {
         std::string filename = generate_date_time_log_filename(tps.data_dir.value, log_filename);
         log_ptr_ = std::make_unique<Timed_file_log>(filename);
-        log_ptr_->set_log_level(log_level_);
+        log_ptr_->set_log_level(log_levels_[static_cast<size_t>(Log_component::setup)]);
         data_dir_ = std::string(tps.data_dir.value);
 
-        log(Log_level::error, "TPM setup started");
+        log(Log_component::setup, Log_level::error, "TPM setup started");
+
+        key_blob_tag_key_ = read_key_blob_tag_key(data_dir_);
+        auth_digest_key_ = hmac_sha256(key_blob_tag_key_, Byte_buffer(std::string("user key authorisation")));
+        std::ifstream usage_is(make_filename(data_dir_, rp_key_usage_filename));
+        if (usage_is) {
+            try {
+                Byte_buffer usage_bb;
+                usage_is >> usage_bb;
+                rp_key_usage_.deserialise(usage_bb);
+            } catch (std::runtime_error &e) {
+                log(Log_component::storage, Log_level::error, "The relying party key usage is corrupt, starting again: ", e.what());
+            }
+        }
 
-        log(Log_level::info, vars_to_string("Debug level set to: ", log_level_to_string(log_level_)));
+        log(Log_component::setup, Log_level::info, "Debug levels set to: setup: ", log_level_to_string(log_levels_[0]),
+          ", keys: ", log_level_to_string(log_levels_[1]), ", sign: ", log_level_to_string(log_levels_[2]),
+          ", tss: ", log_level_to_string(log_levels_[3]), ", storage: ", log_level_to_string(log_levels_[4]),
+          ", debug sampling: 1 in ", debug_sample_one_in_.load());
 
         hw_tpm_ = (tps.t == Tpm_type::device);
         if (!hw_tpm_) {
             rc = powerup(tps);
             if (rc != 0) {
-                log(Log_level::error, "Web_authn_tpm: setup: Simulator powerup failed");
+                log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: Simulator powerup failed");
                 throw(Tpm_error("Simulator powerup failed\n"));
             }
         }
@@ -94,18 +213,32 @@ TPM_RC Web_authn_tpm::setup(Tss_setup const &tps, std::string const &log_filenam
         auto nc = set_new_context(tps);
         rc = nc.first;
         if (rc != 0) {
-            log(Log_level::error, "Web_authn_tpm: setup: failed to create a TSS context");
+            log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: failed to create a TSS context");
             throw(Tpm_error("Web_authn_tpm: setup: failed to create a TSS context\n"));
         }
         tss_context_ = nc.second;
+        latency_watchdog_.set_event_handler([this](Latency_watchdog::Slow_command const &slow) { log_slow_command(slow); });
+        set_command_observer(tss_context_, &command_observers_);
         // Fix the data directory to point to a character array inside the class
         // (a fix for now as Tss_setup wasn't designed for this)
-        rc = TSS_SetProperty(tss_context_, TPM_DATA_DIR, data_dir_.c_str());
-
-        rc = startup(tss_context_);
+#if !defined(TPM_TSS_NOFILE)
+        if (tss_state_in_memory_ && tss_state_dir_.empty()) {
+            tss_state_dir_ = make_tmpfs_dir();
+            // The TSS still uses files for its state, only on tmpfs
+            log(Log_component::setup, Log_level::info, "TSS state files kept in ", tss_state_dir_);
+        }
+#endif
+        rc = TSS_SetProperty(tss_context_, TPM_DATA_DIR, tss_state_dir_.empty() ? data_dir_.c_str() : tss_state_dir_.c_str());
+
+        rc = startup(tss_context_, preserve_state_ ? TPM_SU_STATE : TPM_SU_CLEAR);
+        if (preserve_state_ && rc != 0 && rc != TPM_RC_INITIALIZE) {
+            // There was no state preserving shutdown to resume from
+            log(Log_component::setup, Log_level::info, "Unable to resume the TPM's state: ", get_tpm_error(rc));
+            rc = startup(tss_context_);
+        }
         if (rc != 0 && rc != TPM_RC_INITIALIZE) {
             shutdown(tss_context_);
-            log(Log_level::error, "Web_authn_tpm: setup: TPM startup failed (reset the TPM)");
+            log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: TPM startup failed (reset the TPM)");
             throw(Tpm_error("TPM startup failed (reset the TPM)"));
         }
 
@@ -117,32 +250,43 @@ TPM_RC Web_authn_tpm::setup(Tss_setup const &tps, std::string const &log_filenam
             rc = create_primary_rsa_key(tss_context_, TPM_RH_OWNER, object_attributes, Byte_buffer(), &out);
             if (rc != 0) {
                 err = vars_to_string("Creating the primary key failed: ", get_tpm_error(rc));
-                log(Log_level::error, "Web_authn_tpm: setup: " + err);
+                log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: ", err);
                 throw Tpm_error(err.c_str());
             }
-            log(Log_level::debug, "Primary key created");
+            log(Log_component::setup, Log_level::debug, "Primary key created");
             rc = make_key_persistent(tss_context_, out.objectHandle, srk_persistent_handle);
             if (rc != 0) {
                 err = vars_to_string("Making the primary key persistent failed: ", get_tpm_error(rc));
-                log(Log_level::error, "Web_authn_tpm: setup: " + err);
+                log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: ", err);
+                throw Tpm_error(err.c_str());
+            }
+            log(Log_component::setup, Log_level::debug, "Primary key made persistent");
+            // The persistent copy is used from now on, free the transient object slot
+            rc = flush_context(tss_context_, out.objectHandle);
+            if (rc != 0) {
+                err = vars_to_string("Flushing the transient primary key failed: ", get_tpm_error(rc));
+                log(Log_component::setup, Log_level::error, "Web_authn_tpm: setup: ", err);
                 throw Tpm_error(err.c_str());
             }
-            log(Log_level::debug, "Primary key made persistent");
         } else {
-            log(Log_level::debug, "Primary key already installed");
+            log(Log_component::setup, Log_level::debug, "Primary key already installed");
+        }
+
+        if (preserve_state_) {
+            restore_contexts();
         }
     } catch (Tpm_error &e) {
         rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: setup: Tpm_error: ", e.what());
+        set_error("setup", vars_to_string("Tpm_error: ", e.what()), Web_authn_stage::setup, Web_authn_error::tpm_error);
     } catch (std::runtime_error &e) {
         rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: setup: runtime_error: ", e.what());
+        set_error("setup", vars_to_string("runtime_error: ", e.what()), Web_authn_stage::setup);
     } catch (...) {
         rc = 3;
-        last_error_ = "Web_authn_tpm: setup: failed - uncaught exception";
+        set_error("setup", "failed - uncaught exception", Web_authn_stage::setup);
     }
 
-    log(Log_level::info, vars_to_string("TPM setup completed with rc=", rc));
+    log(Log_component::setup, Log_level::info, "TPM setup completed with rc=", rc);
 
     return rc;
 }
@@ -152,64 +296,130 @@ TPM_RC Web_authn_tpm::set_log_level(int log_level)
     TPM_RC rc = 0;
 
     if (!log_level_ok(log_level)) {// Change this if the options change
-        last_error_ = vars_to_string("Invalid value for the log level: ", log_level, ". Should be between ", static_cast<int>(Log_level::error), " and ", static_cast<int>(Log_level::debug), ".");
-        log(Log_level::error, last_error_);
+        set_error("set_log_level", vars_to_string("Invalid value for the log level: ", log_level, ". Should be between ", static_cast<int>(Log_level::error), " and ", static_cast<int>(Log_level::debug), "."),
+          Web_authn_stage::none, Web_authn_error::bad_parameter);
         rc = 1;
     } else {
-        log_level_ = static_cast<Log_level>(log_level);
+        for (auto &level : log_levels_) {
+            level = static_cast<Log_level>(log_level);
+        }
     }
 
     return rc;
 }
 
-Key_data Web_authn_tpm::create_and_load_user_key(std::string const &user, std::string const &authorisation)
+TPM_RC Web_authn_tpm::set_component_log_level(int component, int log_level)
 {
-    log(Log_level::info, "create_and_load_user_key");
-    log(Log_level::debug, vars_to_string("User: ", user));
+    TPM_RC rc = 0;
 
+    if (component < 0 || component >= log_component_count) {
+        set_error("set_component_log_level", vars_to_string("Invalid value for the log component: ", component, ". Should be between 0 and ", log_component_count - 1, "."),
+          Web_authn_stage::none, Web_authn_error::bad_parameter);
+        rc = 1;
+    } else if (!log_level_ok(log_level)) {
+        set_error("set_component_log_level", vars_to_string("Invalid value for the log level: ", log_level, ". Should be between ", static_cast<int>(Log_level::error), " and ", static_cast<int>(Log_level::debug), "."),
+          Web_authn_stage::none, Web_authn_error::bad_parameter);
+        rc = 1;
+    } else {
+        log_levels_[static_cast<size_t>(component)] = static_cast<Log_level>(log_level);
+    }
+
+    return rc;
+}
+
+TPM_RC Web_authn_tpm::set_debug_sampling(uint32_t one_in)
+{
     TPM_RC rc = 0;
+
+    if (one_in == 0) {
+        set_error("set_debug_sampling", "Invalid value for the debug sampling: 0. Should be 1 or more.",
+          Web_authn_stage::none, Web_authn_error::bad_parameter);
+        rc = 1;
+    } else {
+        debug_sample_one_in_ = one_in;
+    }
+
+    return rc;
+}
+
+TPM_RC Web_authn_tpm::set_request_context(Request_context const *request)
+{
+    request_ = request == nullptr ? Request_context{ 0, 0 } : *request;
+    return 0;
+}
+
+TPM_RC Web_authn_tpm::set_preserve_state(bool preserve_state)
+{
+    preserve_state_ = preserve_state;
+    log(Log_component::setup, Log_level::info, "Preserve the TPM's state at shutdown: ", preserve_state_);
+    return 0;
+}
+
+TPM_RC Web_authn_tpm::set_tss_state_in_memory(bool in_memory)
+{
+    tss_state_in_memory_ = in_memory;
+    log(Log_component::setup, Log_level::info, "Keep the TSS's state in memory: ", tss_state_in_memory_);
+    return 0;
+}
+
+TPM_RC Web_authn_tpm::set_require_key_blob_tags(bool require_tags)
+{
+    require_key_blob_tags_ = require_tags;
+    log(Log_component::setup, Log_level::info, "Reject key blobs without a tag: ", require_key_blob_tags_);
+    return 0;
+}
+
+Key_data Web_authn_tpm::create_and_load_user_key(std::string const &user, std::string const &authorisation)
+{
+    static constexpr char const *op = "create_and_load_user_key";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::keys, Log_level::info, op);
+    log(Log_component::keys, Log_level::debug, "User: ", user);
+
     try {
-        flush_user_key();
-        std::string error;
+        Tpm_status status = flush_user_key();
+        if (!status.ok()) {
+            set_error(status);
+            return Key_data{ { 0, nullptr }, { 0, nullptr } };
+        }
+
         Create_Out out;
-        rc = create_storage_key(tss_context_, srk_persistent_handle, authorisation, &out);
+        TPM_RC rc = create_storage_key(tss_context_, srk_persistent_handle, authorisation, &out);
         if (rc != 0) {
-            error = vars_to_string("Unable to create the user key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+            set_error(Tpm_status(op, Web_authn_stage::create, "Unable to create the user key", rc));
+            return Key_data{ { 0, nullptr }, { 0, nullptr } };
         }
-        log(Log_level::debug, "User key created");
+        log(Log_component::keys, Log_level::debug, "User key created");
 
         Load_Out load_out;
         rc = load_key(tss_context_, "", srk_persistent_handle, out.outPublic, out.outPrivate, &load_out);
         if (rc != 0) {
-            error = vars_to_string("Unable to load the user key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+            set_error(Tpm_status(op, Web_authn_stage::load, "Unable to load the user key", rc));
+            return Key_data{ { 0, nullptr }, { 0, nullptr } };
         }
 
         user_handle_ = load_out.objectHandle;
-        log(Log_level::info, vars_to_string("User key loaded, handle: ", std::hex, user_handle_));
+        log(Log_component::keys, Log_level::info, "User key loaded, handle: ", std::hex, user_handle_);
+
+        flush_restored_keys(user_handle_);
 
         Byte_buffer public_data_bb = marshal_public_data_B(&out.outPublic);
-        log(Log_level::debug, vars_to_string("User's public data: ", public_data_bb));
+        log(Log_component::keys, Log_level::debug, "User's public data: ", public_data_bb);
+        user_public_data_ = public_data_bb;
         Byte_buffer private_data_bb = marshal_private_data_B(&out.outPrivate);
-        log(Log_level::debug, vars_to_string("User's private data: ", private_data_bb));
+        log(Log_component::keys, Log_level::debug, "User's private data: ", private_data_bb);
 
         bb_to_byte_array(user_kd_.public_data, public_data_bb);
-        bb_to_byte_array(user_kd_.private_data, private_data_bb);
+        bb_to_byte_array(user_kd_.private_data, add_key_blob_tag(key_blob_tag_key_, public_data_bb, private_data_bb));
 
         return user_kd_;
 
-    } catch (Tpm_error &e) {
-        rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: create_and_load_user_key: Tpm_error: ", e.what());
     } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: create_and_load_user_key: runtime_error: ", e.what());
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
     } catch (...) {
-        rc = 3;
-        last_error_ = "Web_authn_tpm: create_and_load_user_key: failed - uncaught exception";
+        set_error(op, "failed - uncaught exception");
     }
 
     return Key_data{ { 0, nullptr }, { 0, nullptr } };
@@ -217,106 +427,108 @@ Key_data Web_authn_tpm::create_and_load_user_key(std::string const &user, std::s
 
 TPM_RC Web_authn_tpm::load_user_key(Key_data const &key, std::string const &user)
 {
-    log(Log_level::info, vars_to_string("load_user_key: User: ", user));
-
-    TPM_RC rc = 0;
+    static constexpr char const *op = "load_user_key";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::keys, Log_level::info, "load_user_key: User: ", user);
 
     try {
-        std::string error;
-        flush_user_key();
-
         Byte_buffer public_data_bb = byte_array_to_bb(key.public_data);
-        log(Log_level::debug, vars_to_string("User's public data: ", public_data_bb));
         Byte_buffer private_data_bb = byte_array_to_bb(key.private_data);
-        log(Log_level::debug, vars_to_string("User's private data: ", private_data_bb));
-
-        TPM2B_PUBLIC tpm2b_public;
-        rc = unmarshal_public_data_B(public_data_bb, &tpm2b_public);
-        if (rc != 0) {
-            error = vars_to_string("Unable to unmarshall the public data for the user key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        // Key data from another authenticator is rejected before the TPM is used
+        Tpm_status status = check_key_blob_tag(op, public_data_bb, &private_data_bb);
+        if (!status.ok()) {
+            set_error(status);
+            return 1;
         }
 
-        TPM2B_PRIVATE tpm2b_private;
-        rc = unmarshal_private_data_B(private_data_bb, &tpm2b_private);
-        if (rc != 0) {
-            error = vars_to_string("Unable to unmarshall the private data for the user key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        status = flush_user_key();
+        if (!status.ok()) {
+            set_error(status);
+            return 1;
         }
 
-        Load_Out load_out;
-        rc = load_key(tss_context_, "", srk_persistent_handle, tpm2b_public, tpm2b_private, &load_out);
-        if (rc != 0) {
-            error = vars_to_string("Unable to load the user key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        TPM2B_PUBLIC tpm2b_public;
+        Result<TPM_HANDLE> loaded = load_key_data(op, public_data_bb, private_data_bb, "", srk_persistent_handle, &tpm2b_public);
+        if (!loaded.ok()) {
+            set_error(loaded.status());
+            return 1;
         }
 
-        user_handle_ = load_out.objectHandle;
+        user_handle_ = loaded.value();
+        user_public_data_ = public_data_bb;
+        // Any restored relying party keys of a different user are not needed
+        flush_restored_keys(user_handle_);
 
-        log(Log_level::info, vars_to_string("User key loaded, handle: ", std::hex, user_handle_));
+        log(Log_component::keys, Log_level::info, "User key loaded, handle: ", std::hex, user_handle_);
 
-    } catch (Tpm_error &e) {
-        rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: load_user_key: Tpm_error: ", e.what());
+        return 0;
     } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: load_user_key: runtime_error: ", e.what());
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
+        return 2;
     } catch (...) {
-        rc = 3;
-        last_error_ = "Web_authn_tpm: load_user_key: failed - uncaught exception";
+        set_error(op, "failed - uncaught exception");
+        return 3;
     }
-
-    return rc;
 }
 
 Relying_party_key Web_authn_tpm::create_and_load_rp_key(std::string const &relying_party, std::string const &user_auth, std::string const &rp_key_auth)
 {
-    log(Log_level::info, "create_and_load_rp_key");
-    log(Log_level::debug, vars_to_string("Relying party: ", relying_party));
-
-    TPM_RC rc = 0;
+    static constexpr char const *op = "create_and_load_rp_key";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::keys, Log_level::info, op);
+    log(Log_component::keys, Log_level::debug, "Relying party: ", relying_party);
 
     try {
-        std::string error;
-        flush_rp_key();
+        assertions_.wait();
+        wait_for_preload();
+        Tpm_status status = flush_rp_key();
+        if (!status.ok()) {
+            set_error(status);
+            return Relying_party_key{ { { 0, nullptr }, { 0, nullptr } }, { { 0, nullptr }, { 0, nullptr } } };
+        }
 
         Create_Out out;
-        rc = create_ecdsa_key(tss_context_, user_handle_, user_auth, curve_ID, rp_key_auth, &out);
+        TPM_RC rc = create_ecdsa_key(tss_context_, user_handle_, user_auth, curve_ID, rp_key_auth, &out);
         if (rc != 0) {
-            error = vars_to_string("Unable to create the RP key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+            set_error(Tpm_status(op, Web_authn_stage::create, "Unable to create the RP key", rc));
+            return Relying_party_key{ { { 0, nullptr }, { 0, nullptr } }, { { 0, nullptr }, { 0, nullptr } } };
         }
-        log(Log_level::info, "Relying party key created");
+        log(Log_component::keys, Log_level::info, "Relying party key created");
 
         TPMT_PUBLIC ecdsa_pub_out = out.outPublic.publicArea;
         Byte_buffer ecdsa_key_x = tpm2b_to_bb(ecdsa_pub_out.unique.ecc.x);
         Byte_buffer ecdsa_key_y = tpm2b_to_bb(ecdsa_pub_out.unique.ecc.y);
-        log(Log_level::debug, vars_to_string("RP ECDSA public key x: ", ecdsa_key_x));
-        log(Log_level::debug, vars_to_string("RP ECDSA public key y: ", ecdsa_key_y));
+        log(Log_component::keys, Log_level::debug, "RP ECDSA public key x: ", ecdsa_key_x);
+        log(Log_component::keys, Log_level::debug, "RP ECDSA public key y: ", ecdsa_key_y);
 
         Load_Out load_out;
         rc = load_key(tss_context_, user_auth, user_handle_, out.outPublic, out.outPrivate, &load_out);
         if (rc != 0) {
-            error = vars_to_string("Unable to load the RP key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+            set_error(Tpm_status(op, Web_authn_stage::load, "Unable to load the RP key", rc));
+            return Relying_party_key{ { { 0, nullptr }, { 0, nullptr } }, { { 0, nullptr }, { 0, nullptr } } };
         }
 
         rp_handle_ = load_out.objectHandle;
-        log(Log_level::info, vars_to_string("Relying party key loaded, handle: ", std::hex, rp_handle_));
+        user_auth_digest_ = auth_digest(user_auth);
+        log(Log_component::keys, Log_level::info, "Relying party key loaded, handle: ", std::hex, rp_handle_);
+
+        flush_restored_keys(0);
 
         Byte_buffer public_data_bb = marshal_public_data_B(&out.outPublic);
-        log(Log_level::debug, vars_to_string("RP's public data: ", public_data_bb));
+        log(Log_component::keys, Log_level::debug, "RP's public data: ", public_data_bb);
+        rp_public_data_ = public_data_bb;
         Byte_buffer private_data_bb = marshal_private_data_B(&out.outPrivate);
-        log(Log_level::debug, vars_to_string("RP's private data: ", private_data_bb));
+        log(Log_component::keys, Log_level::debug, "RP's private data: ", private_data_bb);
 
         Relying_party_key rpk;
+        Byte_buffer tagged_private_data_bb = add_key_blob_tag(key_blob_tag_key_, public_data_bb, private_data_bb);
         bb_to_byte_array(rp_kd_.public_data, public_data_bb);
-        bb_to_byte_array(rp_kd_.private_data, private_data_bb);
+        bb_to_byte_array(rp_kd_.private_data, tagged_private_data_bb);
+        record_rp_key_use(public_data_bb, tagged_private_data_bb);
         rpk.key_blob = rp_kd_;
 
         bb_to_byte_array(pt_.x_coord, ecdsa_key_x);
@@ -324,15 +536,10 @@ Relying_party_key Web_authn_tpm::create_and_load_rp_key(std::string const &relyi
         rpk.key_point = pt_;
 
         return rpk;
-    } catch (Tpm_error &e) {
-        rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: create_and_load_rp_key: Tpm_error: ", e.what());
     } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: create_and_load_rp_key: runtime_error: ", e.what());
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
     } catch (...) {
-        rc = 3;
-        last_error_ = "Web_authn_tpm: create_and_load_rp_key: failed - uncaught exception";
+        set_error(op, "failed - uncaught exception");
     }
 
     return Relying_party_key{ { { 0, nullptr }, { 0, nullptr } }, { { 0, nullptr }, { 0, nullptr } } };
@@ -340,65 +547,59 @@ Relying_party_key Web_authn_tpm::create_and_load_rp_key(std::string const &relyi
 
 Key_ecc_point Web_authn_tpm::load_rp_key(Key_data const &key, std::string const &relying_party, std::string const &user_auth)
 {
-    log(Log_level::info, vars_to_string("load_rp_key: relying party: ", relying_party));
-
-    TPM_RC rc = 0;
+    static constexpr char const *op = "load_rp_key";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::keys, Log_level::info, "load_rp_key: relying party: ", relying_party);
 
     try {
-        std::string error;
-        flush_rp_key();
-
         Byte_buffer public_data_bb = byte_array_to_bb(key.public_data);
-        log(Log_level::debug, vars_to_string("RP's public data: ", public_data_bb));
         Byte_buffer private_data_bb = byte_array_to_bb(key.private_data);
-        log(Log_level::debug, vars_to_string("RP's private data: ", private_data_bb));
-
-        TPM2B_PUBLIC tpm2b_public;
-        rc = unmarshal_public_data_B(public_data_bb, &tpm2b_public);
-        if (rc != 0) {
-            error = vars_to_string("Unable to unmarshall the public data for the RP key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        // Key data from another authenticator is rejected before the TPM is used
+        Tpm_status status = check_key_blob_tag(op, public_data_bb, &private_data_bb);
+        if (!status.ok()) {
+            // pt_ is still the loaded key's point
+            set_error(status);
+            return Key_ecc_point{ { 0, nullptr }, { 0, nullptr } };
         }
 
-        TPM2B_PRIVATE tpm2b_private;
-        rc = unmarshal_private_data_B(private_data_bb, &tpm2b_private);
-        if (rc != 0) {
-            error = vars_to_string("Unable to unmarshall the private data for the RP key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        // The getAssertion may sign with a preloaded key this takes, or with the RP key it flushes
+        assertions_.end();
+        wait_for_preload();
+        status = flush_rp_key();
+        if (!status.ok()) {
+            set_error(status);
+            return pt_;
         }
 
-        Load_Out load_out;
-        rc = load_key(tss_context_, user_auth, user_handle_, tpm2b_public, tpm2b_private, &load_out);
-        if (rc != 0) {
-            error = vars_to_string("Unable to load the RP key: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+        TPM2B_PUBLIC tpm2b_public;
+        Result<TPM_HANDLE> loaded = load_key_data(op, public_data_bb, private_data_bb, user_auth, user_handle_, &tpm2b_public);
+        if (!loaded.ok()) {
+            set_error(loaded.status());
+            return pt_;
         }
 
-        rp_handle_ = load_out.objectHandle;
+        rp_handle_ = loaded.value();
+        rp_public_data_ = public_data_bb;
+        flush_restored_keys(0);
+        record_rp_key_use(public_data_bb, byte_array_to_bb(key.private_data));
 
-        log(Log_level::info, vars_to_string("RP key loaded, handle: ", std::hex, user_handle_));
+        log(Log_component::keys, Log_level::info, "RP key loaded, handle: ", std::hex, rp_handle_);
 
         TPMT_PUBLIC ecdsa_pub_out = tpm2b_public.publicArea;
         Byte_buffer ecdsa_key_x = tpm2b_to_bb(ecdsa_pub_out.unique.ecc.x);
         Byte_buffer ecdsa_key_y = tpm2b_to_bb(ecdsa_pub_out.unique.ecc.y);
-        log(Log_level::debug, vars_to_string("RP ECDSA public key x: ", ecdsa_key_x));
-        log(Log_level::debug, vars_to_string("RP ECDSA public key y: ", ecdsa_key_y));
+        log(Log_component::keys, Log_level::debug, "RP ECDSA public key x: ", ecdsa_key_x);
+        log(Log_component::keys, Log_level::debug, "RP ECDSA public key y: ", ecdsa_key_y);
 
         bb_to_byte_array(pt_.x_coord, ecdsa_key_x);
         bb_to_byte_array(pt_.y_coord, ecdsa_key_y);
 
-    } catch (Tpm_error &e) {
-        rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: load_rp_key: Tpm_error: ", e.what());
     } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: load_rp_key: runtime_error: ", e.what());
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
     } catch (...) {
-        rc = 3;
-        last_error_ = "Web_authn_tpm: load_user_key: failed - uncaught exception";
+        set_error(op, "failed - uncaught exception");
     }
 
     return pt_;
@@ -406,98 +607,774 @@ Key_ecc_point Web_authn_tpm::load_rp_key(Key_data const &key, std::string const
 
 Ecdsa_sig Web_authn_tpm::sign_using_rp_key(std::string const &relying_party, Byte_buffer const &digest, std::string const &rp_key_auth)
 {
-    log(Log_level::info, vars_to_string("sign_using_rp_key: RP: ", relying_party));
-    log(Log_level::debug, vars_to_string("digest to sign: ", digest));
-
-    TPM_RC rc = 0;
+    static constexpr char const *op = "sign_using_rp_key";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::sign, Log_level::info, "sign_using_rp_key: RP: ", relying_party);
+    log(Log_component::sign, Log_level::debug, "digest to sign: ", digest);
 
     try {
-        std::string error;
-
-        Sign_Out sign_out;
-
-        rc = ecdsa_sign(tss_context_, rp_handle_, digest, rp_key_auth, &sign_out);
+        assertions_.wait();
+        wait_for_preload();
+        Raw_command command;
+        Raw_ecdsa_signature signature;
+
+        TPM_RC rc = raw_ecdsa_sign_command(rp_handle_, rp_key_auth, digest, &command);
+        if (rc == 0) {
+            rc = raw_ecdsa_sign(tss_context_, command, &signature);
+        }
         if (rc != 0) {
-            error = vars_to_string("Sign operation failed: ", get_tpm_error(rc));
-            log(Log_level::error, error);
-            throw Tpm_error(error.c_str());
+            set_error(Tpm_status(op, Web_authn_stage::sign, "Sign operation failed", rc));
+            return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
         }
 
-        TPMS_SIGNATURE_ECDSA sig = sign_out.signature.signature.ecdsa;
-
-        Byte_buffer sig_r = tpm2b_to_bb(sig.signatureR);
-        Byte_buffer sig_s = tpm2b_to_bb(sig.signatureS);
+        Byte_buffer sig_r(signature.r.data(), signature.r_size);
+        Byte_buffer sig_s(signature.s.data(), signature.s_size);
 
-        log(Log_level::debug, vars_to_string("ECDSA signature R: ", sig_r));
-        log(Log_level::debug, vars_to_string("ECDSA signature S: ", sig_s));
+        log(Log_component::sign, Log_level::debug, "ECDSA signature R: ", sig_r);
+        log(Log_component::sign, Log_level::debug, "ECDSA signature S: ", sig_s);
 
         bb_to_byte_array(sig_.sig_r, sig_r);
         bb_to_byte_array(sig_.sig_s, sig_s);
 
         return sig_;
-    } catch (Tpm_error &e) {
-        rc = 1;
-        last_error_ = vars_to_string("Web_authn_tpm: sign_using_rp_key: Tpm_error: ", e.what());
     } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Web_authn_tpm: sign_using_rp_key: runtime_error: ", e.what());
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
     } catch (...) {
-        rc = 3;
-        last_error_ = "Web_authn_tpm: sign_using_rp_key: failed - uncaught exception";
+        set_error(op, "failed - uncaught exception");
     }
 
     return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
 }
 
+Ecdsa_sig Web_authn_tpm::begin_assertions(uint64_t channel, std::vector<Assertion_credential> credentials, std::string const &user_auth)
+{
+    static constexpr char const *op = "begin_assertions";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::sign, Log_level::info, "begin_assertions: channel: ", std::hex, channel, std::dec, ", credentials: ", credentials.size());
+
+    try {
+        wait_for_preload();
+        TPM_HANDLE parent_handle = user_handle_;
+        Assertion_stages stages{
+            [this, parent_handle, user_auth](Assertion_credential const &credential, Prepared_credential &prepared) {
+                prepare_credential(credential, parent_handle, user_auth, prepared);
+            },
+            [this](Prepared_credential &prepared) { execute_credential(prepared); },
+            [this](Prepared_credential const &prepared) { return finish_credential(prepared); }
+        };
+        Result<Assertion_signature> signature = assertions_.begin(channel, std::move(credentials), std::move(stages));
+        if (!signature.ok()) {
+            set_error(signature.status());
+            return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+        }
+
+        return return_signature(signature.value());
+    } catch (std::runtime_error &e) {
+        assertions_.end();
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
+    } catch (...) {
+        assertions_.end();
+        set_error(op, "failed - uncaught exception");
+    }
+
+    return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+}
+
+Ecdsa_sig Web_authn_tpm::next_assertion(uint64_t channel)
+{
+    static constexpr char const *op = "next_assertion";
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+    log(Log_component::sign, Log_level::info, "next_assertion: channel: ", std::hex, channel);
+
+    try {
+        wait_for_preload();
+        Result<Assertion_signature> signature = assertions_.next(channel);
+        if (!signature.ok()) {
+            set_error(signature.status());
+            return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+        }
+
+        return return_signature(signature.value());
+    } catch (std::runtime_error &e) {
+        assertions_.end();
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
+    } catch (...) {
+        assertions_.end();
+        set_error(op, "failed - uncaught exception");
+    }
+
+    return Ecdsa_sig{ { 0, nullptr }, { 0, nullptr } };
+}
+
+void Web_authn_tpm::end_assertions()
+{
+    Request_scope request_scope(request_);
+    assertions_.end();
+    log(Log_component::sign, Log_level::info, "end_assertions: speculative signatures ready: ", assertions_.speculative_hits(),
+          ", discarded: ", assertions_.speculative_discards());
+}
+
+void Web_authn_tpm::prepare_credential(Assertion_credential const &credential, TPM_HANDLE parent_handle, std::string const &user_auth, Prepared_credential &prepared)
+{
+    static constexpr char const *op = "prepare_credential";
+    prepared.request = current_request();
+    log(Log_component::sign, Log_level::debug, "Public data: ", credential.public_data);
+    log(Log_component::sign, Log_level::debug, "Private data: ", credential.private_data);
+
+    // A credential from another authenticator is rejected here, without a TPM2_Load
+    Byte_buffer private_data = credential.private_data;
+    prepared.status = check_key_blob_tag(op, credential.public_data, &private_data);
+    if (!prepared.status.ok()) {
+        return;
+    }
+    record_rp_key_use(credential.public_data, credential.private_data);
+
+    // A preloaded key is used in place of the load command, which is kept in case its context can't be loaded.
+    // It was loaded with the authorisation given to preload_rp_keys, so is only used with the same one
+    if (preload_parent_ != 0 && parent_handle == preload_parent_) {
+        auto preloaded = std::find_if(preloaded_keys_.begin(), preloaded_keys_.end(),
+          [&credential](Preloaded_key const &key) { return key.public_data == credential.public_data; });
+        if (preloaded != preloaded_keys_.end() && auth_matches(preloaded->auth_digest, user_auth)) {
+            preload_stats_.hits++;
+            preloaded->used = true;
+            prepared.preloaded_handle = preloaded->handle;
+            prepared.preloaded_context = preloaded->context_blob;
+        } else {
+            preload_stats_.misses++;
+        }
+    }
+
+    // The stored key data is already marshalled, so is copied straight into the command
+    TPM_RC rc = raw_load_command(parent_handle, user_auth, credential.public_data, private_data, &prepared.load_command);
+    if (rc != 0) {
+        prepared.status = Tpm_status(op, Web_authn_stage::load, "Unable to build the load command for the key", rc);
+        return;
+    }
+
+    if (credential.digest.size() > MAX_DIGEST_SIZE) {
+        prepared.status = Tpm_status(op, Web_authn_stage::sign, "The digest is too large", Web_authn_error::bad_parameter);
+        return;
+    }
+    // The key handle is filled in once the key is loaded
+    rc = raw_ecdsa_sign_command(0, credential.rp_key_auth, credential.digest, &prepared.sign_command);
+    if (rc != 0) {
+        prepared.status = Tpm_status(op, Web_authn_stage::sign, "Unable to build the sign command", rc);
+    }
+}
+
+void Web_authn_tpm::execute_credential(Prepared_credential &prepared)
+{
+    static constexpr char const *op = "sign_credential";
+    Request_scope request(prepared.request);
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+
+    TPM_HANDLE key_handle = prepared.preloaded_handle;
+    TPM_RC rc = 0;
+    bool from_context = false;
+    if (key_handle == 0 && !prepared.preloaded_context.empty()) {
+        rc = context_load(tss_context_, tss_state_dir_.empty() ? data_dir_ : tss_state_dir_, prepared.preloaded_context, &key_handle, true);
+        // Otherwise, e.g. the TPM has been reset since the context was saved, the key is loaded
+        from_context = (rc == 0);
+        if (!from_context) {
+            key_handle = 0;
+        }
+    }
+    if (key_handle == 0) {
+        rc = raw_load_key(tss_context_, prepared.load_command, &key_handle);
+        if (rc != 0) {
+            prepared.status = Tpm_status(op, Web_authn_stage::load, "Unable to load the key", rc);
+            return;
+        }
+    }
+
+    raw_set_handle(&prepared.sign_command, key_handle);
+    rc = raw_ecdsa_sign(tss_context_, prepared.sign_command, &prepared.signature);
+    // Flush whether or not the signature worked, the slot is only needed for this credential. A preloaded
+    // key stays loaded for the next use, the TSS keeps files for a key loaded from a context
+    TPM_RC flush_rc = 0;
+    if (prepared.preloaded_handle == 0) {
+        flush_rc = from_context ? flush_context(tss_context_, key_handle) : raw_flush_context(tss_context_, key_handle);
+    }
+    if (rc != 0) {
+        prepared.status = Tpm_status(op, Web_authn_stage::sign, "Sign operation failed", rc);
+    } else if (flush_rc != 0) {
+        prepared.status = Tpm_status(op, Web_authn_stage::flush, "Unable to flush the credential key", flush_rc);
+    }
+}
+
+Result<Assertion_signature> Web_authn_tpm::finish_credential(Prepared_credential const &prepared)
+{
+    Raw_ecdsa_signature const &sig = prepared.signature;
+    return Assertion_signature{ Byte_buffer(sig.r.data(), sig.r_size), Byte_buffer(sig.s.data(), sig.s_size) };
+}
+
+Ecdsa_sig Web_authn_tpm::return_signature(Assertion_signature const &signature)
+{
+    log(Log_component::sign, Log_level::debug, "ECDSA signature R: ", signature.sig_r);
+    log(Log_component::sign, Log_level::debug, "ECDSA signature S: ", signature.sig_s);
+
+    bb_to_byte_array(sig_.sig_r, signature.sig_r);
+    bb_to_byte_array(sig_.sig_s, signature.sig_s);
+
+    return sig_;
+}
+
 std::string Web_authn_tpm::get_last_error()
 {
-    // Move the contents of last_error also clears the value
-    std::string error(std::move(last_error_));
-    last_error_ = "No error";
-    return error;
+    if (!error_pending_) {
+        return "No error";
+    }
+    error_pending_ = false;
+    if (!last_error_.empty()) {
+        // Move the contents of last_error also clears the value
+        std::string error(std::move(last_error_));
+        last_error_.clear();
+        return error;
+    }
+    // Only now turn the status into a message
+    return "Web_authn_tpm: " + last_status_.message();
+}
+
+void Web_authn_tpm::set_error(Tpm_status const &status)
+{
+    last_status_ = status;
+    last_error_.clear();
+    error_pending_ = true;
+    log(Log_component::tss, Log_level::error, status.op(), ": ", status.what(), ", rc: 0x", std::hex, status.rc());
+    // Expected failures, e.g. a wrong PIN or a credential from another authenticator, don't need the commands
+    // that led up to them
+    switch (status.error()) {
+    case Web_authn_error::bad_parameter:
+    case Web_authn_error::auth_failed:
+    case Web_authn_error::bad_key_blob:
+    case Web_authn_error::not_allowed:
+        break;
+    default:
+        if (status.rc() != 0) {
+            dump_flight_record_limited();
+        }
+    }
+}
+
+void Web_authn_tpm::set_error(char const *op, std::string const &error, Web_authn_stage stage, Web_authn_error code)
+{
+    last_status_ = Tpm_status(op, stage, "see the error message", code);
+    last_error_ = vars_to_string("Web_authn_tpm: ", op, ": ", error);
+    error_pending_ = true;
+    log(Log_component::tss, Log_level::error, last_error_);
+}
+
+std::string Web_authn_tpm::get_flight_record() const
+{
+    return flight_recorder_.to_string();
+}
+
+void Web_authn_tpm::dump_flight_record()
+{
+    if (log_enabled(Log_component::tss, Log_level::error)) {
+        write_log(flight_recorder_.to_string());
+    }
+}
+
+void Web_authn_tpm::dump_flight_record_limited()
+{
+    uint64_t suppressed = 0;
+    {
+        std::lock_guard<std::mutex> lock(flight_dump_mutex_);
+        Monotonic_clock::time_point now = Monotonic_clock::now();
+        if (flight_dumped_ && now - last_flight_dump_ < flight_dump_interval) {
+            ++flight_dumps_suppressed_;
+            return;
+        }
+        flight_dumped_ = true;
+        last_flight_dump_ = now;
+        suppressed = flight_dumps_suppressed_;
+        flight_dumps_suppressed_ = 0;
+    }
+    if (log_enabled(Log_component::tss, Log_level::error)) {
+        write_log(vars_to_string(flight_recorder_.to_string(), "\nFlight records not written since the last: ", suppressed));
+    }
+}
+
+TPM_RC Web_authn_tpm::set_tracing(bool tracing)
+{
+    if (tracing) {
+        span_tracer_.start();
+    } else {
+        span_tracer_.stop();
+    }
+    log(Log_component::setup, Log_level::info, "Tracing: ", tracing);
+    return 0;
+}
+
+TPM_RC Web_authn_tpm::write_trace(std::string const &filename)
+{
+    std::ofstream os(filename);
+    if (os) {
+        span_tracer_.write_chrome_trace(os);
+    }
+    if (!os) {
+        set_error("write_trace", vars_to_string("Unable to write the trace to ", filename), Web_authn_stage::none,
+          Web_authn_error::bad_parameter);
+        return 1;
+    }
+    return 0;
 }
 
-void Web_authn_tpm::flush_user_key()
+TPM_RC Web_authn_tpm::set_command_budget(TPM_CC command_code, uint32_t budget_ms)
 {
+    latency_watchdog_.set_budget(command_code, std::chrono::milliseconds(budget_ms));
+    log(Log_component::tss, Log_level::info, "Latency budget for ", tpm_command_name(command_code), ": ", budget_ms, " ms");
+    return 0;
+}
+
+TPM_RC Web_authn_tpm::set_slow_command_callback(Slow_command_callback callback, void *user_data)
+{
+    if (callback == nullptr) {
+        latency_watchdog_.set_overrun_handler(nullptr);
+    } else {
+        latency_watchdog_.set_overrun_handler(
+          [callback, user_data](TPM_CC command, uint32_t elapsed_ms) { callback(user_data, command, elapsed_ms); });
+    }
+    return 0;
+}
+
+Tpm_command_stats Web_authn_tpm::get_command_stats(TPM_CC command_code) const
+{
+    auto stats = latency_watchdog_.stats(command_code);
+    return Tpm_command_stats{ stats.commands, stats.over_budget, stats.budget_us, stats.worst_us };
+}
+
+Tpm_request_stats Web_authn_tpm::get_request_stats(uint64_t request_id) const
+{
+    auto stats = latency_watchdog_.request_stats(request_id);
+    return Tpm_request_stats{ stats.commands, stats.tpm_us, stats.worst_us, stats.worst_command };
+}
+
+void Web_authn_tpm::log_slow_command(Latency_watchdog::Slow_command const &slow)
+{
+    // One line of key=value pairs, so the events can be picked out of the log
+    Request_context request = current_request();
+    log(Log_component::tss, Log_level::error, "slow_tpm_command request_id=0x", std::hex, request.id, std::dec,
+          " request_tag=", request.tag, " op=", Flight_recorder::current_operation(),
+          " command=", tpm_command_name(slow.command), " handle=0x", std::hex, slow.handle,
+          " rc=0x", slow.rc, std::dec, " duration_us=", slow.duration_us, " budget_us=", slow.budget_us,
+          " over_budget=", slow.over_budget, " suppressed=", slow.suppressed);
+    dump_flight_record();
+}
+
+Result<TPM_HANDLE> Web_authn_tpm::load_key_data(char const *op, Byte_buffer const &public_data_bb, Byte_buffer const &private_data_bb,
+  std::string const &parent_auth, TPM_HANDLE parent_handle, TPM2B_PUBLIC *tpm_public)
+{
+    log(Log_component::keys, Log_level::debug, "Public data: ", public_data_bb);
+    log(Log_component::keys, Log_level::debug, "Private data: ", private_data_bb);
+
+    TPM_RC rc = unmarshal_public_data_B(public_data_bb, tpm_public);
+    if (rc != 0) {
+        return Tpm_status(op, Web_authn_stage::unmarshal, "Unable to unmarshall the public data for the key", rc);
+    }
+
+    TPM2B_PRIVATE tpm2b_private;
+    rc = unmarshal_private_data_B(private_data_bb, &tpm2b_private);
+    if (rc != 0) {
+        return Tpm_status(op, Web_authn_stage::unmarshal, "Unable to unmarshall the private data for the key", rc);
+    }
+
+    TPM_HANDLE handle = take_restored_key(public_data_bb, parent_handle, parent_auth);
+    if (handle != 0) {
+        log(Log_component::keys, Log_level::info, "Key restored from its saved context, handle: ", std::hex, handle);
+    } else if ((handle = take_preloaded_key(public_data_bb, parent_handle, parent_auth)) != 0) {
+        log(Log_component::keys, Log_level::info, "Preloaded key used, handle: ", std::hex, handle);
+    } else {
+        Load_Out load_out;
+        rc = load_key(tss_context_, parent_auth, parent_handle, *tpm_public, tpm2b_private, &load_out);
+        if (rc != 0) {
+            return Tpm_status(op, Web_authn_stage::load, "Unable to load the key", rc);
+        }
+        handle = load_out.objectHandle;
+    }
+    if (parent_handle == user_handle_) {
+        // Checked by the TPM, or the same as the one a restored or preloaded key was loaded with
+        user_auth_digest_ = auth_digest(parent_auth);
+    }
+
+    return handle;
+}
+
+Tpm_status Web_authn_tpm::check_key_blob_tag(char const *op, Byte_buffer const &public_data, Byte_buffer *private_data) const
+{
+    switch (::check_key_blob_tag(key_blob_tag_key_, public_data, private_data)) {
+    case Key_blob_tag_check::tagged:
+        return Tpm_status();
+    case Key_blob_tag_check::untagged:
+        if (!require_key_blob_tags_) {
+            return Tpm_status();
+        }
+        return Tpm_status(op, Web_authn_stage::unmarshal, "The key data has no tag", Web_authn_error::bad_key_blob);
+    case Key_blob_tag_check::bad_tag:
+    default:
+        return Tpm_status(op, Web_authn_stage::unmarshal, "The key data was not created by this authenticator", Web_authn_error::bad_key_blob);
+    }
+}
+
+Tpm_status Web_authn_tpm::flush_user_key()
+{
+    // The getAssertion and preloaded keys are the user key's children
+    assertions_.end();
+    wait_for_preload();
+    discard_preloaded_keys();
+    save_rp_key_usage();
     release_byte_array(user_kd_.public_data);
     release_byte_array(user_kd_.private_data);
 
     if (user_handle_ == 0) {
-        return;
+        return Tpm_status();
     }
 
-    flush_rp_key();
+    Tpm_status status = flush_rp_key();
+    if (!status.ok()) {
+        return status;
+    }
     TPM_RC rc = flush_context(tss_context_, user_handle_);
     if (rc != 0) {
-        log(Log_level::error, "Unable to flush the user key");
-        throw Tpm_error("Unable to flush the user key");
+        return Tpm_status("flush_user_key", Web_authn_stage::flush, "Unable to flush the user key", rc);
     }
     user_handle_ = 0;
-    log(Log_level::info, "User key flushed");
+    user_public_data_ = Byte_buffer();
+    user_auth_digest_ = Byte_buffer();
+    log(Log_component::keys, Log_level::info, "User key flushed");
+    return Tpm_status();
 }
 
-void Web_authn_tpm::flush_rp_key()
+Tpm_status Web_authn_tpm::flush_rp_key()
 {
     release_byte_array(rp_kd_.public_data);
     release_byte_array(rp_kd_.private_data);
     release_byte_array(pt_.x_coord);
     release_byte_array(pt_.y_coord);
     if (rp_handle_ == 0) {
-        return;
+        return Tpm_status();
     }
 
     TPM_RC rc = flush_context(tss_context_, rp_handle_);
     if (rc != 0) {
-        log(Log_level::error, "Unable to flush the relying party key");
-        throw Tpm_error("Unable to flush the relying party key");
+        return Tpm_status("flush_rp_key", Web_authn_stage::flush, "Unable to flush the relying party key", rc);
     }
     rp_handle_ = 0;
-    log(Log_level::info, "Relying party key flushed");
+    rp_public_data_ = Byte_buffer();
+    log(Log_component::keys, Log_level::info, "Relying party key flushed");
+    return Tpm_status();
+}
+
+void Web_authn_tpm::save_contexts()
+{
+    // The digest of the user key authorisation the relying party key was loaded with, then public data and
+    // context pairs, the user key first as the relying party key is its child
+    std::vector<Byte_buffer> saved{ user_auth_digest_ };
+    for (auto const &key : { std::make_pair(user_handle_, &user_public_data_), std::make_pair(rp_handle_, &rp_public_data_) }) {
+        if (key.first == 0) {
+            break;
+        }
+        Byte_buffer context_blob;
+        TPM_RC rc = context_save(tss_context_, key.first, &context_blob);
+        if (rc != 0) {
+            log(Log_component::storage, Log_level::error, "Failed to save the context of the key with handle: ", std::hex, key.first, ": ", get_tpm_error(rc));
+            break;
+        }
+        if (!tss_state_dir_.empty()) {
+            // The TSS needs its files for the context at the restart, when its directory will have gone
+            move_tss_files(context_blob, tss_state_dir_, data_dir_);
+        }
+        saved.push_back(*key.second);
+        saved.push_back(context_blob);
+    }
+    if (saved.size() == 1) {
+        return;
+    }
+
+    // Anyone able to read the contexts could load the keys until the TPM restarts, so only the owner can
+    if (!write_private_file(make_filename(data_dir_, saved_contexts_filename), serialise_byte_buffers(saved))) {
+        log(Log_component::storage, Log_level::error, "Failed to write the saved key contexts");
+        return;
+    }
+    log(Log_component::storage, Log_level::info, "Saved the contexts of ", saved.size() / 2, " keys");
+}
+
+void Web_authn_tpm::restore_contexts()
+{
+    std::string filename = make_filename(data_dir_, saved_contexts_filename);
+    std::ifstream is(filename);
+    if (!is) {
+        return;
+    }
+    Byte_buffer saved_bb;
+    is >> saved_bb;
+    is.close();
+    // The contexts are only good for the restart following the shutdown they were saved at
+    std::remove(filename.c_str());
+
+    try {
+        std::vector<Byte_buffer> saved = deserialise_byte_buffers(saved_bb);
+        TPM_HANDLE parent_handle = srk_persistent_handle;
+        for (size_t i = 1; i + 1 < saved.size(); i += 2) {
+            TPM_HANDLE handle = 0;
+            if (!tss_state_dir_.empty()) {
+                move_tss_files(saved[i + 1], data_dir_, tss_state_dir_);
+            }
+            TPM_RC rc = context_load(tss_context_, tss_state_dir_.empty() ? data_dir_ : tss_state_dir_, saved[i + 1], &handle);
+            if (rc != 0) {
+                // E.g. the TPM was reset rather than resumed
+                log(Log_component::storage, Log_level::info, "Unable to restore a saved key context: ", get_tpm_error(rc));
+                break;
+            }
+            restored_keys_.push_back(Restored_key{ saved[i], parent_handle, handle, parent_handle == srk_persistent_handle ? Byte_buffer() : saved[0] });
+            log(Log_component::storage, Log_level::info, "Key context restored, handle: ", std::hex, handle);
+            parent_handle = handle;
+        }
+    } catch (std::runtime_error &e) {
+        log(Log_component::storage, Log_level::error, "The saved key contexts are corrupt: ", e.what());
+    }
+}
+
+TPM_HANDLE Web_authn_tpm::take_restored_key(Byte_buffer const &public_data, TPM_HANDLE parent_handle, std::string const &parent_auth)
+{
+    for (auto it = restored_keys_.begin(); it != restored_keys_.end(); ++it) {
+        if (it->parent_handle == parent_handle && it->public_data == public_data) {
+            // A key under the user key was not loaded with this authorisation, so it is only used with the
+            // one it was loaded with before the restart. Otherwise it is left to be flushed
+            if (parent_handle != srk_persistent_handle && !auth_matches(it->parent_auth_digest, parent_auth)) {
+                return 0;
+            }
+            TPM_HANDLE handle = it->handle;
+            restored_keys_.erase(it);
+            return handle;
+        }
+    }
+    return 0;
+}
+
+Byte_buffer Web_authn_tpm::auth_digest(std::string const &auth) const
+{
+    return hmac_sha256(auth_digest_key_, Byte_buffer(auth));
+}
+
+bool Web_authn_tpm::auth_matches(Byte_buffer const &digest, std::string const &auth) const
+{
+    if (digest.size() == 0) {
+        return false;
+    }
+    Byte_buffer auth_bb = auth_digest(auth);
+    return auth_bb.size() == digest.size() && CRYPTO_memcmp(auth_bb.cdata(), digest.cdata(), digest.size()) == 0;
+}
+
+void Web_authn_tpm::flush_restored_keys(TPM_HANDLE keep_parent)
+{
+    auto it = restored_keys_.begin();
+    while (it != restored_keys_.end()) {
+        if (keep_parent != 0 && it->parent_handle == keep_parent) {
+            ++it;
+            continue;
+        }
+        TPM_RC rc = flush_context(tss_context_, it->handle);
+        if (rc != 0) {
+            log(Log_component::keys, Log_level::error, "Failed to flush the restored key, handle: ", std::hex, it->handle);
+        }
+        it = restored_keys_.erase(it);
+    }
+}
+
+TPM_RC Web_authn_tpm::preload_rp_keys(std::string const &user_auth, uint32_t count)
+{
+    static constexpr char const *op = "preload_rp_keys";
+    Request_scope request_scope(request_);
+    log(Log_component::keys, Log_level::info, "preload_rp_keys: count: ", count);
+
+    try {
+        // The getAssertion may sign with the preloaded keys discarded here
+        assertions_.end();
+        wait_for_preload();
+        if (user_handle_ == 0) {
+            set_error(Tpm_status(op, Web_authn_stage::load, "No user key is loaded", Web_authn_error::not_allowed));
+            return 1;
+        }
+        discard_preloaded_keys();
+
+        std::vector<Rp_key_usage::Key> keys = rp_key_usage_.predict(user_public_data_, count);
+        if (keys.empty()) {
+            return 0;
+        }
+        preload_parent_ = user_handle_;
+        cancel_preload_ = false;
+        preloaded_ = preload_worker_.submit([this, keys, parent_handle = user_handle_, user_auth, request = request_]() {
+            Request_scope worker_request(request);
+            preload_keys(keys, parent_handle, user_auth);
+        });
+        log(Log_component::keys, Log_level::info, "Preloading ", keys.size(), " relying party keys");
+
+        return 0;
+    } catch (std::runtime_error &e) {
+        set_error(op, vars_to_string("runtime_error: ", e.what()));
+        return 2;
+    } catch (...) {
+        set_error(op, "failed - uncaught exception");
+        return 3;
+    }
+}
+
+void Web_authn_tpm::preload_keys(std::vector<Rp_key_usage::Key> const &keys, TPM_HANDLE parent_handle, std::string const &user_auth)
+{
+    static constexpr char const *op = "preload_rp_keys";
+    Flight_recorder::Operation recording(op);
+    Span_tracer::Span span(span_tracer_, op);
+
+    try {
+        // Keys are only kept loaded if there is still a slot for the relying party key and one for a getAssertion
+        uint32_t available = 0;
+        TPM_RC rc = transient_slots_available(tss_context_, &available);
+        uint32_t slots = (rc == 0 && available > 2) ? available - 2 : 0;
+        Byte_buffer user_auth_digest = auth_digest(user_auth);
+
+        for (auto const &key : keys) {
+            if (cancel_preload_) {
+                log(Log_component::keys, Log_level::info, "Preloading stopped for a call that uses the TPM");
+                break;
+            }
+            Byte_buffer private_data = key.private_data;
+            TPM2B_PUBLIC tpm_public;
+            TPM2B_PRIVATE tpm_private;
+            if (!check_key_blob_tag(op, key.public_data, &private_data).ok() || unmarshal_public_data_B(key.public_data, &tpm_public) != 0
+                || unmarshal_private_data_B(private_data, &tpm_private) != 0) {
+                continue;
+            }
+
+            Load_Out load_out;
+            rc = load_key(tss_context_, user_auth, parent_handle, tpm_public, tpm_private, &load_out);
+            if (rc != 0) {
+                // Don't try the rest, a wrong authorisation counts towards the TPM's lockout
+                log(Log_component::keys, Log_level::info, "Unable to preload a relying party key: ", get_tpm_error(rc));
+                break;
+            }
+
+            Preloaded_key preloaded{ key.public_data, load_out.objectHandle, Byte_buffer(), false, user_auth_digest };
+            if (slots > 0) {
+                slots--;
+            } else {
+                rc = context_save(tss_context_, load_out.objectHandle, &preloaded.context_blob);
+                TPM_RC flush_rc = flush_context(tss_context_, load_out.objectHandle);
+                if (rc != 0 || flush_rc != 0) {
+                    log(Log_component::keys, Log_level::info, "Unable to save the context of a preloaded key: ", get_tpm_error(rc != 0 ? rc : flush_rc));
+                    break;
+                }
+                preloaded.handle = 0;
+            }
+            preloaded_keys_.push_back(preloaded);
+            keys_preloaded_++;
+        }
+        log(Log_component::keys, Log_level::info, "Preloaded ", preloaded_keys_.size(), " relying party keys");
+    } catch (std::runtime_error &e) {
+        log(Log_component::keys, Log_level::error, "preload_rp_keys: runtime_error: ", e.what());
+    }
+}
+
+void Web_authn_tpm::wait_for_preload()
+{
+    if (!preloaded_.valid()) {
+        return;
+    }
+    cancel_preload_ = true;
+    preloaded_.wait();
+    preloaded_ = std::future<void>();
+}
+
+TPM_HANDLE Web_authn_tpm::take_preloaded_key(Byte_buffer const &public_data, TPM_HANDLE parent_handle, std::string const &parent_auth)
+{
+    if (preload_parent_ == 0 || parent_handle != preload_parent_) {
+        return 0;
+    }
+    auto preloaded = std::find_if(preloaded_keys_.begin(), preloaded_keys_.end(),
+      [&public_data](Preloaded_key const &key) { return key.public_data == public_data; });
+    if (preloaded == preloaded_keys_.end() || !auth_matches(preloaded->auth_digest, parent_auth)) {
+        preload_stats_.misses++;
+        return 0;
+    }
+
+    TPM_HANDLE handle = preloaded->handle;
+    if (handle != 0) {
+        // The caller owns the loaded key now
+        preloaded_keys_.erase(preloaded);
+    } else {
+        // The context is kept to load again
+        TPM_RC rc = context_load(tss_context_, tss_state_dir_.empty() ? data_dir_ : tss_state_dir_, preloaded->context_blob, &handle, true);
+        if (rc != 0) {
+            log(Log_component::keys, Log_level::info, "Unable to load the context of a preloaded key: ", get_tpm_error(rc));
+            preload_stats_.misses++;
+            return 0;
+        }
+        preloaded->used = true;
+    }
+    preload_stats_.hits++;
+    return handle;
+}
+
+void Web_authn_tpm::discard_preloaded_keys()
+{
+    std::string tss_dir = tss_state_dir_.empty() ? data_dir_ : tss_state_dir_;
+    for (auto const &key : preloaded_keys_) {
+        if (!key.used) {
+            preload_stats_.unused++;
+        }
+        if (key.handle != 0) {
+            TPM_RC rc = flush_context(tss_context_, key.handle);
+            if (rc != 0) {
+                log(Log_component::keys, Log_level::error, "Failed to flush the preloaded key, handle: ", std::hex, key.handle);
+            }
+        }
+        for (auto const &file : context_tss_files(key.context_blob)) {
+            std::remove(make_filename(tss_dir, file).c_str());
+        }
+    }
+    if (preload_parent_ != 0) {
+        log(Log_component::keys, Log_level::info, "Preloaded relying party keys: ", keys_preloaded_, ", hits: ", preload_stats_.hits,
+              ", misses: ", preload_stats_.misses, ", unused: ", preload_stats_.unused);
+    }
+    preloaded_keys_.clear();
+    preload_parent_ = 0;
+}
+
+Rp_key_preload_stats Web_authn_tpm::get_preload_stats() const
+{
+    Rp_key_preload_stats stats = preload_stats_;
+    stats.preloaded = keys_preloaded_;
+    return stats;
+}
+
+void Web_authn_tpm::record_rp_key_use(Byte_buffer const &public_data, Byte_buffer const &private_data)
+{
+    if (!user_public_data_.empty()) {
+        rp_key_usage_.record_use(user_public_data_, public_data, private_data);
+    }
+}
+
+void Web_authn_tpm::save_rp_key_usage()
+{
+    if (!rp_key_usage_.changed() || data_dir_.empty()) {
+        return;
+    }
+    if (!write_private_file(make_filename(data_dir_, rp_key_usage_filename), rp_key_usage_.serialise())) {
+        log(Log_component::storage, Log_level::error, "Failed to write the relying party key usage");
+    }
 }
 
 void Web_authn_tpm::release_memory()
 {
-    log(Log_level::info, "Release TPM byte arrays");
+    log(Log_component::setup, Log_level::info, "Release TPM byte arrays");
     release_byte_array(user_kd_.public_data);
     release_byte_array(user_kd_.private_data);
     release_byte_array(rp_kd_.public_data);
@@ -508,69 +1385,108 @@ void Web_authn_tpm::release_memory()
     release_byte_array(sig_.sig_s);
 }
 
-void Web_authn_tpm::log(Log_level log_level, std::string const &log_str)
+bool Web_authn_tpm::log_enabled(Log_component component, Log_level log_level) const
 {
-    if (log_level > log_level_) {
-        return;
+    if (log_level > log_levels_[static_cast<size_t>(component)].load(std::memory_order_relaxed)) {
+        return false;
+    }
+    uint32_t one_in = debug_sample_one_in_.load(std::memory_order_relaxed);
+    if (log_level != Log_level::debug || one_in == 1) {
+        return true;
+    }
+    uint64_t id = current_request().id;
+    if (id == 0) {
+        return false;
+    }
+    // Mix the id (splitmix64's finaliser), hosts often use sequential ids
+    id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    id = (id ^ (id >> 27)) * 0x94d049bb133111ebULL;
+    id ^= id >> 31;
+    return id % one_in == 0;
+}
+
+void Web_authn_tpm::write_log(std::string const &log_str)
+{
+    Request_context request = current_request();
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    // Timed logs write the time whenever the stream is asked for
+    std::ostream &os = log_ptr_->os();
+    if (request.id != 0) {
+        os << "[request 0x" << std::hex << request.id << '/' << std::dec << request.tag << "] ";
     }
-    log_ptr_->os() << log_str << std::endl;
+    os << log_str << std::endl;
 }
 
 TPM_RC Web_authn_tpm::flush_data()
 {
-    log(Log_level::info, "Flush_data");
+    Request_scope request_scope(request_);
+    Flight_recorder::Operation recording("flush_data");
+    Span_tracer::Span span(span_tracer_, "flush_data");
+    log(Log_component::setup, Log_level::info, "Flush_data");
     release_memory();
 
     TPM_RC rc = 0;
-    try {
-        flush_user_key();
-    } catch (Tpm_error &e) {
+    Tpm_status status = flush_user_key();
+    if (!status.ok()) {
         rc = 1;
-        last_error_ = vars_to_string("Flush_data: Tpm_error: ", e.what());
-    } catch (std::runtime_error &e) {
-        rc = 2;
-        last_error_ = vars_to_string("Flush_data: runtime_error: ", e.what());
-    } catch (...) {
-        rc = 3;
-        last_error_ = "Flush_data: failed - uncaught exception";
+        set_error(status);
     }
+    flush_restored_keys(0);
 
-    log(Log_level::debug, "Flush_data completed");
+    log(Log_component::setup, Log_level::debug, "Flush_data completed");
     return rc;
 }
 
 Web_authn_tpm::~Web_authn_tpm()
 {
-    log(Log_level::error, "Tidying up ...");
+    Flight_recorder::Operation recording("uninstall");
+    Span_tracer::Span span(span_tracer_, "uninstall");
+    log(Log_component::setup, Log_level::error, "Tidying up ...");
+
+    assertions_.end();
+    wait_for_preload();
+    discard_preloaded_keys();
+    save_rp_key_usage();
 
     release_memory();
 
+    if (preserve_state_ && tss_context_) {
+        save_contexts();
+    }
+    flush_restored_keys(0);
+
     TPM_RC rc = 0;
 
     if (user_handle_ != 0) {
-        log(Log_level::debug, vars_to_string("Flush user key, handle: ", user_handle_));
+        log(Log_component::setup, Log_level::debug, "Flush user key, handle: ", user_handle_);
         rc = flush_context(tss_context_, user_handle_);
         if (rc != 0) {
-            log(Log_level::error, vars_to_string("Failed to flush the user key, handle: ", user_handle_));
+            log(Log_component::setup, Log_level::error, "Failed to flush the user key, handle: ", user_handle_);
         }
         user_handle_ = 0;
     }
 
     if (rp_handle_ != 0) {
-        log(Log_level::debug, vars_to_string("Flush relying pary key, handle: ", rp_handle_));
+        log(Log_component::setup, Log_level::debug, "Flush relying pary key, handle: ", rp_handle_);
         rc = flush_context(tss_context_, rp_handle_);
         if (rc != 0) {
-            log(Log_level::error, vars_to_string("Failed to flush the RP key, handle: ", rp_handle_));
+            log(Log_component::setup, Log_level::error, "Failed to flush the RP key, handle: ", rp_handle_);
         }
         rp_handle_ = 0;
     }
 
     if (tss_context_) {
-        log(Log_level::debug, "Delete TPM context");
-        shutdown(tss_context_);
+        log(Log_component::setup, Log_level::debug, "Delete TPM context");
+        shutdown(tss_context_, preserve_state_ ? TPM_SU_STATE : TPM_SU_CLEAR);
+        set_command_observer(tss_context_, nullptr);
         TSS_Delete(tss_context_);
         tss_context_ = nullptr;
     }
 
-    log(Log_level::debug, "Tidying up completed");
+    if (!tss_state_dir_.empty()) {
+        std::error_code ec;
+        std::filesystem::remove_all(tss_state_dir_, ec);
+    }
+
+    log(Log_component::setup, Log_level::debug, "Tidying up completed");
 }
@@ -0,0 +1,183 @@
+/*******************************************************************************
+* File:        Assertion_iterator.h
+* Description: Signs the credentials for a getAssertion in turn, speculatively signing the next one in the background
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Tss_includes.h"
+#include "Byte_buffer.h"
+#include "Raw_command.h"
+#include "Tpm_status.h"
+#include "Tpm_worker.h"
+
+/**
+ * A relying party key to be signed with during a getAssertion, and the digest
+ * of the authenticator data and client data hash for that credential.
+ */
+struct Assertion_credential
+{
+    Byte_buffer public_data;
+    Byte_buffer private_data;
+    std::string rp_key_auth;
+    Byte_buffer digest;
+};
+
+struct Assertion_signature
+{
+    Byte_buffer sig_r;
+    Byte_buffer sig_s;
+};
+
+/**
+ * A credential's TPM commands, built before the TPM is free to run them, and
+ * their results. If status is not ok a stage failed and the later stages are
+ * skipped.
+ */
+struct Prepared_credential
+{
+    Raw_command load_command;
+    // A preloaded key is used instead of the load command: a loaded key, left loaded
+    // after signing, or a saved context to load
+    TPM_HANDLE preloaded_handle{ 0 };
+    Byte_buffer preloaded_context;
+    Raw_command sign_command;
+    Raw_ecdsa_signature signature;
+    Tpm_status status;
+    // The host request it is prepared for, its TPM commands may run on another thread
+    Request_context request{ 0, 0 };
+};
+
+/**
+ * The work for each credential: the host work to build its commands, the TPM
+ * commands and the host work on their results.
+ */
+struct Assertion_stages
+{
+    std::function<void(Assertion_credential const &, Prepared_credential &)> prepare;
+    std::function<void(Prepared_credential &)> execute;
+    std::function<Result<Assertion_signature>(Prepared_credential const &)> finish;
+};
+
+/**
+ * Iterates over the credentials for a getAssertion. The first credential is
+ * signed when the iteration begins. Each time a signature is returned the
+ * next credential is signed on a background thread, so it is ready by the
+ * time getNextAssertion asks for it. A speculative signature is discarded,
+ * unreturned, if the next call is for a different channel or the CTAP 30
+ * second window has expired.
+ *
+ * The credentials go through a two stage pipeline: while one credential's
+ * TPM commands run on the worker thread, the caller's thread finishes the
+ * previous credential and prepares the next.
+ *
+ * The execute stage is only ever run on one thread at a time, the owner must
+ * call wait() before making any other TPM calls of its own.
+ */
+class Assertion_iterator
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds ctap_window{ 30 };
+
+    explicit Assertion_iterator(Clock::duration window = ctap_window) : window_(window) {}
+    Assertion_iterator(Assertion_iterator const &) = delete;
+    Assertion_iterator &operator=(Assertion_iterator const &) = delete;
+
+    /**
+	 * Start a new iteration, discarding any earlier one, and sign the first credential.
+	 *
+	 * @param channel - the channel the getAssertion came in on
+	 * @return - the first credential's signature, or the status of the call that failed
+	 */
+    Result<Assertion_signature> begin(uint64_t channel, std::vector<Assertion_credential> credentials, Assertion_stages stages);
+
+    /**
+	 * Return the next credential's signature, waiting for the speculative signature if it is not ready yet.
+	 *
+	 * @param channel - the channel the getNextAssertion came in on
+	 * @return - the signature, or the status if the iteration has ended, expired or the channel has changed
+	 */
+    Result<Assertion_signature> next(uint64_t channel);
+
+    /**
+	 * End the iteration, discarding any speculative signature.
+	 */
+    void end();
+
+    /**
+	 * Wait for any speculative signature to complete, leaving the TPM free for the owner.
+	 */
+    void wait() const;
+
+    bool active() const { return !credentials_.empty(); }
+    // The number of speculative signatures that were ready when next() was called
+    uint64_t speculative_hits() const { return speculative_hits_; }
+    uint64_t speculative_discards() const { return speculative_discards_; }
+
+    ~Assertion_iterator() { end(); }
+
+  private:
+    Clock::duration window_;
+    uint64_t channel_{ 0 };
+    Clock::time_point deadline_;
+    std::vector<Assertion_credential> credentials_;
+    Assertion_stages stages_;
+    // The next credential to prepare
+    size_t next_{ 0 };
+    // Prepared, waiting for the TPM
+    std::unique_ptr<Prepared_credential> ready_;
+    // Running on, or finished by, the TPM
+    std::unique_ptr<Prepared_credential> executing_;
+    std::future<void> executed_;
+    uint64_t speculative_hits_{ 0 };
+    uint64_t speculative_discards_{ 0 };
+    Tpm_worker worker_;
+
+    void prepare();
+    void execute();
+    Result<Assertion_signature> advance();
+};
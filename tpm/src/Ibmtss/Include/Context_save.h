@@ -0,0 +1,72 @@
+/*******************************************************************************
+* File:        Context_save.h
+* Description: Save and restore the context of a loaded key
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Byte_buffer.h"
+#include "Tss_includes.h"
+
+// Save the context of a loaded object. The blob is the marshalled TPMS_CONTEXT,
+// it can be stored and loaded again after a state preserving shutdown
+TPM_RC context_save(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle,
+Byte_buffer* context_blob
+);
+
+// Load a context saved by context_save. The TSS keeps the object's Name and
+// public area in the data directory alongside a saved context, these are
+// removed once the TSS has copied them to the object's new handle, unless
+// they are kept to load the context again
+TPM_RC context_load(
+TSS_CONTEXT* tss_context,
+std::string const& data_dir,
+Byte_buffer const& context_blob,
+TPM_HANDLE* handle,
+bool keep_tss_files=false
+);
+
+// The files the TSS keeps in its data directory alongside a saved context,
+// none if the TSS is built without file support
+std::vector<std::string> context_tss_files(
+Byte_buffer const& context_blob
+);
@@ -52,3 +52,19 @@ std::string const& ecdsa_auth,
 Sign_Out* sign_out
 );
 
+// Build the Sign command for a SHA256 digest, the key handle can be changed
+// before the command is executed
+void ecdsa_sign_in(
+TPM_HANDLE handle,
+Byte_buffer const& digest_to_sign,
+Sign_In* sign_in
+);
+
+// Execute a Sign command built by ecdsa_sign_in
+TPM_RC ecdsa_sign(
+TSS_CONTEXT* tss_context,
+std::string const& ecdsa_auth,
+Sign_In* sign_in,
+Sign_Out* sign_out
+);
+
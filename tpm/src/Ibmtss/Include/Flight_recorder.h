@@ -0,0 +1,116 @@
+/*******************************************************************************
+* File:        Flight_recorder.h
+* Description: An in-memory record of the most recent TPM commands
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Tss_includes.h"
+#include "Tss_execute.h"
+
+/**
+ * A fixed size ring holding the most recent TPM commands sent on a context: the host request and the
+ * operation that sent each one, its command code, its handle, the return code and how long it took. It is
+ * always on, recording a command copies one record (48 bytes on a 64-bit build) and allocates nothing, so
+ * the commands that led up to a failure can be logged even when the log level hides them.
+ */
+class Flight_recorder : public Tpm_command_observer
+{
+  public:
+    static constexpr std::size_t capacity = 128;
+
+    struct Record
+    {
+        // The operation in progress, a string literal
+        char const *op;
+        // The host request, see Request_scope.h
+        uint64_t request_id;
+        uint32_t request_tag;
+        // Steady clock microseconds
+        int64_t start_us;
+        uint32_t duration_us;
+        TPM_CC command;
+        TPM_HANDLE handle;
+        TPM_RC rc;
+    };
+
+    /**
+	 * Tags the commands sent by the calling thread with an operation, until it goes out of scope. The
+	 * operation must be a string literal.
+	 */
+    class Operation
+    {
+      public:
+        explicit Operation(char const *op);
+        Operation(Operation const &) = delete;
+        Operation &operator=(Operation const &) = delete;
+        ~Operation();
+
+      private:
+        char const *previous_;
+    };
+
+    /**
+	 * The operation the calling thread is sending commands for, or the empty string
+	 */
+    static char const *current_operation();
+
+    void command_completed(TPM_CC command, TPM_HANDLE handle, TPM_RC rc, Tpm_clock::time_point start,
+      Tpm_clock::time_point end) override;
+
+    /**
+	 * The recorded commands, oldest first
+	 */
+    std::vector<Record> records() const;
+
+    /**
+	 * The recorded commands formatted for the log, one per line, oldest first. Times are relative to now.
+	 */
+    std::string to_string() const;
+
+  private:
+    mutable std::mutex mutex_;
+    std::array<Record, capacity> ring_{};
+    // The number of commands ever recorded, the next goes in ring_[count_ % capacity]
+    uint64_t count_{ 0 };
+};
@@ -0,0 +1,73 @@
+/*******************************************************************************
+* File:        Key_blob_tag.h
+* Description: A host-side tag on the key blobs, checked before they are sent to the TPM
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include "Byte_buffer.h"
+
+// The HMAC-SHA256 tag appended to a key's marshalled private data is truncated to this
+constexpr size_t key_blob_tag_bytes = 8;
+constexpr size_t key_blob_tag_key_bytes = 32;
+
+enum class Key_blob_tag_check
+{
+    tagged,     // the tag is good and has been removed
+    untagged,   // the private data has no tag, e.g. it was created before tags were added
+    bad_tag     // the key was not created by this authenticator or has been altered
+};
+
+// A new random key for the tags, one per authenticator
+Byte_buffer new_key_blob_tag_key();
+
+// The key's marshalled private data with the tag over the key's public and private data appended
+Byte_buffer add_key_blob_tag(
+Byte_buffer const& tag_key,
+Byte_buffer const& public_data,
+Byte_buffer const& private_data
+);
+
+// Check the tag on a key's private data and remove it. Only the host's HMAC is used, so a key
+// blob from another authenticator is rejected in microseconds rather than by a failed TPM2_Load
+Key_blob_tag_check check_key_blob_tag(
+Byte_buffer const& tag_key,
+Byte_buffer const& public_data,
+Byte_buffer* private_data
+);
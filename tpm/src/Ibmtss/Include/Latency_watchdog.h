@@ -0,0 +1,176 @@
+/*******************************************************************************
+* File:        Latency_watchdog.h
+* Description: Watches the TPM commands for ones that take longer than their budget
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "Tss_includes.h"
+#include "Tss_execute.h"
+
+/**
+ * Checks each TPM command against a latency budget for its command code. A command that takes longer
+ * than its budget is counted and reported, as a rate limited Slow_command event once it completes, and,
+ * if an overrun handler is set, as soon as the budget runs out while the TPM is still busy. That lets the
+ * host show that the authenticator is still processing, e.g. while the TPM runs a self test or writes NV.
+ */
+class Latency_watchdog : public Tpm_command_observer
+{
+  public:
+    using Microseconds = std::chrono::microseconds;
+
+    struct Command_stats
+    {
+        uint64_t commands;
+        uint64_t over_budget;
+        uint32_t budget_us;
+        uint32_t worst_us;
+    };
+
+    // The TPM commands sent for one host request, see Request_scope.h
+    struct Request_stats
+    {
+        uint64_t commands;
+        uint64_t tpm_us;
+        uint32_t worst_us;
+        TPM_CC worst_command;
+    };
+
+    // A command that took longer than its budget
+    struct Slow_command
+    {
+        TPM_CC command;
+        TPM_HANDLE handle;
+        TPM_RC rc;
+        uint32_t duration_us;
+        uint32_t budget_us;
+        // Over budget commands with this command code, including this one
+        uint64_t over_budget;
+        // Slow commands not reported since the last event, because of the rate limit
+        uint64_t suppressed;
+    };
+
+    // Called on the thread that sent the command
+    using Event_handler = std::function<void(Slow_command const &)>;
+    // Called on the watchdog's thread while the command is still running
+    using Overrun_handler = std::function<void(TPM_CC command, uint32_t elapsed_ms)>;
+
+    Latency_watchdog();
+    Latency_watchdog(Latency_watchdog const &) = delete;
+    Latency_watchdog &operator=(Latency_watchdog const &) = delete;
+    ~Latency_watchdog() override;
+
+    void set_budget(TPM_CC command, Microseconds budget);
+    Microseconds budget(TPM_CC command) const;
+
+    /**
+	 * Report slow commands, at most one event per interval, the rest are counted as suppressed
+	 */
+    void set_event_handler(Event_handler handler, std::chrono::milliseconds interval = std::chrono::seconds(10));
+
+    /**
+	 * Report a command as soon as it overruns its budget. The first handler set starts the watchdog's thread,
+	 * an empty handler stops the reports.
+	 */
+    void set_overrun_handler(Overrun_handler handler);
+
+    Command_stats stats(TPM_CC command) const;
+
+    /**
+	 * The commands sent for one of the most recent requests, all zero if the request is not one of them
+	 */
+    Request_stats request_stats(uint64_t request_id) const;
+
+    void command_started(TPM_CC command, TPM_HANDLE handle, Tpm_clock::time_point start) override;
+    void command_completed(TPM_CC command, TPM_HANDLE handle, TPM_RC rc, Tpm_clock::time_point start,
+      Tpm_clock::time_point end) override;
+
+  private:
+    struct Command_entry
+    {
+        Microseconds budget;
+        uint64_t commands{ 0 };
+        uint64_t over_budget{ 0 };
+        uint32_t worst_us{ 0 };
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    Microseconds default_budget_;
+    std::unordered_map<TPM_CC, Command_entry> commands_;
+
+    struct Request_entry
+    {
+        uint64_t id{ 0 };
+        Request_stats stats{};
+    };
+    // The most recent requests, the oldest is replaced by a new one
+    static constexpr size_t recent_requests = 16;
+    std::array<Request_entry, recent_requests> requests_{};
+    size_t next_request_{ 0 };
+
+    Event_handler event_handler_;
+    std::chrono::milliseconds event_interval_{ std::chrono::seconds(10) };
+    Tpm_clock::time_point last_event_{};
+    bool event_sent_{ false };
+    uint64_t suppressed_{ 0 };
+
+    // The command being sent, the commands on a context are sent one at a time
+    bool in_progress_{ false };
+    uint64_t sequence_{ 0 };
+    TPM_CC current_command_{ 0 };
+    Tpm_clock::time_point started_{};
+    Tpm_clock::time_point deadline_{};
+    uint64_t reported_sequence_{ 0 };
+
+    Overrun_handler overrun_handler_;
+    bool stop_{ false };
+    std::thread thread_;
+
+    Command_entry &entry(TPM_CC command);
+    Request_stats &request_entry(uint64_t request_id);
+    void watch();
+};
@@ -52,3 +52,12 @@ TPM2B_PUBLIC tpm_public,
 TPM2B_PRIVATE tpm_private,
 Load_Out* out
 );
+
+// Execute a Load command that has already been prepared, so the host work of
+// building it can be done while the TPM is busy with something else
+TPM_RC load_key(
+TSS_CONTEXT* tss_context,
+std::string const& parent_auth,
+Load_In* load_key_in,
+Load_Out* out
+);
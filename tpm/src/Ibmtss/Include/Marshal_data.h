@@ -53,7 +53,7 @@ TPM2B_PUBLIC* public_data
 );
 
 TSS_RC unmarshal_public_data_B(
-Byte_buffer& pd_bb,
+Byte_buffer const& pd_bb,
 TPM2B_PUBLIC* public_data_ptr
 );
 
@@ -62,7 +62,7 @@ TPM2B_PRIVATE* private_data
 );
 
 TSS_RC unmarshal_private_data_B(
-Byte_buffer& pd_bb,
+Byte_buffer const& pd_bb,
 TPM2B_PRIVATE* private_data_ptr
 );
 
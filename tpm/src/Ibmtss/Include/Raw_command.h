@@ -0,0 +1,116 @@
+/*******************************************************************************
+* File:        Raw_command.h
+* Description: Pre-marshalled TPM2_Load, TPM2_Sign and TPM2_FlushContext commands
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "Byte_buffer.h"
+#include "Hex_literal.h"
+#include "Tss_includes.h"
+
+// Fast paths for the commands on the signing hot path. The constant parts of
+// each command are compile time byte templates, only the handle, password and
+// parameters are copied in. The command is sent with TSS_Transmit and the
+// response is parsed in place, so TSS_Execute's marshalling, its parameter
+// structures and its handle bookkeeping are all skipped. Only password
+// authorisation is supported.
+//
+// The TSS keeps no Name file for an object loaded with raw_load_key, so it
+// must be flushed with raw_flush_context, not flush_context.
+
+// A marshalled command, ready to send
+struct Raw_command
+{
+    std::array<Byte,MAX_COMMAND_SIZE> buffer;
+    uint32_t size=0;
+};
+
+// An ECDSA signature, in fixed size storage so a signature does not allocate
+struct Raw_ecdsa_signature
+{
+    uint16_t r_size=0;
+    Byte_block<MAX_ECC_KEY_BYTES> r;
+    uint16_t s_size=0;
+    Byte_block<MAX_ECC_KEY_BYTES> s;
+};
+
+// Build a Load command, the public and private data are the marshalled
+// TPM2B_PUBLIC and TPM2B_PRIVATE as stored for the key
+TPM_RC raw_load_command(
+TPM_HANDLE parent_handle,
+std::string const& parent_auth,
+Byte_buffer const& public_data,
+Byte_buffer const& private_data,
+Raw_command* command
+);
+
+// Build a Sign command for a SHA256 digest, ECDSA scheme
+TPM_RC raw_ecdsa_sign_command(
+TPM_HANDLE key_handle,
+std::string const& key_auth,
+Byte_buffer const& digest,
+Raw_command* command
+);
+
+// Change the (only) handle of a built command, e.g. the key handle of a Sign
+// command built before the key was loaded
+void raw_set_handle(
+Raw_command* command,
+TPM_HANDLE handle
+);
+
+TPM_RC raw_load_key(
+TSS_CONTEXT* tss_context,
+Raw_command const& command,
+TPM_HANDLE* handle
+);
+
+TPM_RC raw_ecdsa_sign(
+TSS_CONTEXT* tss_context,
+Raw_command const& command,
+Raw_ecdsa_signature* signature
+);
+
+TPM_RC raw_flush_context(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle
+);
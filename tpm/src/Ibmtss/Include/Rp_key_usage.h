@@ -0,0 +1,117 @@
+/*******************************************************************************
+* File:        Rp_key_usage.h
+* Description: Per-user usage statistics for the relying party keys, used to predict the keys to preload
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Byte_buffer.h"
+
+/**
+ * How recently and how often each user has loaded each of their relying party
+ * keys, kept for the keys to preload when the user key is next loaded. Users and
+ * keys are identified by the SHA256 digest of the key's public data, and the
+ * key data is kept so the keys can be loaded without the host. A key's score
+ * is its number of uses, halved for every half_life uses (of any key) since it
+ * was last used. Only the best max_keys keys of each user, and the most recent
+ * max_users users, are kept.
+ */
+class Rp_key_usage
+{
+  public:
+    static constexpr size_t max_users = 16;
+    static constexpr size_t max_keys = 32;
+    static constexpr double half_life = 8.0;
+
+    struct Key
+    {
+        Byte_buffer public_data;
+        Byte_buffer private_data;
+    };
+
+    /**
+	 * Record a use of a relying party key.
+	 *
+	 * @param user_public_data - the public data of the relying party key's parent, the user key
+	 */
+    void record_use(Byte_buffer const &user_public_data, Byte_buffer const &public_data, Byte_buffer const &private_data);
+
+    /**
+	 * The user's keys most likely to be used next, most likely first.
+	 *
+	 * @param count - the most keys to return
+	 */
+    std::vector<Key> predict(Byte_buffer const &user_public_data, size_t count) const;
+
+    // True if there are uses that have not been serialised
+    bool changed() const { return changed_; }
+
+    Byte_buffer serialise();
+
+    /**
+	 * Replace the statistics with those serialised by serialise().
+	 *
+	 * @throw std::runtime_error - if the data is corrupt
+	 */
+    void deserialise(Byte_buffer const &bb);
+
+  private:
+    struct Entry
+    {
+        Byte_buffer key_digest;
+        Key key;
+        uint32_t uses;
+        uint32_t last_use;
+    };
+    struct User
+    {
+        Byte_buffer user_digest;
+        uint32_t last_use;
+        std::vector<Entry> entries;
+    };
+
+    // Counts the uses of all keys
+    uint32_t clock_{ 0 };
+    std::vector<User> users_;
+    bool changed_{ false };
+
+    double score(Entry const &entry) const;
+};
@@ -0,0 +1,132 @@
+/*******************************************************************************
+* File:        Span_tracer.h
+* Description: Records operations and TPM commands as spans, for a trace viewer
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "Tss_includes.h"
+#include "Tss_execute.h"
+
+/**
+ * Records the operations, and the TPM commands they send, as spans with their start and end times,
+ * the thread and how deeply they are nested, and writes them as Chrome trace event JSON. Loaded into
+ * a trace viewer (chrome://tracing, Perfetto) that shows where the time in setup or in a request goes.
+ * Times are on Tpm_clock, the steady clock Tpm_timer uses, relative to when tracing was started.
+ * It is off until started, then a span costs a clock read and a short append under a lock. At most
+ * capacity spans are kept, later ones are counted but dropped.
+ */
+class Span_tracer : public Tpm_command_observer
+{
+  public:
+    static constexpr std::size_t capacity = 1 << 16;
+
+    struct Event
+    {
+        // The operation, a string literal, or nullptr for a TPM command
+        char const *name;
+        TPM_CC command;
+        TPM_RC rc;
+        // The host request, see Request_scope.h
+        uint64_t request_id;
+        uint32_t request_tag;
+        // A small number for the thread, in the order threads first recorded a span
+        uint32_t thread;
+        // The number of spans the thread had open when this one started
+        uint32_t depth;
+        Tpm_clock::time_point start;
+        Tpm_clock::time_point end;
+    };
+
+    /**
+	 * Records the calling thread's time in an operation, from construction until it goes out of scope,
+	 * if tracing was on when it started. The name must be a string literal. Spans opened while it is
+	 * open are nested in it.
+	 */
+    class Span
+    {
+      public:
+        Span(Span_tracer &tracer, char const *name);
+        Span(Span const &) = delete;
+        Span &operator=(Span const &) = delete;
+        ~Span();
+
+      private:
+        Span_tracer *tracer_;
+        char const *name_;
+        uint32_t depth_;
+        Tpm_clock::time_point start_;
+    };
+
+    /**
+	 * Clears any recorded spans and starts recording
+	 */
+    void start();
+    /**
+	 * Stops recording, the spans are kept until the next start()
+	 */
+    void stop();
+    bool tracing() const { return tracing_.load(std::memory_order_relaxed); }
+
+    void command_completed(TPM_CC command, TPM_HANDLE handle, TPM_RC rc, Tpm_clock::time_point start,
+      Tpm_clock::time_point end) override;
+
+    /**
+	 * The recorded spans, in the order they ended
+	 */
+    std::vector<Event> events() const;
+
+    /**
+	 * Writes the recorded spans as a Chrome trace event JSON object, with microsecond timestamps
+	 */
+    void write_chrome_trace(std::ostream &os) const;
+
+  private:
+    void add(Event const &event);
+
+    std::atomic<bool> tracing_{ false };
+    mutable std::mutex mutex_;
+    Tpm_clock::time_point epoch_{ Tpm_clock::now() };
+    std::vector<Event> events_;
+    uint64_t dropped_{ 0 };
+};
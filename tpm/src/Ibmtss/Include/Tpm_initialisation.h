@@ -42,12 +42,18 @@
 
 TPM_RC powerup(Tss_setup const& tps);
 
-TPM_RC startup(TSS_CONTEXT* tss_context);
+// TPM_SU_STATE resumes the state saved by a TPM_SU_STATE shutdown, it fails
+// if there was no such shutdown
+TPM_RC startup(TSS_CONTEXT* tss_context, TPM_SU startup_type=TPM_SU_CLEAR);
 
-TPM_RC shutdown(TSS_CONTEXT* tss_context);
+// TPM_SU_STATE saves the state needed to resume, saved contexts stay valid
+TPM_RC shutdown(TSS_CONTEXT* tss_context, TPM_SU shutdown_type=TPM_SU_CLEAR);
 
 bool persistent_key_available(TSS_CONTEXT* tss_context,TPM_HANDLE handle);
 
+// The number of objects that can still be loaded into transient slots
+TPM_RC transient_slots_available(TSS_CONTEXT* tss_context, uint32_t* available);
+
 std::vector<TPM_HANDLE> retrieve_persistent_handles(TSS_CONTEXT* tss_context, uint32_t ph_count);
 
 TPM_RC make_key_persistent(TSS_CONTEXT* tss_context,TPM_HANDLE key_handle,TPM_HANDLE persistent_handle);
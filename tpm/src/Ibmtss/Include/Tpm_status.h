@@ -0,0 +1,99 @@
+/*******************************************************************************
+* File:        Tpm_status.h
+* Description: Exception-free error reporting for the TPM calls
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <variant>
+#include "Tss_includes.h"
+#include "Web_authn_structures.h"
+
+/**
+ * The status of a TPM operation: success, or the operation that failed, the
+ * stage it failed in, what failed and the TPM (or TSS) return code. The
+ * operation and description must be string literals, so nothing is allocated
+ * when a call fails. The full message, including the TSS's description of the
+ * return code, is only formatted when message() is called.
+ */
+class Tpm_status
+{
+  public:
+    constexpr Tpm_status() = default;
+    // A failed TPM (or TSS) call, the error is classified from the return code
+    constexpr Tpm_status(char const *op, Web_authn_stage stage, char const *what, TPM_RC rc)
+      : op_(op), what_(what), stage_(stage), rc_(rc) {}
+    // A failure that did not come from the TPM
+    constexpr Tpm_status(char const *op, Web_authn_stage stage, char const *what, Web_authn_error error)
+      : op_(op), what_(what), stage_(stage), error_(error) {}
+    bool ok() const { return what_ == nullptr; }
+    char const *op() const { return op_ == nullptr ? "" : op_; }
+    char const *what() const { return what_ == nullptr ? "" : what_; }
+    Web_authn_stage stage() const { return stage_; }
+    TPM_RC rc() const { return rc_; }
+    Web_authn_error error() const;
+    Web_authn_status web_authn_status() const;
+    std::string message() const;
+
+  private:
+    char const *op_{ nullptr };
+    char const *what_{ nullptr };
+    Web_authn_stage stage_{ Web_authn_stage::none };
+    TPM_RC rc_{ 0 };
+    // ok means classify rc_
+    Web_authn_error error_{ Web_authn_error::ok };
+};
+
+/**
+ * Either a value or the status of the call that failed to produce it.
+ */
+template<typename T, typename E = Tpm_status>
+class Result
+{
+  public:
+    Result(T value) : result_(std::in_place_index<0>, std::move(value)) {}
+    Result(E error) : result_(std::in_place_index<1>, std::move(error)) {}
+    bool ok() const { return result_.index() == 0; }
+    T &value() { return std::get<0>(result_); }
+    T const &value() const { return std::get<0>(result_); }
+    E status() const { return ok() ? E() : std::get<1>(result_); }
+
+  private:
+    std::variant<T, E> result_;
+};
@@ -0,0 +1,80 @@
+/*******************************************************************************
+* File:        Tpm_worker.h
+* Description: A thread that runs TPM commands in order, so host work can overlap them
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/**
+ * Runs tasks, in the order they were submitted, on a single thread. The
+ * thread is started by the first submit() and stopped, after any queued tasks
+ * have run, by the destructor. Used to keep the TPM busy while the caller's
+ * thread does the host work either side of the TPM commands.
+ */
+class Tpm_worker
+{
+  public:
+    Tpm_worker() = default;
+    Tpm_worker(Tpm_worker const &) = delete;
+    Tpm_worker &operator=(Tpm_worker const &) = delete;
+
+    /**
+	 * Queue a task to run on the worker's thread.
+	 *
+	 * @return - becomes ready when the task has run, get() rethrows any exception it threw
+	 */
+    std::future<void> submit(std::function<void()> task);
+
+    ~Tpm_worker();
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    bool stop_{ false };
+    std::thread thread_;
+
+    void run();
+};
@@ -0,0 +1,153 @@
+/*******************************************************************************
+* File:        Tss_execute.h
+* Description: Sends TPM commands, reporting each one to an observer
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "Tss_includes.h"
+
+// Every TPM command in the library is sent with tss_execute or tss_transmit,
+// so an observer set on a TSS context sees each command's code, its (first)
+// handle, its return code and how long the TPM took. With no observer set a
+// command costs one registry lookup more than calling the TSS directly.
+
+using Tpm_clock=std::chrono::steady_clock;
+
+class Tpm_command_observer
+{
+  public:
+    virtual ~Tpm_command_observer() = default;
+    // Called on the thread sending the command, just before it is sent
+    virtual void command_started(
+      TPM_CC /*command*/,
+      TPM_HANDLE /*handle*/,
+      Tpm_clock::time_point /*start*/) {}
+    // Called on the thread that sent the command, once the response is in
+    virtual void command_completed(
+      TPM_CC command,
+      TPM_HANDLE handle,
+      TPM_RC rc,
+      Tpm_clock::time_point start,
+      Tpm_clock::time_point end) = 0;
+};
+
+// Passes each command on to several observers, in order
+class Tpm_command_observers : public Tpm_command_observer
+{
+  public:
+    Tpm_command_observers(std::initializer_list<Tpm_command_observer*> observers) : observers_(observers) {}
+    void command_started(
+      TPM_CC command,
+      TPM_HANDLE handle,
+      Tpm_clock::time_point start) override
+    {
+        for (auto* o : observers_)
+            o->command_started(command,handle,start);
+    }
+    void command_completed(
+      TPM_CC command,
+      TPM_HANDLE handle,
+      TPM_RC rc,
+      Tpm_clock::time_point start,
+      Tpm_clock::time_point end) override
+    {
+        for (auto* o : observers_)
+            o->command_completed(command,handle,rc,start,end);
+    }
+
+  private:
+    std::vector<Tpm_command_observer*> observers_;
+};
+
+// Set (or, with nullptr, remove) the observer for a TSS context. The observer
+// must be removed before it, or the context, is deleted
+void set_command_observer(
+TSS_CONTEXT* tss_context,
+Tpm_command_observer* observer
+);
+
+Tpm_command_observer* command_observer(
+TSS_CONTEXT* tss_context
+);
+
+// TSS_Execute, with the command's handle (zero if it has none) for the
+// observer. The sessions are passed on unchanged
+template<typename... Sessions>
+TPM_RC tss_execute(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle,
+RESPONSE_PARAMETERS* out,
+COMMAND_PARAMETERS* in,
+EXTRA_PARAMETERS* extra,
+TPM_CC command,
+Sessions... sessions
+)
+{
+    Tpm_command_observer* observer=command_observer(tss_context);
+    if (observer==nullptr)
+    {
+        return TSS_Execute(tss_context,out,in,extra,command,sessions...);
+    }
+    auto start=Tpm_clock::now();
+    observer->command_started(command,handle,start);
+    TPM_RC rc=TSS_Execute(tss_context,out,in,extra,command,sessions...);
+    observer->command_completed(command,handle,rc,start,Tpm_clock::now());
+    return rc;
+}
+
+// TSS_Transmit, for a command that has already been marshalled
+TPM_RC tss_transmit(
+TSS_CONTEXT* tss_context,
+TPM_HANDLE handle,
+TPM_CC command,
+uint8_t* response,
+uint32_t* read,
+uint8_t const* command_buffer,
+uint32_t written,
+char const* message
+);
+
+// The command's name, for logging, e.g. "Load"
+char const* tpm_command_name(
+TPM_CC command
+);
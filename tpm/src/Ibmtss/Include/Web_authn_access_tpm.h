@@ -48,35 +48,112 @@
 #include "Web_authn_structures.h"
 #include "Web_authn_tpm.h"
 
+#define WEB_AUTHN_ERROR uint32_t(-1)// Define this properly later to not clash with other return values
+
+// The C API is the only part of libwatpm that is exported when it is built
+// with ENABLE_HIDDEN_VISIBILITY
+#define WATPM_API __attribute__((visibility("default")))
 
 extern "C" {
 // Allocate memory for the TPM class and return a void* pointer to it
-void *install_tpm();
+WATPM_API void *install_tpm();
 
 // Setup the TPM
-TPM_RC setup_tpm(void *v_tpm_ptr, bool use_hw_tpm, const char *tpm_data_dir, const char *log_filename);
+WATPM_API TPM_RC setup_tpm(void *v_tpm_ptr, bool use_hw_tpm, const char *tpm_data_dir, const char *log_filename);
 
 // Set the logging level
-TPM_RC set_log_level(void *v_tpm_ptr, int log_level);
+WATPM_API TPM_RC set_log_level(void *v_tpm_ptr, int log_level);
+
+// Set the logging level of one Log_component, set_log_level sets them all. Can be called at any time
+WATPM_API TPM_RC set_component_log_level(void *v_tpm_ptr, int component, int log_level);
+
+// Only write the debug records of one in every one_in requests, selected by the request id. 1 writes them all
+WATPM_API TPM_RC set_debug_sampling(void *v_tpm_ptr, uint32_t one_in);
+
+// Tag the calls made on this instance, until the next set_request_context, with the host's request, for the
+// log, the flight record and get_request_stats. A null request clears it
+WATPM_API TPM_RC set_request_context(void *v_tpm_ptr, Request_context const *request);
+
+// Save the loaded keys' contexts and the TPM's state at uninstall, and restore them at the next setup. Call
+// before setup_tpm
+WATPM_API TPM_RC set_preserve_state(void *v_tpm_ptr, bool preserve_state);
+
+// Keep the TSS's object and session state off the disk. With the default libtss its files are only moved to
+// tmpfs, the file calls per command are unchanged, only a TSS_NOFILE build removes them. Call before setup_tpm
+WATPM_API TPM_RC set_tss_state_in_memory(void *v_tpm_ptr, bool in_memory);
+
+// Reject key data without the tag this library adds to the keys it creates, rather than only key data with
+// the wrong tag
+WATPM_API TPM_RC set_require_key_blob_tags(void *v_tpm_ptr, bool require_tags);
 
 // Return the last error
-const char *get_last_error(void *v_tpm_ptr);
+WATPM_API const char *get_last_error(void *v_tpm_ptr);
+
+// Fill in the caller's status with the details of the last failed call. Returns 0, or WEB_AUTHN_ERROR
+// if either pointer is null
+WATPM_API TPM_RC get_last_status(void *v_tpm_ptr, Web_authn_status *status);
+
+// Return the most recent TPM commands, one per line, oldest first. They are also written to the log
+// whenever a call fails
+WATPM_API const char *get_flight_record(void *v_tpm_ptr);
+
+// Write the most recent TPM commands to the log
+WATPM_API TPM_RC dump_flight_record(void *v_tpm_ptr);
+
+// Start (clearing any earlier spans), or stop, recording the time spent in each call and TPM command
+WATPM_API TPM_RC set_tracing(void *v_tpm_ptr, bool tracing);
+
+// Write the spans recorded since tracing started to a file, as Chrome trace event JSON
+WATPM_API TPM_RC write_trace(void *v_tpm_ptr, const char *filename);
+
+// Set the latency budget for a TPM command code, slower commands are counted and logged
+WATPM_API TPM_RC set_command_budget(void *v_tpm_ptr, uint32_t command_code, uint32_t budget_ms);
+
+// Call back, on a watchdog thread, when a TPM command overruns its budget while it is still running. A null
+// callback removes it
+WATPM_API TPM_RC set_slow_command_callback(void *v_tpm_ptr, Slow_command_callback callback, void *user_data);
+
+// Fill in the latency statistics for a TPM command code. Returns 0, or WEB_AUTHN_ERROR if either pointer is null
+WATPM_API TPM_RC get_command_stats(void *v_tpm_ptr, uint32_t command_code, Tpm_command_stats *stats);
+
+// Fill in the TPM commands sent for one of the 16 most recent requests, see set_request_context, or zeros for an
+// older one. Returns 0, or WEB_AUTHN_ERROR if either pointer is null
+WATPM_API TPM_RC get_request_stats(void *v_tpm_ptr, uint64_t request_id, Tpm_request_stats *stats);
 
 // Call the TPM class' destructor, flushing any keys from the TPM and freeing any memory
-void uninstall_tpm(void *v_tpm_ptr);
+WATPM_API void uninstall_tpm(void *v_tpm_ptr);
 
 // No parent authorisation as we are using the SRK with no password.
-Key_data create_and_load_user_key(void *v_tpm_ptr, Byte_array user, Byte_array key_auth);
+WATPM_API Key_data create_and_load_user_key(void *v_tpm_ptr, Byte_array user, Byte_array key_auth);
 
 // No parent authorisation as we are using the SRK with no password, key authorisation not needed to load the key.
-TPM_RC load_user_key(void *v_tpm_ptr, Key_data kd, Byte_array user);
+WATPM_API TPM_RC load_user_key(void *v_tpm_ptr, Key_data kd, Byte_array user);
+
+WATPM_API Relying_party_key create_and_load_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_array user_auth, Byte_array rp_key_auth);
+
+WATPM_API Key_ecc_point load_rp_key(void *v_tpm_ptr, Key_data kd, Byte_array relying_party, Byte_array user_auth);
+
+// Preload, in the background, up to count of the loaded user's most used relying party keys. Call after
+// load_user_key, user_auth is the user key's authorisation
+WATPM_API TPM_RC preload_rp_keys(void *v_tpm_ptr, Byte_array user_auth, uint32_t count);
+
+// Fill in the number of keys preloaded and how many were used. Returns 0, or WEB_AUTHN_ERROR if either
+// pointer is null
+WATPM_API TPM_RC get_preload_stats(void *v_tpm_ptr, Rp_key_preload_stats *stats);
+
+WATPM_API Ecdsa_sig sign_using_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_array signing_data, Byte_array rp_key_auth);
 
-Relying_party_key create_and_load_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_array user_auth, Byte_array rp_key_auth);
+// Sign the first credential for a getAssertion and start signing the next one in the background. keys,
+// rp_key_auths and digests each hold count entries, in the order the credentials will be returned
+WATPM_API Ecdsa_sig begin_assertions(void *v_tpm_ptr, uint64_t channel, uint32_t count, Key_data const *keys,
+  Byte_array const *rp_key_auths, Byte_array const *digests, Byte_array user_auth);
 
-Key_ecc_point load_rp_key(void *v_tpm_ptr, Key_data kd, Byte_array relying_party, Byte_array user_auth);
+// The signature for the next credential of the getAssertion in progress on the channel
+WATPM_API Ecdsa_sig next_assertion(void *v_tpm_ptr, uint64_t channel);
 
-Ecdsa_sig sign_using_rp_key(void *v_tpm_ptr, Byte_array relying_party, Byte_array signing_data, Byte_array rp_key_auth);
+// End the getAssertion, discarding any signature made in advance
+WATPM_API TPM_RC end_assertions(void *v_tpm_ptr);
 
-TPM_RC flush_data(void *v_tpm_ptr);
+WATPM_API TPM_RC flush_data(void *v_tpm_ptr);
 
 }// end of extern "C"
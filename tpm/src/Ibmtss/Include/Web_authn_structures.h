@@ -87,3 +87,113 @@ struct Ecdsa_sig
     Byte_array sig_r;
     Byte_array sig_s;
 };
+
+/* Why the last call failed. The values are part of the C API and will not
+ * change, new values will only be added at the end.
+ */
+enum class Web_authn_error : uint32_t
+{
+    ok = 0,
+    bad_parameter = 1,    // e.g. an invalid log level
+    auth_failed = 2,      // the authorisation (password) for a key is wrong
+    lockout = 3,          // the TPM is in dictionary attack lockout
+    key_not_loaded = 4,   // the key's handle is not valid, reload the key
+    bad_key_blob = 5,     // the key data is corrupt or was not created on this TPM
+    tpm_busy = 6,         // a transient TPM condition, retry the call (after a flush for TPM memory)
+    tpm_error = 7,        // any other TPM error
+    tss_error = 8,        // an error from the TSS, e.g. no connection to the TPM
+    internal_error = 9,   // an unexpected failure in the library
+    not_allowed = 10      // no getAssertion in progress, it has expired or the channel changed
+};
+
+/* The stage of the call that failed. The values are part of the C API and
+ * will not change.
+ */
+enum class Web_authn_stage : uint32_t
+{
+    none = 0,
+    setup = 1,
+    flush = 2,
+    unmarshal = 3,
+    create = 4,
+    load = 5,
+    sign = 6
+};
+
+/* The parts of the authenticator that have their own log level, set with
+ * set_component_log_level. The values are part of the C API and will not
+ * change.
+ */
+enum class Log_component : int
+{
+    setup = 0,      // setup, the settings and tidying up
+    keys = 1,       // creating, loading, flushing and preloading keys
+    sign = 2,       // signatures and assertions
+    tss = 3,        // failed TPM commands, latency budgets and slow commands
+    storage = 4     // the files in the data directory
+};
+constexpr int log_component_count = 5;
+
+/* The status of the last failed call, filled in by get_last_status. The
+ * underlying TPM_RC is split into its fields so no parsing is needed.
+ */
+struct Web_authn_status
+{
+    Web_authn_error error;
+    Web_authn_stage stage;
+    uint32_t tpm_rc;        // the TPM_RC (or TSS_RC) that was returned, 0 if none
+    uint32_t rc_layer;      // bits 16-23 of tpm_rc: 0 for the TPM, otherwise a TSS layer
+    uint32_t rc_parameter;  // 1-15 for an error in that command parameter, otherwise 0
+    uint32_t rc_handle;     // 1-7 for an error in that command handle, otherwise 0
+    uint32_t rc_session;    // 1-7 for an error in that session, otherwise 0
+};
+
+/* The latency of one TPM command code, filled in by get_command_stats
+ */
+struct Tpm_command_stats
+{
+    uint64_t commands;      // the number sent
+    uint64_t over_budget;   // the number that took longer than the budget
+    uint32_t budget_us;     // the latency budget
+    uint32_t worst_us;      // the longest one has taken
+};
+
+/* The TPM commands sent for one host request, filled in by get_request_stats.
+ * The commands run for the request on the getAssertion and preload threads
+ * are included.
+ */
+struct Tpm_request_stats
+{
+    uint64_t commands;      // the number sent
+    uint64_t tpm_us;        // the time the TPM took for them
+    uint32_t worst_us;      // the longest one took
+    uint32_t worst_command; // its command code
+};
+
+/* The relying party keys loaded in advance by preload_rp_keys, filled in by
+ * get_preload_stats. A hit is a load_rp_key, or a getAssertion credential, that
+ * used a preloaded key, a miss one that did not while keys were preloaded.
+ */
+struct Rp_key_preload_stats
+{
+    uint64_t preloaded;     // the keys loaded in advance
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t unused;        // the preloaded keys discarded without being used
+};
+
+/* Called, on a watchdog thread, when a TPM command is still running after its
+ * latency budget has run out. The host can use it to report that the
+ * authenticator is still processing.
+ */
+typedef void (*Slow_command_callback)(void *user_data, uint32_t command_code, uint32_t elapsed_ms);
+
+/* The host request (e.g. a CTAP command) that calls are made for, so the log
+ * and the TPM commands can be tied back to it. The host chooses the id, zero
+ * means no request. The tag is the operation, e.g. the CTAP command code.
+ */
+struct Request_context
+{
+    uint64_t id;
+    uint32_t tag;
+};
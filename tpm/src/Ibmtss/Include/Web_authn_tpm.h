@@ -42,12 +42,24 @@
 #include <string>
 #include <chrono>
 #include <array>
+#include <atomic>
 #include <fstream>
+#include <future>
+#include <mutex>
+#include <vector>
 #include "Tss_includes.h"
 #include "Tss_setup.h"
 #include "Logging.h"
 #include "Byte_buffer.h"
+#include "Io_utils.h"
 #include "Tpm_timer.h"
+#include "Tpm_status.h"
+#include "Assertion_iterator.h"
+#include "Flight_recorder.h"
+#include "Latency_watchdog.h"
+#include "Rp_key_usage.h"
+#include "Span_tracer.h"
+#include "Tpm_worker.h"
 #include "Web_authn_structures.h"
 
 
@@ -76,7 +88,7 @@ class Web_authn_tpm
     /**
 	 * Default constructor.
 	 */
-    Web_authn_tpm() : last_error_("No error") {}
+    Web_authn_tpm() = default;
 
     Web_authn_tpm(Web_authn_tpm const &t) = delete;
     Web_authn_tpm &operator=(Web_authn_tpm const &t) = delete;
@@ -102,6 +114,81 @@ class Web_authn_tpm
 	 */
     TPM_RC set_log_level(int log_level);
 
+    /**
+	 * Sets the logging level of one component, so that, e.g., only the signing can be debugged. The levels
+	 * are as for set_log_level(), which sets them all. Can be called while other threads are using the class.
+	 *
+	 * @param component - a Log_component: 0 - setup, 1 - keys, 2 - sign, 3 - tss, 4 - storage.
+	 * @param log_level - the required level of information in the log file for the component.
+	 *
+	 * @return TPM_RC - this will be zero for a successful call. If non-zero use get_last_error() to return the error.
+	 */
+    TPM_RC set_component_log_level(int component, int log_level);
+
+    /**
+	 * Samples the debug records: only the requests whose id is selected, one in every one_in, write them, and
+	 * debug records for no request are not written. Errors and information are always written. The selection
+	 * depends only on the request id, so a sampled request is logged in full, on every thread. Can be called
+	 * while other threads are using the class.
+	 *
+	 * @param one_in - the sampling rate, 1 (the default) writes the debug records for every request.
+	 *
+	 * @return TPM_RC - this will be zero for a successful call. If non-zero use get_last_error() to return the error.
+	 */
+    TPM_RC set_debug_sampling(uint32_t one_in);
+
+    /**
+	 * Tags the calls made on this instance, until the next call to set_request_context(), with the host
+	 * request they are made for. The request's id and tag are written on each log line, recorded with each
+	 * TPM command in the flight record and counted in get_request_stats(), including the commands run for
+	 * the request on the getAssertion and preload threads.
+	 *
+	 * @param request - the request, or nullptr (or a zero id) for none.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_request_context(Request_context const *request);
+
+    /**
+	 * Selects an orderly, state preserving, shutdown. When set, the contexts of the loaded user and relying
+	 * party keys are saved in the data directory when the class is destroyed, and the TPM is shut down with
+	 * TPM_SU_STATE. setup() then resumes the TPM's state and restores the keys, so the next load_user_key()
+	 * and load_rp_key() for the same keys need no TPM2_Load. A digest of the user_auth the relying party key
+	 * was loaded with is saved with the contexts, and the restored key is only used by a load_rp_key() with
+	 * the same user_auth, any other loads it again. Must be set before setup() to resume.
+	 *
+	 * @param preserve_state - true to save and restore the state, false (the default) for a clear shutdown.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_preserve_state(bool preserve_state);
+
+    /**
+	 * Keeps the TSS's object, session and NV state off the disk. It only removes the TSS's file operations
+	 * with a TSS built without file support (the TSS_NOFILE build option), which always keeps the state in
+	 * memory. With the default libtss the TSS is given a private directory on tmpfs, removed when the class
+	 * is destroyed. It still opens, writes and removes a file around each command, the same calls as
+	 * without this setting, but the files never reach the disk. The log and the saved contexts stay in the
+	 * data directory. Must be set before setup().
+	 *
+	 * @param in_memory - true to keep the TSS's state in memory, false (the default) for the data directory.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_tss_state_in_memory(bool in_memory);
+
+    /**
+	 * The private data of the keys returned by create_and_load_user_key() and create_and_load_rp_key() carries
+	 * a truncated HMAC tag under a key kept in the data directory, so key data from another authenticator is
+	 * rejected, with a bad_key_blob error, before the TPM is used; a key that is already loaded stays loaded.
+	 * Key data created before the tags were added is loaded as before unless tags are required.
+	 *
+	 * @param require_tags - true to reject key data without a tag, false (the default) to load it.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_require_key_blob_tags(bool require_tags);
+
     /**
 	 * Creates a new user (storage) key and loads it ready for use. If a user key is already loaded, it and its
 	 * relying party key (if one is loaded) are flushed and their data removed.
@@ -150,6 +237,32 @@ class Web_authn_tpm
 	 */
     Key_ecc_point load_rp_key(Key_data const &key, std::string const &relying_party, std::string const &user_auth);
 
+    /**
+	 * Preload, in the background, the relying party keys the loaded user is most likely to use next. Each
+	 * load_rp_key(), create_and_load_rp_key() and getAssertion credential is recorded, per user, in the data
+	 * directory, and the keys are ranked by how often and how recently they were used. Keys are kept loaded
+	 * while the TPM has transient slots to spare, and as saved contexts otherwise, until the user key is
+	 * flushed. A later load_rp_key() or getAssertion for a preloaded key uses it in place of a TPM2_Load. Any
+	 * other call that uses the TPM stops the preloading once the key being loaded is ready. Call it after
+	 * load_user_key(), the keys' parent authorisation is needed to load them. It ends any getAssertion, as
+	 * does load_rp_key(), since either may flush a key the getAssertion would sign with.
+	 *
+	 * @param user_auth - authorisation string for the keys' user (parent). This could be empty.
+	 * @param count - the most keys to preload.
+	 *
+	 * @return TPM_RC - zero if the preloading was started (or there was nothing to preload). If non-zero use
+	 * get_last_error() to return the error.
+	 */
+    TPM_RC preload_rp_keys(std::string const &user_auth, uint32_t count);
+
+    /**
+	 * Returns the number of keys preloaded by preload_rp_keys() and how many of them were used.
+	 *
+	 * @return - the keys preloaded, the hits and misses of the loads made while keys were preloaded, and the
+	 * keys that were never used.
+	 */
+    Rp_key_preload_stats get_preload_stats() const;
+
     /**
 	 * Use the loaded relying party's key to calculate an ECDSA signature for the given digest.
 	 * 
@@ -161,6 +274,36 @@ class Web_authn_tpm
 	 */
     Ecdsa_sig sign_using_rp_key(std::string const &relying_party, Byte_buffer const &digest, std::string const &rp_key_auth);
 
+    /**
+	 * Start signing the credentials for a getAssertion. The first credential is signed and returned, the next
+	 * is then signed in the background ready for next_assertion(). Each key is loaded into its own transient
+	 * slot and flushed after signing, so a relying party key loaded with load_rp_key() is left in place.
+	 * Any earlier getAssertion is ended.
+	 * 
+	 * @param channel - the channel the getAssertion came in on.
+	 * @param credentials - the relying party keys, their authorisation and the digests to sign, in order.
+	 * @param user_auth - authorisation string for the keys' user (parent). This could be empty.
+	 *                  
+	 * @return Ecdsa_sig - the first credential's ECDSA signature, null Byte_arrays if the call fails.
+	 */
+    Ecdsa_sig begin_assertions(uint64_t channel, std::vector<Assertion_credential> credentials, std::string const &user_auth);
+
+    /**
+	 * Return the signature for the next credential of the getAssertion, and start signing the one after it.
+	 * Fails, and ends the getAssertion, if the channel has changed or 30 seconds have passed since the last
+	 * signature was returned.
+	 * 
+	 * @param channel - the channel the getNextAssertion came in on.
+	 *                  
+	 * @return Ecdsa_sig - the ECDSA signature, null Byte_arrays if the call fails.
+	 */
+    Ecdsa_sig next_assertion(uint64_t channel);
+
+    /**
+	 * End the getAssertion, any signature made in advance is discarded.
+	 */
+    void end_assertions();
+
     /**
 	 * Returns the last error reported, or the empty string. The last error is cleared ready for next time.
 	 *
@@ -168,6 +311,89 @@ class Web_authn_tpm
 	 */
     std::string get_last_error();
 
+    /**
+	 * Returns the status of the last call that failed: the error, the stage it failed in and the TPM return code
+	 * split into its fields. Unlike get_last_error() it is not cleared.
+	 *
+	 * @return - the status, error is Web_authn_error::ok if no call has failed.
+	 */
+    Web_authn_status get_last_status() const { return last_status_.web_authn_status(); }
+
+    /**
+	 * Returns the most recent TPM commands, oldest first: the operation that sent each one, its command code,
+	 * handle and return code and how long it took. The record is written to the log, at most once every 10 seconds,
+	 * when a TPM command fails, other than for a wrong authorisation or bad key data.
+	 *
+	 * @return - the commands, formatted one per line.
+	 */
+    std::string get_flight_record() const;
+
+    /**
+	 * Writes the most recent TPM commands to the log, whatever the log level.
+	 */
+    void dump_flight_record();
+
+    /**
+	 * Starts, or stops, tracing: recording the time spent in each call, and in the TPM commands it sends, with
+	 * the thread and how they nest. Starting clears the spans recorded so far. Can be called before setup() to
+	 * trace it.
+	 *
+	 * @param tracing - true to start tracing, false to stop.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_tracing(bool tracing);
+
+    /**
+	 * Writes the spans recorded since tracing was started to a file, as Chrome trace event JSON, which can be
+	 * loaded into chrome://tracing or Perfetto.
+	 *
+	 * @param filename - the file to write.
+	 *
+	 * @return TPM_RC - this will be zero for a successful call. If non-zero use get_last_error() to return the error.
+	 */
+    TPM_RC write_trace(std::string const &filename);
+
+    /**
+	 * Sets the latency budget for a TPM command. A command that takes longer is counted and logged (at most
+	 * one log entry every 10 seconds), and reported to the slow command callback, if there is one.
+	 *
+	 * @param command_code - the TPM_CC of the command.
+	 * @param budget_ms - the budget, in milliseconds.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_command_budget(TPM_CC command_code, uint32_t budget_ms);
+
+    /**
+	 * Sets a function to be called when a TPM command is still running after its budget has run out. It is
+	 * called on a watchdog thread, so it must not call back into this class.
+	 *
+	 * @param callback - the function, or nullptr for none.
+	 * @param user_data - passed to the callback.
+	 *
+	 * @return TPM_RC - always zero.
+	 */
+    TPM_RC set_slow_command_callback(Slow_command_callback callback, void *user_data);
+
+    /**
+	 * Returns the latency statistics for a TPM command.
+	 *
+	 * @param command_code - the TPM_CC of the command.
+	 *
+	 * @return - the number sent, the number over budget, the budget and the longest one took.
+	 */
+    Tpm_command_stats get_command_stats(TPM_CC command_code) const;
+
+    /**
+	 * Returns the TPM commands sent for one of the 16 most recent requests set by set_request_context().
+	 *
+	 * @param request_id - the request's id.
+	 *
+	 * @return - the number sent, the time the TPM took for them and the slowest, all zero for an older request.
+	 */
+    Tpm_request_stats get_request_stats(uint64_t request_id) const;
+
     /**
 	 * The destructor - tidies up. In particular flushing all of the transient keys from the TPM and doing an orderly shutdown.
 	 * TPM errors when flushing the keys are ignored - we are shutting down. If an error is generated the TPM may need to be
@@ -192,17 +418,99 @@ class Web_authn_tpm
 
   private:
     bool hw_tpm_{ false };
-    Log_level log_level_{ Log_level::info };
+    // Set at runtime, while other threads log
+    std::array<std::atomic<Log_level>, log_component_count> log_levels_{ { Log_level::info, Log_level::info,
+      Log_level::info, Log_level::info, Log_level::info } };
+    std::atomic<uint32_t> debug_sample_one_in_{ 1 };
+    // The request set by set_request_context(), each call sets it for its thread with a Request_scope, and
+    // the work it hands to another thread carries it along
+    Request_context request_{ 0, 0 };
 
     TSS_CONTEXT *tss_context_{ nullptr };
     std::string data_dir_;
     Log_ptr log_ptr_{ new Null_log };
+    // A message that has already been formatted, e.g. from an exception
     std::string last_error_;
+    // The status of the last failed call, only formatted by get_last_error()
+    Tpm_status last_status_;
+    bool error_pending_{ false };
 
     const TPMI_ECC_CURVE curve_ID = TPM_ECC_NIST_P256;
     TPM_HANDLE user_handle_{ 0 };
     TPM_HANDLE rp_handle_{ 0 };
+    // The loaded keys' public data, identifies them when their contexts are saved
+    Byte_buffer user_public_data_;
+    Byte_buffer rp_public_data_;
+
+    // Save the keys' contexts at shutdown and restore them at setup
+    bool preserve_state_{ false };
+    // The TSS's files are kept on tmpfs, in tss_state_dir_, rather than in data_dir_
+    bool tss_state_in_memory_{ false };
+    std::string tss_state_dir_;
+    // Tags the key data returned to the caller, it is checked before any use of the key data
+    Byte_buffer key_blob_tag_key_;
+    bool require_key_blob_tags_{ false };
+    // The key for the digests of the user key authorisations, derived from key_blob_tag_key_ so a digest
+    // saved with the key contexts can be checked after a restart
+    Byte_buffer auth_digest_key_;
+    // The digest of the authorisation accepted for the loaded user key's relying party key, empty if there
+    // is none. It is saved with the key contexts
+    Byte_buffer user_auth_digest_;
 
+    // How often each user's relying party keys are used, to predict the keys to preload
+    Rp_key_usage rp_key_usage_;
+    // A relying party key loaded by preload_rp_keys(), into a transient slot or as a saved context
+    struct Preloaded_key
+    {
+        Byte_buffer public_data;
+        TPM_HANDLE handle;
+        Byte_buffer context_blob;
+        bool used;
+        // The digest of the user key authorisation it was loaded with, it is only used with the same one
+        Byte_buffer auth_digest;
+    };
+    std::vector<Preloaded_key> preloaded_keys_;
+    // The user key the keys were preloaded under, zero if there are none
+    TPM_HANDLE preload_parent_{ 0 };
+    Rp_key_preload_stats preload_stats_{ 0, 0, 0, 0 };
+    // Counted on preload_worker_
+    std::atomic<uint64_t> keys_preloaded_{ 0 };
+    // The preloading runs on preload_worker_, it and preloaded_keys_ are only used on another thread after wait_for_preload()
+    std::atomic<bool> cancel_preload_{ false };
+    std::future<void> preloaded_;
+    Tpm_worker preload_worker_;
+    // A key restored by setup, it is used by the first load of the same key
+    // under the same parent, with the parent's authorisation if it is a user key
+    struct Restored_key
+    {
+        Byte_buffer public_data;
+        TPM_HANDLE parent_handle;
+        TPM_HANDLE handle;
+        // The digest of the parent's authorisation it was loaded with, for a relying party key
+        Byte_buffer parent_auth_digest;
+    };
+    std::vector<Restored_key> restored_keys_;
+
+    // The most recent TPM commands, it and the watchdog observe every command sent on tss_context_
+    Flight_recorder flight_recorder_;
+    // Counts and reports the TPM commands that take longer than their budget
+    Latency_watchdog latency_watchdog_;
+    // The calls and commands, while tracing
+    Span_tracer span_tracer_;
+    Tpm_command_observers command_observers_{ &flight_recorder_, &latency_watchdog_, &span_tracer_ };
+    // The flight record is written for a failed TPM command at most once per interval
+    static constexpr std::chrono::seconds flight_dump_interval{ 10 };
+    std::mutex flight_dump_mutex_;
+    bool flight_dumped_{ false };
+    Monotonic_clock::time_point last_flight_dump_;
+    uint64_t flight_dumps_suppressed_{ 0 };
+
+    // Signs getAssertion credentials, possibly on a background thread. Any other
+    // use of tss_context_ must call assertions_.wait() first, or assertions_.end() if it
+    // flushes a key the getAssertion may use
+    Assertion_iterator assertions_;
+    // The log is shared with the assertions_ thread
+    std::mutex log_mutex_;
 
     // Data for transfer to the caller
     Key_data user_kd_{ { 0, nullptr }, { 0, nullptr } };
@@ -214,23 +522,139 @@ class Web_authn_tpm
 	 * Flush the user key and, if necessary any associated relying party key
 	 * also  frees any associated data (in Byte_arrays).
 	 */
-    void flush_user_key();
+    Tpm_status flush_user_key();
     /**
 	 * Flush the relying party key, only one loaded at a time, also  frees 
 	 * any associated data (in Byte_arrays).
 	 */
-    void flush_rp_key();
+    Tpm_status flush_rp_key();
+    /**
+	 * Unmarshal a key's public and private data, with its tag removed, and load it.
+	 *
+	 * @param op - the calling operation, for the error status
+	 * @param tpm_public - set to the key's unmarshalled public area
+	 * @return - the key's handle, or the status of the call that failed
+	 */
+    Result<TPM_HANDLE> load_key_data(char const *op, Byte_buffer const &public_data_bb, Byte_buffer const &private_data_bb,
+      std::string const &parent_auth, TPM_HANDLE parent_handle, TPM2B_PUBLIC *tpm_public);
+    /**
+	 * Check the tag on a key's private data, and remove it, without using the TPM
+	 *
+	 * @param op - the calling operation, for the error status
+	 * @return - ok, or bad_key_blob if the key data is from another authenticator
+	 */
+    Tpm_status check_key_blob_tag(char const *op, Byte_buffer const &public_data, Byte_buffer *private_data) const;
+    /**
+	 * Save the contexts of the loaded user and relying party keys in the data directory
+	 */
+    void save_contexts();
+    /**
+	 * Load the contexts saved by save_contexts(), if they are still valid, into restored_keys_
+	 */
+    void restore_contexts();
+    /**
+	 * Take a restored key for use. A relying party key is only taken if parent_auth is the user key
+	 * authorisation it was loaded with before the restart
+	 *
+	 * @return - the key's handle, or zero if the key was not restored
+	 */
+    TPM_HANDLE take_restored_key(Byte_buffer const &public_data, TPM_HANDLE parent_handle, std::string const &parent_auth);
+    /**
+	 * The digest of an authorisation, keyed with auth_digest_key_
+	 */
+    Byte_buffer auth_digest(std::string const &auth) const;
+    /**
+	 * Whether the digest is of the authorisation, compared in constant time. An empty digest matches nothing
+	 */
+    bool auth_matches(Byte_buffer const &digest, std::string const &auth) const;
+    /**
+	 * Flush the restored keys that have not been used, except those with the given parent
+	 */
+    void flush_restored_keys(TPM_HANDLE keep_parent);
+    /**
+	 * Load the keys for preload_rp_keys(), on preload_worker_
+	 */
+    void preload_keys(std::vector<Rp_key_usage::Key> const &keys, TPM_HANDLE parent_handle, std::string const &user_auth);
+    /**
+	 * Stop the preloading after the key being loaded, leaving the TPM free
+	 */
+    void wait_for_preload();
+    /**
+	 * Take a key preloaded by preload_rp_keys() for use, counting the hit or miss. It is only taken if
+	 * parent_auth is the authorisation it was preloaded with
+	 *
+	 * @return - the key's handle, or zero if the key was not preloaded
+	 */
+    TPM_HANDLE take_preloaded_key(Byte_buffer const &public_data, TPM_HANDLE parent_handle, std::string const &parent_auth);
+    /**
+	 * Flush the preloaded keys and forget their saved contexts
+	 */
+    void discard_preloaded_keys();
+    /**
+	 * Record a use of a relying party key of the loaded user, for preload_rp_keys()
+	 */
+    void record_rp_key_use(Byte_buffer const &public_data, Byte_buffer const &private_data);
+    /**
+	 * Write the relying party key usage to the data directory, if it has changed
+	 */
+    void save_rp_key_usage();
+    /**
+	 * The stages assertions_ uses to sign a getAssertion credential, none of them set the error. Prepare
+	 * builds the Load and Sign commands. Execute, on the assertions_ thread, loads the key into a transient
+	 * slot, signs the digest and flushes the key. Finish extracts the signature.
+	 */
+    void prepare_credential(Assertion_credential const &credential, TPM_HANDLE parent_handle, std::string const &user_auth, Prepared_credential &prepared);
+    void execute_credential(Prepared_credential &prepared);
+    Result<Assertion_signature> finish_credential(Prepared_credential const &prepared);
+    /**
+	 * Copy a signature into sig_ to return it to the caller
+	 */
+    Ecdsa_sig return_signature(Assertion_signature const &signature);
+    /**
+	 * Record a failed TPM call, the message is formatted when get_last_error() is called
+	 */
+    void set_error(Tpm_status const &status);
+    /**
+	 * Record an error that has already been formatted, e.g. from an exception
+	 */
+    void set_error(char const *op, std::string const &error, Web_authn_stage stage = Web_authn_stage::none,
+      Web_authn_error code = Web_authn_error::internal_error);
+    /**
+	 * Log a command that took longer than its budget, with the flight record
+	 */
+    void log_slow_command(Latency_watchdog::Slow_command const &slow);
+    /**
+	 * Write the flight record to the log, unless it was written less than flight_dump_interval ago
+	 */
+    void dump_flight_record_limited();
     /**
 	 * Free any memeory that has been allocated, particularly Byte_array's
 	 */
     void release_memory();
     /*
-	 * Write the given string to the log file
+	 * Whether a record for the component, at the given level, is written: the
+	 * level is less than or equal to the component's level and, for a debug
+	 * record, the current request is selected by the sampling
+	 */
+    bool log_enabled(Log_component component, Log_level log_level) const;
+    /*
+	 * Write the given values to the log file, they are only formatted if the
+	 * record is written
 	 * 
-	 * @param log_level - write to the log if the given value is less
-	 *                    than or equal to log_level_
-	 * @param str - the string to be written to the log+ newline
+	 * @param component - the component writing the record
+	 * @param log_level - the level of the record
+	 * @param t - the values to be written to the log + newline
 	 * 
 	 */
-    void log(Log_level log_level, std::string const &log_str);
+    template<typename... T>
+    void log(Log_component component, Log_level log_level, T const &...t)
+    {
+        if (log_enabled(component, log_level)) {
+            write_log(vars_to_string(t...));
+        }
+    }
+    /*
+	 * Write the given string to the log file, tagged with the current request
+	 */
+    void write_log(std::string const &log_str);
 };
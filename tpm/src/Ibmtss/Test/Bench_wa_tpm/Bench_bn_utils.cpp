@@ -0,0 +1,173 @@
+/*******************************************************************************
+* File:        Bench_bn_utils.cpp
+* Description: Times the DAA signature calculation, with and without a cached Montgomery context
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <openssl/rand.h>
+#include "Byte_buffer.h"
+#include "Openssl_utils.h"
+#include "Openssl_bn_utils.h"
+#include "bnp256_param.h"
+
+// s = r + c*sk mod n (bb_signature_calc) is the DAA signature's modular
+// arithmetic. Compares the general function with Bn_modulus, with the
+// operands converted each call and kept in Montgomery form across a chain.
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+Byte_buffer random_bb(size_t size)
+{
+    Byte_buffer bb(size, 0);
+    if (1 != RAND_bytes(bb.data(), static_cast<int>(size))) {
+        throw(Openssl_error("random_bb: RAND_bytes failed"));
+    }
+    return bb;
+}
+
+Byte_buffer pad(Byte_buffer const &bb, size_t size)
+{
+    Byte_buffer padded(size - bb.size(), 0);
+    padded += bb;
+    return padded;
+}
+
+template<typename F>
+double ns_per_op(size_t n_ops, F f)
+{
+    auto start = Clock::now();
+    for (size_t i = 0; i < n_ops; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(n_ops);
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    size_t n_ops = 100000;
+    if (argc == 2) {
+        n_ops = std::stoul(argv[1]);
+    } else if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [number of operations]\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Byte_buffer order(bnp256_order);
+        Bn_modulus const &modulus = get_order_modulus("bnp256");
+        size_t size = modulus.size();
+
+        // Random operands, the inputs to bb_signature_calc are 32 bytes
+        // and may be larger than the order
+        std::vector<Byte_buffer> a;
+        std::vector<Byte_buffer> b;
+        std::vector<Byte_buffer> c;
+        constexpr size_t n_inputs = 64;
+        for (size_t i = 0; i < n_inputs; ++i) {
+            a.push_back(random_bb(size));
+            b.push_back(random_bb(size));
+            c.push_back(random_bb(size));
+        }
+        a[0] = Byte_buffer(size, 0);
+        b[1] = order;
+        c[2] = Byte_buffer(size, 0xff);
+
+        for (size_t i = 0; i < n_inputs; ++i) {
+            Byte_buffer expected = pad(bb_signature_calc(a[i], b[i], c[i], order), size);
+            if (modulus.signature_calc(a[i], b[i], c[i]) != expected) {
+                std::cerr << "Bn_modulus::signature_calc differs from bb_signature_calc for input " << i << '\n';
+                return EXIT_FAILURE;
+            }
+            if (modulus.mod_mul(b[i], c[i]) != pad(bb_mod_mul(b[i], c[i], order), size)
+                || modulus.mod_add(a[i], b[i]) != pad(bb_mod_add(a[i], b[i], order), size)
+                || modulus.mod_sub(a[i], b[i]) != pad(bb_mod_sub(a[i], b[i], order), size)) {
+                std::cerr << "Bn_modulus differs from the bb_mod functions for input " << i << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        std::cout << "Bn_modulus matches the bb_ functions for " << n_inputs << " inputs\n";
+
+        Byte_buffer sink;
+        double general = ns_per_op(n_ops, [&](size_t i) {
+            sink = bb_signature_calc(a[i % n_inputs], b[i % n_inputs], c[i % n_inputs], order);
+        });
+        double cached = ns_per_op(n_ops, [&](size_t i) {
+            sink = modulus.signature_calc(a[i % n_inputs], b[i % n_inputs], c[i % n_inputs]);
+        });
+
+        // A chain of n_ops calculations, s = a + b*s, converting only the
+        // operands and the final result
+        Bn_ctx_ptr ctx = new_bn_ctx();
+        Bn_ptr s_bn = new_bn();
+        Bn_ptr t_bn = new_bn();
+        std::vector<Bn_ptr> a_mont;
+        std::vector<Bn_ptr> b_mont;
+        for (size_t i = 0; i < n_inputs; ++i) {
+            a_mont.push_back(new_bn());
+            modulus.to_mont(a_mont.back().get(), a[i], ctx.get());
+            b_mont.push_back(new_bn());
+            modulus.to_mont(b_mont.back().get(), b[i], ctx.get());
+        }
+        modulus.to_mont(s_bn.get(), c[0], ctx.get());
+        double chained = ns_per_op(n_ops, [&](size_t i) {
+            modulus.mont_mul(t_bn.get(), b_mont[i % n_inputs].get(), s_bn.get(), ctx.get());
+            modulus.add(s_bn.get(), a_mont[i % n_inputs].get(), t_bn.get());
+        });
+        sink = modulus.from_mont(s_bn.get(), ctx.get());
+
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << "bb_signature_calc:          " << std::setw(6) << general << " ns/op\n";
+        std::cout << "Bn_modulus::signature_calc: " << std::setw(6) << cached << " ns/op\n";
+        std::cout << "Montgomery form chain:      " << std::setw(6) << chained << " ns/op\n";
+        std::cout << std::setprecision(1) << "Speed up: " << general / cached << "x per call, "
+                  << general / chained << "x chained\n";
+    } catch (std::exception const &e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+/*******************************************************************************
+* File:        Bench_format.cpp
+* Description: Compares vars_to_string with the ostringstream version it replaced
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include "Byte_buffer.h"
+#include "Io_utils.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// vars_to_string before Format_buffer
+template<typename... T>
+std::string ostream_vars_to_string(const T &... t)
+{
+    std::ostringstream os;
+    (void)std::initializer_list<int>{ (os << t, 0)... };
+    return os.str();
+}
+
+int failures = 0;
+
+template<typename... T>
+void check(const T &... t)
+{
+    std::string expected = ostream_vars_to_string(t...);
+    std::string result = vars_to_string(t...);
+    if (result != expected) {
+        std::cerr << "vars_to_string gave: " << result << "\nexpected:            " << expected << '\n';
+        ++failures;
+    }
+}
+
+template<typename F>
+double ns_per_op(size_t n_ops, F f)
+{
+    auto start = Clock::now();
+    for (size_t i = 0; i < n_ops; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(n_ops);
+}
+
+template<typename F, typename G>
+void time_message(char const *name, size_t n_ops, F fast, G ostream)
+{
+    size_t length = 0;
+    double fast_ns = ns_per_op(n_ops, [&](size_t i) { length += fast(i).size(); });
+    double ostream_ns = ns_per_op(n_ops, [&](size_t i) { length += ostream(i).size(); });
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(0) << std::setw(8) << ostream_ns
+              << std::setw(12) << fast_ns << std::setprecision(1) << std::setw(10) << ostream_ns / fast_ns << "x\n";
+    if (length == 0) {
+        std::cout << "No output\n";
+    }
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    size_t n_ops = 200000;
+    if (argc == 2) {
+        n_ops = std::stoul(argv[1]);
+    } else if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [number of operations]\n";
+        return EXIT_FAILURE;
+    }
+
+    Byte_buffer bb{ 0x00, 0x01, 0x7f, 0x80, 0xab, 0xff };
+    std::string str = "a string";
+    char const *op = "load_rp_key";
+    uint32_t rc = 0x98e;
+    check("User key loaded, handle: ", std::hex, 0x80000001u);
+    check(op, ": ", "TPM2_Load failed", ", rc: 0x", std::hex, rc, std::dec, " ", rc);
+    check("int: ", 0, ' ', -1, ' ', std::numeric_limits<int64_t>::min(), ' ', std::numeric_limits<uint64_t>::max());
+    check(std::hex, -1, ' ', static_cast<int16_t>(-2), ' ', static_cast<int64_t>(-3), ' ', 255u);
+    check("chars: ", 'x', static_cast<uint8_t>(65), static_cast<int8_t>(66), " bool: ", true, false, std::hex, true);
+    check("double: ", 1.5, ' ', 0.1, ' ', 1e-7, ' ', 123456789.0, ' ', -2.5f, ' ', 0.0);
+    check("Byte_buffer: ", bb, " empty: ", Byte_buffer(), " string: ", str, " view: ", std::string_view("view"));
+    check("Long: ", Byte_buffer(300, 0x5a), ' ', std::string(300, 'x'));
+    // Not written by Format_buffer
+    check("uppercase: ", std::hex, std::uppercase, 0xabcu, " setw: ", std::setw(6), 12, " pointer: ", static_cast<void *>(nullptr));
+    if (failures != 0) {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "vars_to_string matches the ostringstream version\n\n";
+
+    Byte_buffer digest(32, 0x3c);
+    std::cout << "Message                 ostream (ns)  Format_buffer (ns)\n";
+    time_message("handle in hex", n_ops,
+      [&](size_t i) { return vars_to_string("User key loaded, handle: ", std::hex, 0x80000000 + i); },
+      [&](size_t i) { return ostream_vars_to_string("User key loaded, handle: ", std::hex, 0x80000000 + i); });
+    time_message("error with rc", n_ops,
+      [&](size_t i) { return vars_to_string(op, ": ", "TPM2_Load failed", ", rc: 0x", std::hex, rc + i); },
+      [&](size_t i) { return ostream_vars_to_string(op, ": ", "TPM2_Load failed", ", rc: 0x", std::hex, rc + i); });
+    time_message("ints and a string", n_ops,
+      [&](size_t i) { return vars_to_string("Assertion ", i, " of ", n_ops, " for ", str); },
+      [&](size_t i) { return ostream_vars_to_string("Assertion ", i, " of ", n_ops, " for ", str); });
+    time_message("32 byte Byte_buffer", n_ops,
+      [&](size_t) { return vars_to_string("Digest: ", digest); },
+      [&](size_t) { return ostream_vars_to_string("Digest: ", digest); });
+    time_message("double", n_ops,
+      [&](size_t i) { return vars_to_string("Took ", 0.25 * static_cast<double>(i), " ms"); },
+      [&](size_t i) { return ostream_vars_to_string("Took ", 0.25 * static_cast<double>(i), " ms"); });
+
+    return EXIT_SUCCESS;
+}
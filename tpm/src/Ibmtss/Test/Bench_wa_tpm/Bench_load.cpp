@@ -0,0 +1,145 @@
+/*******************************************************************************
+* File:        Bench_load.cpp
+* Description: Benchmark for the time to load libwatpm.so and create a Web_authn_tpm
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Tpm_timer.h"
+#include "Bench_results.h"
+
+// Each iteration is in a new process, so the library and the libraries it
+// depends on are loaded afresh and their initialisation is included.
+// 'ready' is when install_tpm has returned, i.e. the library could be used.
+
+struct Load_times
+{
+    Tpm_timer::Rep dlopen;
+    Tpm_timer::Rep ready;
+};
+
+static Load_times time_load(std::string const& library)
+{
+    int fd[2];
+    if (pipe(fd) != 0) {
+        throw std::runtime_error("pipe failed");
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        Load_times times{ 0, 0 };
+        Tpm_timer timer;
+        void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        times.dlopen = timer.get_duration();
+        if (handle == nullptr) {
+            std::cerr << dlerror() << std::endl;
+            _exit(EXIT_FAILURE);
+        }
+        auto install = reinterpret_cast<void *(*)()>(dlsym(handle, "install_tpm"));
+        auto uninstall = reinterpret_cast<void (*)(void *)>(dlsym(handle, "uninstall_tpm"));
+        if (install == nullptr || uninstall == nullptr) {
+            std::cerr << dlerror() << std::endl;
+            _exit(EXIT_FAILURE);
+        }
+        void *v_tpm_ptr = install();
+        times.ready = timer.get_duration();
+        uninstall(v_tpm_ptr);
+        bool ok = (v_tpm_ptr != nullptr && write(fd[1], &times, sizeof(times)) == sizeof(times));
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fd[1]);
+    Load_times times{ 0, 0 };
+    ssize_t n = read(fd[0], &times, sizeof(times));
+    close(fd[0]);
+    int status{ 0 };
+    waitpid(pid, &status, 0);
+    if (n != sizeof(times) || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        throw std::runtime_error("Failed to load " + library);
+    }
+    return times;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " <path to libwatpm.so> <iterations> [<results file> [<baseline results file>]]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string library{ argv[1] };
+    int iterations = std::atoi(argv[2]);
+    if (iterations < 1) {
+        std::cerr << "Invalid number of iterations: " << iterations << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::string results_file{ argc > 3 ? argv[3] : "" };
+    std::string baseline_file{ argc > 4 ? argv[4] : "" };
+
+    try {
+        Bench_results results;
+        results.add_op("dlopen");
+        results.add_op("dlopen_to_ready");
+        for (int i = 0; i < iterations; ++i) {
+            Load_times times = time_load(library);
+            results.add("dlopen", times.dlopen);
+            results.add("dlopen_to_ready", times.ready);
+        }
+
+        std::map<std::string,double> baseline;
+        if (!baseline_file.empty()) {
+            baseline = read_baseline(baseline_file);
+        }
+        results.report(std::cout, baseline);
+        if (!results_file.empty()) {
+            results.save(results_file);
+        }
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
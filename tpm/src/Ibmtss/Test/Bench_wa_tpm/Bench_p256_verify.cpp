@@ -0,0 +1,223 @@
+/*******************************************************************************
+* File:        Bench_p256_verify.cpp
+* Description: Checks P256_verifier against OpenSSL and times ECDSA verification per signature
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <openssl/ecdsa.h>
+#include <openssl/rand.h>
+#include "Byte_buffer.h"
+#include "Number_conversions.h"
+#include "Openssl_utils.h"
+#include "Openssl_ec_utils.h"
+#include "p256_param.h"
+#include "P256_verify.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+Byte_buffer random_bb(size_t size)
+{
+    Byte_buffer bb(size, 0);
+    if (1 != RAND_bytes(bb.data(), static_cast<int>(size))) {
+        throw(Openssl_error("random_bb: RAND_bytes failed"));
+    }
+    return bb;
+}
+
+struct Signed_digest
+{
+    Ec_key_ptr key;
+    Ecdsa_verify_item item;
+};
+
+// A new key and its signature on a random digest, digests longer than 32 bytes are truncated
+Signed_digest sign_random_digest(Ec_group_ptr const &ecgrp, size_t digest_size)
+{
+    Signed_digest sd{ new_ec_key(), {} };
+    if (1 != EC_KEY_set_group(sd.key.get(), ecgrp.get()) || 1 != EC_KEY_generate_key(sd.key.get())) {
+        throw(Openssl_error("sign_random_digest: unable to generate a key"));
+    }
+    sd.item.public_key = point2bb0(ecgrp, EC_KEY_get0_public_key(sd.key.get()));
+    sd.item.digest = random_bb(digest_size);
+    ECDSA_SIG *sig = ECDSA_do_sign(sd.item.digest.cdata(), static_cast<int>(digest_size), sd.key.get());
+    if (sig == nullptr) {
+        throw(Openssl_error("sign_random_digest: ECDSA_do_sign failed"));
+    }
+    sd.item.sig_r = bn2bb(ECDSA_SIG_get0_r(sig), 32);
+    sd.item.sig_s = bn2bb(ECDSA_SIG_get0_s(sig), 32);
+    ECDSA_SIG_free(sig);
+    return sd;
+}
+
+template<typename F>
+double us_per_op(size_t n_ops, F f)
+{
+    auto start = Clock::now();
+    for (size_t i = 0; i < n_ops; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(n_ops);
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    size_t n_sigs = 200;
+    if (argc == 2) {
+        n_sigs = std::stoul(argv[1]);
+    } else if (argc > 2 || n_sigs == 0) {
+        std::cerr << "Usage: " << argv[0] << " [number of signatures]\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::string curve_name = "prime256v1";
+        Ec_group_ptr ecgrp = new_ec_group(curve_name);
+        P256_verifier const &verifier = get_p256_verifier();
+
+        std::vector<Signed_digest> signed_digests;
+        std::vector<Ecdsa_verify_item> items;
+        for (size_t i = 0; i < n_sigs; ++i) {
+            // Mostly SHA-256 sized digests, some to be truncated and some short
+            size_t digest_size = (i % 8 == 1) ? 48 : (i % 8 == 2) ? 20 : 32;
+            signed_digests.push_back(sign_random_digest(ecgrp, digest_size));
+            items.push_back(signed_digests.back().item);
+        }
+
+        // Valid signatures, and the same signatures broken in different ways
+        std::vector<Ecdsa_verify_item> checks;
+        Byte_buffer order(p256_order);
+        for (size_t i = 0; i < items.size(); ++i) {
+            Ecdsa_verify_item const &item = items[i];
+            checks.push_back(item);
+            Ecdsa_verify_item bad = item;
+            switch (i % 6) {
+            case 0:
+                bad.digest[0] ^= 0x01;
+                break;
+            case 1:
+                bad.sig_s[31] ^= 0x80;
+                break;
+            case 2:
+                bad.public_key = items[(i + 1) % items.size()].public_key;
+                break;
+            case 3:
+                bad.sig_r = Byte_buffer(32, 0);
+                break;
+            case 4:
+                bad.sig_s = order;
+                break;
+            default:
+                std::swap(bad.sig_r, bad.sig_s);
+                break;
+            }
+            checks.push_back(bad);
+        }
+
+        std::vector<bool> batch_results = verifier.verify(checks);
+        size_t n_valid = 0;
+        for (size_t i = 0; i < checks.size(); ++i) {
+            Ecdsa_verify_item const &c = checks[i];
+            bool expected = verify_ecdsa_signature(curve_name, c.public_key, c.digest, c.sig_r, c.sig_s);
+            if (verifier.verify(c.public_key, c.digest, c.sig_r, c.sig_s) != expected || batch_results[i] != expected) {
+                std::cerr << "P256_verifier differs from verify_ecdsa_signature for check " << i << " (OpenSSL: " << expected << ")\n";
+                return EXIT_FAILURE;
+            }
+            n_valid += expected ? 1 : 0;
+        }
+        if (n_valid != items.size()) {
+            std::cerr << "Expected " << items.size() << " valid signatures, found " << n_valid << '\n';
+            return EXIT_FAILURE;
+        }
+        std::cout << "P256_verifier matches verify_ecdsa_signature for " << checks.size() << " signatures, " << n_valid << " valid\n";
+
+        bool ok = true;
+        double general = us_per_op(n_sigs, [&](size_t i) {
+            Ecdsa_verify_item const &it = items[i];
+            ok = verify_ecdsa_signature(curve_name, it.public_key, it.digest, it.sig_r, it.sig_s) && ok;
+        });
+        // OpenSSL's own cost, with the key and signature already set up
+        std::vector<ECDSA_SIG *> ossl_sigs;
+        for (auto const &it : items) {
+            ECDSA_SIG *sig = ECDSA_SIG_new();
+            ECDSA_SIG_set0(sig, BN_bin2bn(it.sig_r.cdata(), 32, nullptr), BN_bin2bn(it.sig_s.cdata(), 32, nullptr));
+            ossl_sigs.push_back(sig);
+        }
+        double ossl = us_per_op(n_sigs, [&](size_t i) {
+            Ecdsa_verify_item const &it = items[i];
+            ok = ECDSA_do_verify(it.digest.cdata(), static_cast<int>(it.digest.size()), ossl_sigs[i], signed_digests[i].key.get()) == 1 && ok;
+        });
+        for (auto *sig : ossl_sigs) {
+            ECDSA_SIG_free(sig);
+        }
+        double single = us_per_op(n_sigs, [&](size_t i) {
+            Ecdsa_verify_item const &it = items[i];
+            ok = verifier.verify(it.public_key, it.digest, it.sig_r, it.sig_s) && ok;
+        });
+        auto start = Clock::now();
+        std::vector<bool> results = verifier.verify(items);
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        double batch = elapsed.count() / static_cast<double>(n_sigs);
+        for (bool r : results) {
+            ok = r && ok;
+        }
+        if (!ok) {
+            std::cerr << "A valid signature failed to verify while timing\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "verify_ecdsa_signature:        " << std::setw(7) << general << " us/signature\n";
+        std::cout << "ECDSA_do_verify (EC_KEY set):  " << std::setw(7) << ossl << " us/signature\n";
+        std::cout << "P256_verifier::verify:         " << std::setw(7) << single << " us/signature\n";
+        std::cout << "P256_verifier::verify (batch): " << std::setw(7) << batch << " us/signature\n";
+    } catch (std::exception const &e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* File:        Bench_raw_command.cpp
+* Description: Compare the pre-marshalled TPM commands with TSS_Execute
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include "Tss_includes.h"
+#include "Tss_setup.h"
+#include "Tpm_param.h"
+#include "Tpm_initialisation.h"
+#include "Byte_buffer.h"
+#include "Io_utils.h"
+#include "Tpm_timer.h"
+#include "Sha.h"
+#include "Create_ecdsa_key.h"
+#include "Load_key.h"
+#include "Flush_context.h"
+#include "Ecdsa_sign.h"
+#include "Marshal_data.h"
+#include "Raw_command.h"
+#include "Web_authn_access_tpm.h"
+#include "Bench_results.h"
+
+// Each operation is timed twice: the elapsed time, which is dominated by the
+// TPM, and the CPU time used by this thread, which is the host's share
+class Op_timer
+{
+  public:
+    explicit Op_timer(Bench_results &results) : results_(results) {}
+    void reset()
+    {
+        wall_.reset();
+        cpu_.reset();
+    }
+    void add(std::string const &op)
+    {
+        Tpm_timer::Rep cpu = cpu_.get_duration();
+        results_.add(op, wall_.get_duration());
+        results_.add(op + "_cpu", cpu);
+    }
+
+  private:
+    Bench_results &results_;
+    Tpm_timer wall_;
+    F_cpu_timer_mu cpu_;
+};
+
+void check(TPM_RC rc, char const *what)
+{
+    if (rc != 0) {
+        throw std::runtime_error(vars_to_string(what, " failed, rc: ", std::hex, rc));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <iterations> [<results file> [<baseline results file>]]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string data_dir{ argv[1] };
+    int iterations = std::atoi(argv[2]);
+    if (iterations < 1) {
+        std::cerr << "Invalid number of iterations: " << iterations << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::string results_file{ argc > 3 ? argv[3] : "" };
+    std::string baseline_file{ argc > 4 ? argv[4] : "" };
+
+    // Let the library install the storage root key, then take the TPM over
+    void *v_tpm_ptr = install_tpm();
+    if (v_tpm_ptr == nullptr) {
+        std::cerr << "Unable to install the Web_authn_tpm class\n";
+        return EXIT_FAILURE;
+    }
+    set_log_level(v_tpm_ptr, 1);
+    if (setup_tpm(v_tpm_ptr, false, data_dir.c_str(), "bench_raw") != 0) {
+        std::cerr << "Error setting up the TPM: " << get_last_error(v_tpm_ptr) << '\n';
+        uninstall_tpm(v_tpm_ptr);
+        return EXIT_FAILURE;
+    }
+    uninstall_tpm(v_tpm_ptr);
+
+    Simulator_setup tps;
+    tps.data_dir.value = data_dir.c_str();
+    if (powerup(tps) != 0) {
+        std::cerr << "Simulator powerup failed\n";
+        return EXIT_FAILURE;
+    }
+    auto nc = set_new_context(tps);
+    if (nc.first != 0) {
+        std::cerr << "Unable to create a TSS context\n";
+        return EXIT_FAILURE;
+    }
+    TSS_CONTEXT *tss_context = nc.second;
+
+    std::string key_auth{ "rpPwd" };
+    Byte_buffer digest = sha256_bb(Byte_buffer{ "This is a test message ZZZ" });
+
+    Bench_results results;
+    for (auto const &op : { "tss_load_flush", "raw_load_flush", "tss_sign", "raw_sign" }) {
+        results.add_op(op);
+        results.add_op(std::string(op) + "_cpu");
+    }
+
+    bool bench_ok{ true };
+    TPM_HANDLE key_handle{ 0 };
+    try {
+        check(startup(tss_context), "Startup");
+
+        Create_Out key;
+        check(create_ecdsa_key(tss_context, srk_persistent_handle, "", TPM_ECC_NIST_P256, key_auth, &key), "create_ecdsa_key");
+        Byte_buffer public_data = marshal_public_data_B(&key.outPublic);
+        Byte_buffer private_data = marshal_private_data_B(&key.outPrivate);
+
+        Op_timer timer(results);
+        for (int i = 0; i < iterations; ++i) {
+            Load_Out load_out;
+            timer.reset();
+            check(load_key(tss_context, "", srk_persistent_handle, key.outPublic, key.outPrivate, &load_out), "load_key");
+            check(flush_context(tss_context, load_out.objectHandle), "flush_context");
+            timer.add("tss_load_flush");
+
+            Raw_command load_command;
+            timer.reset();
+            check(raw_load_command(srk_persistent_handle, "", public_data, private_data, &load_command), "raw_load_command");
+            check(raw_load_key(tss_context, load_command, &key_handle), "raw_load_key");
+            check(raw_flush_context(tss_context, key_handle), "raw_flush_context");
+            key_handle = 0;
+            timer.add("raw_load_flush");
+
+            check(raw_load_key(tss_context, load_command, &key_handle), "raw_load_key");
+
+            Sign_Out sign_out;
+            timer.reset();
+            check(ecdsa_sign(tss_context, key_handle, digest, key_auth, &sign_out), "ecdsa_sign");
+            timer.add("tss_sign");
+
+            Raw_command sign_command;
+            Raw_ecdsa_signature signature;
+            timer.reset();
+            check(raw_ecdsa_sign_command(key_handle, key_auth, digest, &sign_command), "raw_ecdsa_sign_command");
+            check(raw_ecdsa_sign(tss_context, sign_command, &signature), "raw_ecdsa_sign");
+            timer.add("raw_sign");
+
+            if (signature.r_size != sign_out.signature.signature.ecdsa.signatureR.t.size
+                || signature.s_size != sign_out.signature.signature.ecdsa.signatureS.t.size) {
+                throw std::runtime_error("The raw and TSS signatures are different sizes");
+            }
+
+            check(raw_flush_context(tss_context, key_handle), "raw_flush_context");
+            key_handle = 0;
+        }
+
+        std::map<std::string, double> baseline;
+        if (!baseline_file.empty()) {
+            baseline = read_baseline(baseline_file);
+        }
+        results.report(std::cout, baseline);
+        if (!results_file.empty()) {
+            results.save(results_file);
+        }
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        bench_ok = false;
+    }
+
+    if (key_handle != 0) {
+        raw_flush_context(tss_context, key_handle);
+    }
+    shutdown(tss_context);
+    TSS_Delete(tss_context);
+
+    return bench_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,108 @@
+/*******************************************************************************
+* File:        Bench_results.cpp
+* Description: Timing results for the benchmark programs
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "Io_utils.h"
+#include "Bench_results.h"
+
+static double mean(Bench_results::Samples const& s)
+{
+    return std::accumulate(s.begin(),s.end(),0.0)/static_cast<double>(s.size());
+}
+
+static double percentile(Bench_results::Samples s, double p)
+{
+    std::sort(s.begin(),s.end());
+    size_t index=static_cast<size_t>(p*static_cast<double>(s.size()-1)+0.5);
+    return s[index];
+}
+
+void Bench_results::report(std::ostream& os, std::map<std::string,double> const& baseline) const
+{
+    os << std::fixed << std::setprecision(1);
+    os << std::left << std::setw(24) << "Operation" << std::right << std::setw(8) << "Count"
+        << std::setw(12) << "Mean (us)" << std::setw(12) << "Median" << std::setw(12) << "p99";
+    if (!baseline.empty()) {
+        os << std::setw(10) << "Speedup";
+    }
+    os << '\n';
+    for (auto const& op : ops_) {
+        Samples const& s=results_.at(op);
+        double m=mean(s);
+        os << std::left << std::setw(24) << op << std::right << std::setw(8) << s.size()
+            << std::setw(12) << m << std::setw(12) << percentile(s,0.5) << std::setw(12) << percentile(s,0.99);
+        auto b=baseline.find(op);
+        if (b!=baseline.end()) {
+            os << std::setw(9) << std::setprecision(3) << b->second/m << 'x' << std::setprecision(1);
+        }
+        os << '\n';
+    }
+}
+
+// One line per operation: <operation>\t<mean time>
+void Bench_results::save(std::string const& filename) const
+{
+    std::ofstream ofs(filename);
+    if (!ofs) {
+        throw std::runtime_error(vars_to_string("Unable to open the results file: ",filename));
+    }
+    ofs << std::setprecision(8);
+    for (auto const& op : ops_) {
+        ofs << op << '\t' << mean(results_.at(op)) << '\n';
+    }
+}
+
+std::map<std::string,double> read_baseline(std::string const& filename)
+{
+    std::map<std::string,double> baseline;
+    std::ifstream ifs(filename);
+    if (!ifs) {
+        throw std::runtime_error(vars_to_string("Unable to open the baseline results file: ",filename));
+    }
+    std::string op;
+    double t;
+    while (ifs >> op >> t) {
+        baseline[op]=t;
+    }
+    return baseline;
+}
@@ -0,0 +1,218 @@
+/*******************************************************************************
+* File:        Bench_tss_state.cpp
+* Description: Counts the TSS's file operations and syscalls per assertion, with its state in files or in memory
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <dlfcn.h>
+#include "Tss_includes.h"
+#include "Byte_buffer.h"
+#include "Byte_array.h"
+#include "Io_utils.h"
+#include "Tpm_timer.h"
+#include "Sha.h"
+#include "Web_authn_structures.h"
+#include "Web_authn_access_tpm.h"
+
+// The TSS keeps its state in files with fopen and remove. The program exports
+// its own versions (ENABLE_EXPORTS), which the TSS's calls bind to, and counts
+// the calls before passing them on to the C library.
+namespace
+{
+std::atomic<uint64_t> file_opens{ 0 };
+std::atomic<uint64_t> file_removes{ 0 };
+
+template<typename F>
+F next_function(char const *name)
+{
+    return reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+}
+}// namespace
+
+extern "C" {
+FILE *fopen(char const *filename, char const *mode)
+{
+    static auto next = next_function<FILE *(*)(char const *, char const *)>("fopen");
+    ++file_opens;
+    return next(filename, mode);
+}
+
+FILE *fopen64(char const *filename, char const *mode)
+{
+    static auto next = next_function<FILE *(*)(char const *, char const *)>("fopen64");
+    ++file_opens;
+    return next(filename, mode);
+}
+
+int remove(char const *filename) noexcept
+{
+    static auto next = next_function<int (*)(char const *)>("remove");
+    ++file_removes;
+    return next(filename);
+}
+}
+
+namespace
+{
+struct Counts
+{
+    uint64_t opens;
+    uint64_t removes;
+    // read and write syscalls, from /proc/self/io, including those to the TPM
+    uint64_t reads;
+    uint64_t writes;
+};
+
+Counts counts()
+{
+    Counts c{ file_opens, file_removes, 0, 0 };
+    std::ifstream io("/proc/self/io");
+    std::string name;
+    uint64_t value;
+    while (io >> name >> value) {
+        if (name == "syscr:") {
+            c.reads = value;
+        } else if (name == "syscw:") {
+            c.writes = value;
+        }
+    }
+    return c;
+}
+
+void check(void *v_tpm_ptr, bool ok, char const *what)
+{
+    if (!ok) {
+        throw std::runtime_error(vars_to_string(what, " failed: ", get_last_error(v_tpm_ptr)));
+    }
+}
+
+// Returns false if the TPM could not be set up
+bool run(std::string const &data_dir, int iterations, bool in_memory)
+{
+    void *v_tpm_ptr = install_tpm();
+    if (v_tpm_ptr == nullptr) {
+        std::cerr << "Unable to install the Web_authn_tpm class\n";
+        return false;
+    }
+    set_log_level(v_tpm_ptr, 1);
+    set_tss_state_in_memory(v_tpm_ptr, in_memory);
+    if (setup_tpm(v_tpm_ptr, false, data_dir.c_str(), "bench_tss_state") != 0) {
+        std::cerr << "Error setting up the TPM: " << get_last_error(v_tpm_ptr) << '\n';
+        uninstall_tpm(v_tpm_ptr);
+        return false;
+    }
+
+    Byte_array user_ba{ 0, nullptr };
+    bb_to_byte_array(user_ba, Byte_buffer{ "alfred" });
+    Byte_array user_auth_ba{ 0, nullptr };
+    bb_to_byte_array(user_auth_ba, Byte_buffer{ "passwd" });
+    Byte_array rp_ba{ 0, nullptr };
+    bb_to_byte_array(rp_ba, Byte_buffer{ "Troy" });
+    Byte_array rp_auth_ba{ 0, nullptr };
+    bb_to_byte_array(rp_auth_ba, Byte_buffer{ "rpPwd" });
+    Byte_array digest_ba{ 0, nullptr };
+    bb_to_byte_array(digest_ba, sha256_bb(Byte_buffer{ "This is a test message ZZZ" }));
+    Key_data user_kd{ { 0, nullptr }, { 0, nullptr } };
+    Key_data rp_kd{ { 0, nullptr }, { 0, nullptr } };
+
+    bool ok{ true };
+    try {
+        Key_data kd = create_and_load_user_key(v_tpm_ptr, user_ba, user_auth_ba);
+        check(v_tpm_ptr, kd.private_data.size != 0, "create_and_load_user_key");
+        copy_byte_array(user_kd.private_data, kd.private_data);
+        copy_byte_array(user_kd.public_data, kd.public_data);
+        Relying_party_key rpk = create_and_load_rp_key(v_tpm_ptr, rp_ba, user_auth_ba, rp_auth_ba);
+        check(v_tpm_ptr, rpk.key_blob.private_data.size != 0, "create_and_load_rp_key");
+        copy_byte_array(rp_kd.private_data, rpk.key_blob.private_data);
+        copy_byte_array(rp_kd.public_data, rpk.key_blob.public_data);
+
+        // An assertion from cold: the keys are flushed, loaded and used
+        Counts start = counts();
+        Tpm_timer timer;
+        for (int i = 0; i < iterations; ++i) {
+            check(v_tpm_ptr, flush_data(v_tpm_ptr) == 0, "flush_data");
+            check(v_tpm_ptr, load_user_key(v_tpm_ptr, user_kd, user_ba) == 0, "load_user_key");
+            check(v_tpm_ptr, load_rp_key(v_tpm_ptr, rp_kd, rp_ba, user_auth_ba).x_coord.size != 0, "load_rp_key");
+            check(v_tpm_ptr, sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_auth_ba).sig_r.size != 0, "sign_using_rp_key");
+        }
+        double us = static_cast<double>(timer.get_duration()) / iterations;
+        Counts end = counts();
+
+        auto per = [iterations](uint64_t from, uint64_t to) { return static_cast<double>(to - from) / iterations; };
+        std::cout << std::left << std::setw(16) << (in_memory ? "memory" : "files") << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << us << std::setw(10) << per(start.opens, end.opens) << std::setw(10) << per(start.removes, end.removes)
+                  << std::setw(10) << per(start.reads, end.reads) << std::setw(10) << per(start.writes, end.writes) << '\n';
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << '\n';
+        ok = false;
+    }
+
+    for (auto *ba : { &user_ba, &user_auth_ba, &rp_ba, &rp_auth_ba, &digest_ba, &user_kd.private_data, &user_kd.public_data,
+           &rp_kd.private_data, &rp_kd.public_data }) {
+        release_byte_array(*ba);
+    }
+    uninstall_tpm(v_tpm_ptr);
+    return ok;
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <iterations>\n";
+        return EXIT_FAILURE;
+    }
+    std::string data_dir{ argv[1] };
+    int iterations = std::atoi(argv[2]);
+    if (iterations < 1) {
+        std::cerr << "Invalid number of iterations: " << iterations << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Per assertion (flush, load user key, load RP key, sign), " << iterations << " iterations\n";
+    std::cout << std::left << std::setw(16) << "TSS state" << std::right << std::setw(12) << "us" << std::setw(10) << "fopen"
+              << std::setw(10) << "remove" << std::setw(10) << "read" << std::setw(10) << "write" << '\n';
+    bool ok = run(data_dir, iterations, false) && run(data_dir, iterations, true);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,236 @@
+/*******************************************************************************
+* File:        Bench_wa_tpm.cpp
+* Description: Benchmark for the Web_authn_tpm C API
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include "Tss_includes.h"
+#include "Byte_buffer.h"
+#include "Byte_array.h"
+#include "Io_utils.h"
+#include "Tpm_timer.h"
+#include "Sha.h"
+#include "Web_authn_structures.h"
+#include "Web_authn_access_tpm.h"
+#include "Bench_results.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <iterations> [<results file> [<baseline results file>]]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string data_dir{ argv[1] };
+    int iterations = std::atoi(argv[2]);
+    if (iterations < 1) {
+        std::cerr << "Invalid number of iterations: " << iterations << ".\n";
+        return EXIT_FAILURE;
+    }
+    std::string results_file{ argc > 3 ? argv[3] : "" };
+    std::string baseline_file{ argc > 4 ? argv[4] : "" };
+
+    bool use_hw_tpm{ false };
+    std::string log_file_prefix{ "bench" };
+
+    void *v_tpm_ptr = install_tpm();
+    if (v_tpm_ptr == nullptr) {
+        std::cerr << "Unable to install the Web_authn_tpm class\n";
+        return EXIT_FAILURE;
+    }
+    // Only log errors, so the timings are not dominated by writing the log
+    if (set_log_level(v_tpm_ptr, 1) != 0) {
+        std::cerr << get_last_error(v_tpm_ptr) << '\n';
+        uninstall_tpm(v_tpm_ptr);
+        return EXIT_FAILURE;
+    }
+    if (setup_tpm(v_tpm_ptr, use_hw_tpm, data_dir.c_str(), log_file_prefix.c_str()) != 0) {
+        std::cerr << "Error setting up the TPM: " << get_last_error(v_tpm_ptr) << '\n';
+        uninstall_tpm(v_tpm_ptr);
+        return EXIT_FAILURE;
+    }
+
+    Byte_array usr_ba{ 0, nullptr };
+    bb_to_byte_array(usr_ba, Byte_buffer{ "alfred" });
+    Byte_array usr_auth_ba{ 0, nullptr };
+    bb_to_byte_array(usr_auth_ba, Byte_buffer{ "passwd" });
+    Byte_array rp_ba{ 0, nullptr };
+    bb_to_byte_array(rp_ba, Byte_buffer{ "Troy" });
+    Byte_array rp_key_auth_ba{ 0, nullptr };
+    bb_to_byte_array(rp_key_auth_ba, Byte_buffer{ "rpPwd" });
+    Byte_array digest_ba{ 0, nullptr };
+    bb_to_byte_array(digest_ba, sha256_bb(Byte_buffer{ "This is a test message ZZZ" }));
+
+    Key_data user_kd{ { 0, nullptr }, { 0, nullptr } };
+    Key_data rp_kd{ { 0, nullptr }, { 0, nullptr } };
+    // Shares rp_kd's data, not released
+    Key_data bad_kd{ { 0, nullptr }, { 0, nullptr } };
+    // Share rp_kd's, rp_key_auth_ba's and digest_ba's data, not released
+    std::array<Key_data, 4> pipeline_kd{};
+    std::array<Byte_array, 4> pipeline_auth{};
+    std::array<Byte_array, 4> pipeline_digest{};
+    pipeline_auth.fill(rp_key_auth_ba);
+    pipeline_digest.fill(digest_ba);
+
+    Bench_results results;
+    for (auto const& op : { "create_user_key", "load_user_key", "create_rp_key", "load_rp_key", "sign",
+                            "load_rp_key_failure", "get_last_error", "serial_load_sign_4", "pipelined_load_sign_4" }) {
+        results.add_op(op);
+    }
+
+    bool bench_ok{ true };
+    try {
+        Tpm_timer timer;
+        Key_data kd = create_and_load_user_key(v_tpm_ptr, usr_ba, usr_auth_ba);
+        results.add("create_user_key", timer.get_duration());
+        if (kd.private_data.size == 0) {
+            throw std::runtime_error(vars_to_string("create_and_load_user_key failed: ", get_last_error(v_tpm_ptr)));
+        }
+        copy_byte_array(user_kd.private_data, kd.private_data);
+        copy_byte_array(user_kd.public_data, kd.public_data);
+
+        for (int i = 0; i < iterations; ++i) {
+            if (flush_data(v_tpm_ptr) != 0) {
+                throw std::runtime_error(vars_to_string("flush_data failed: ", get_last_error(v_tpm_ptr)));
+            }
+
+            timer.reset();
+            TPM_RC rc = load_user_key(v_tpm_ptr, user_kd, usr_auth_ba);
+            results.add("load_user_key", timer.get_duration());
+            if (rc != 0) {
+                throw std::runtime_error(vars_to_string("load_user_key failed: ", get_last_error(v_tpm_ptr)));
+            }
+
+            timer.reset();
+            Relying_party_key rpk = create_and_load_rp_key(v_tpm_ptr, rp_ba, usr_auth_ba, rp_key_auth_ba);
+            results.add("create_rp_key", timer.get_duration());
+            if (rpk.key_blob.private_data.size == 0) {
+                throw std::runtime_error(vars_to_string("create_and_load_rp_key failed: ", get_last_error(v_tpm_ptr)));
+            }
+            copy_byte_array(rp_kd.private_data, rpk.key_blob.private_data);
+            copy_byte_array(rp_kd.public_data, rpk.key_blob.public_data);
+
+            timer.reset();
+            Key_ecc_point pt = load_rp_key(v_tpm_ptr, rp_kd, rp_ba, usr_auth_ba);
+            results.add("load_rp_key", timer.get_duration());
+            if (pt.x_coord.size == 0) {
+                throw std::runtime_error(vars_to_string("load_rp_key failed: ", get_last_error(v_tpm_ptr)));
+            }
+
+            timer.reset();
+            Ecdsa_sig sig = sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_key_auth_ba);
+            results.add("sign", timer.get_duration());
+            if (sig.sig_r.size == 0) {
+                throw std::runtime_error(vars_to_string("sign_using_rp_key failed: ", get_last_error(v_tpm_ptr)));
+            }
+
+            // The failure path: a truncated key blob fails to unmarshal, so
+            // the TPM is not involved. The first call flushes the loaded RP
+            // key, so only time the second
+            bad_kd.public_data.size = rp_kd.public_data.size / 2;
+            bad_kd.public_data.data = rp_kd.public_data.data;
+            bad_kd.private_data = rp_kd.private_data;
+            load_rp_key(v_tpm_ptr, bad_kd, rp_ba, usr_auth_ba);
+            get_last_error(v_tpm_ptr);
+            timer.reset();
+            pt = load_rp_key(v_tpm_ptr, bad_kd, rp_ba, usr_auth_ba);
+            results.add("load_rp_key_failure", timer.get_duration());
+            if (pt.x_coord.size != 0) {
+                throw std::runtime_error("load_rp_key did not fail with a truncated key blob");
+            }
+
+            timer.reset();
+            std::string error{ get_last_error(v_tpm_ptr) };
+            results.add("get_last_error", timer.get_duration());
+
+            // A mixed load and sign workload: four credentials, each loaded and
+            // used to sign once. First one call at a time, then through the
+            // getAssertion pipeline where the host work overlaps the TPM
+            timer.reset();
+            for (size_t c = 0; c < pipeline_kd.size(); ++c) {
+                if (load_rp_key(v_tpm_ptr, rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0
+                    || sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_key_auth_ba).sig_r.size == 0) {
+                    throw std::runtime_error(vars_to_string("Serial load and sign failed: ", get_last_error(v_tpm_ptr)));
+                }
+            }
+            results.add("serial_load_sign_4", timer.get_duration());
+
+            pipeline_kd.fill(rp_kd);
+            timer.reset();
+            for (size_t c = 0; c < pipeline_kd.size(); ++c) {
+                Ecdsa_sig pipeline_sig = (c == 0) ? begin_assertions(v_tpm_ptr, 1, static_cast<uint32_t>(pipeline_kd.size()), pipeline_kd.data(),
+                                                      pipeline_auth.data(), pipeline_digest.data(), usr_auth_ba)
+                                                  : next_assertion(v_tpm_ptr, 1);
+                if (pipeline_sig.sig_r.size == 0) {
+                    throw std::runtime_error(vars_to_string("Pipelined load and sign failed: ", get_last_error(v_tpm_ptr)));
+                }
+            }
+            results.add("pipelined_load_sign_4", timer.get_duration());
+        }
+
+        std::map<std::string,double> baseline;
+        if (!baseline_file.empty()) {
+            baseline = read_baseline(baseline_file);
+        }
+        results.report(std::cout, baseline);
+        if (!results_file.empty()) {
+            results.save(results_file);
+        }
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        bench_ok = false;
+    }
+
+    flush_data(v_tpm_ptr);
+    uninstall_tpm(v_tpm_ptr);
+
+    release_byte_array(usr_ba);
+    release_byte_array(usr_auth_ba);
+    release_byte_array(rp_ba);
+    release_byte_array(rp_key_auth_ba);
+    release_byte_array(digest_ba);
+    release_byte_array(user_kd.private_data);
+    release_byte_array(user_kd.public_data);
+    release_byte_array(rp_kd.private_data);
+    release_byte_array(rp_kd.public_data);
+
+    return bench_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
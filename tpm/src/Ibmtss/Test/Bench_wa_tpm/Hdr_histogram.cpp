@@ -0,0 +1,215 @@
+/*******************************************************************************
+* File:        Hdr_histogram.cpp
+* Description: A high dynamic range histogram of latencies
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include "Hdr_histogram.h"
+
+Hdr_histogram::Hdr_histogram(int64_t highest, int significant_digits) : highest_(highest)
+{
+    if (highest<2 || significant_digits<1 || significant_digits>5) {
+        throw std::invalid_argument("Hdr_histogram: invalid range or precision");
+    }
+    // Enough sub-buckets to separate values that differ in the last significant digit
+    int64_t largest_single_unit=2*static_cast<int64_t>(std::pow(10,significant_digits));
+    int sub_bucket_count_magnitude=static_cast<int>(std::ceil(std::log2(static_cast<double>(largest_single_unit))));
+    sub_bucket_half_count_magnitude_=sub_bucket_count_magnitude-1;
+    sub_bucket_count_=int64_t{1}<<sub_bucket_count_magnitude;
+    sub_bucket_half_count_=sub_bucket_count_/2;
+    sub_bucket_mask_=sub_bucket_count_-1;
+
+    // The number of power of two ranges needed to reach highest
+    int64_t smallest_untrackable=sub_bucket_count_;
+    bucket_count_=1;
+    while (smallest_untrackable<=highest) {
+        smallest_untrackable<<=1;
+        ++bucket_count_;
+    }
+    counts_.assign(static_cast<std::size_t>((bucket_count_+1)*sub_bucket_half_count_),0);
+}
+
+std::size_t Hdr_histogram::counts_index(int64_t value) const
+{
+    int pow2_ceiling=64-__builtin_clzll(static_cast<uint64_t>(value|sub_bucket_mask_));
+    int bucket_index=pow2_ceiling-(sub_bucket_half_count_magnitude_+1);
+    int64_t sub_bucket_index=value>>bucket_index;
+    return static_cast<std::size_t>((static_cast<int64_t>(bucket_index+1)<<sub_bucket_half_count_magnitude_)
+        +(sub_bucket_index-sub_bucket_half_count_));
+}
+
+int64_t Hdr_histogram::value_at_index(std::size_t index) const
+{
+    int bucket_index=static_cast<int>(index>>sub_bucket_half_count_magnitude_)-1;
+    int64_t sub_bucket_index=static_cast<int64_t>(index&static_cast<std::size_t>(sub_bucket_half_count_-1))+sub_bucket_half_count_;
+    if (bucket_index<0) {
+        sub_bucket_index-=sub_bucket_half_count_;
+        bucket_index=0;
+    }
+    return sub_bucket_index<<bucket_index;
+}
+
+int64_t Hdr_histogram::highest_equivalent(int64_t value) const
+{
+    std::size_t index=counts_index(value);
+    int64_t lowest=value_at_index(index);
+    int64_t next=index+1<counts_.size()?value_at_index(index+1):lowest+1;
+    return std::max(lowest,next-1);
+}
+
+int64_t Hdr_histogram::median_equivalent(int64_t value) const
+{
+    std::size_t index=counts_index(value);
+    int64_t lowest=value_at_index(index);
+    return lowest+(highest_equivalent(value)-lowest+1)/2;
+}
+
+void Hdr_histogram::record(int64_t value, uint64_t count)
+{
+    // Out of range values are clamped rather than lost
+    value=std::clamp<int64_t>(value,0,highest_);
+    counts_[counts_index(value)]+=count;
+    total_count_+=count;
+    min_=std::min(min_,value);
+    max_=std::max(max_,value);
+}
+
+void Hdr_histogram::record_corrected(int64_t value, int64_t expected_interval)
+{
+    record(value);
+    if (expected_interval<=0) {
+        return;
+    }
+    for (int64_t missing=value-expected_interval;missing>=expected_interval;missing-=expected_interval) {
+        record(missing);
+    }
+}
+
+void Hdr_histogram::add(Hdr_histogram const& other)
+{
+    for (std::size_t i=0;i<other.counts_.size();++i) {
+        if (other.counts_[i]!=0) {
+            record(other.value_at_index(i),other.counts_[i]);
+        }
+    }
+}
+
+double Hdr_histogram::mean() const
+{
+    if (total_count_==0) {
+        return 0.0;
+    }
+    double total=0.0;
+    for (std::size_t i=0;i<counts_.size();++i) {
+        if (counts_[i]!=0) {
+            total+=static_cast<double>(median_equivalent(value_at_index(i)))*static_cast<double>(counts_[i]);
+        }
+    }
+    return total/static_cast<double>(total_count_);
+}
+
+double Hdr_histogram::stddev() const
+{
+    if (total_count_==0) {
+        return 0.0;
+    }
+    double m=mean();
+    double total=0.0;
+    for (std::size_t i=0;i<counts_.size();++i) {
+        if (counts_[i]!=0) {
+            double d=static_cast<double>(median_equivalent(value_at_index(i)))-m;
+            total+=d*d*static_cast<double>(counts_[i]);
+        }
+    }
+    return std::sqrt(total/static_cast<double>(total_count_));
+}
+
+int64_t Hdr_histogram::value_at_percentile(double percentile) const
+{
+    if (total_count_==0) {
+        return 0;
+    }
+    percentile=std::min(percentile,100.0);
+    auto count_at_percentile=static_cast<uint64_t>(percentile/100.0*static_cast<double>(total_count_)+0.5);
+    count_at_percentile=std::max<uint64_t>(count_at_percentile,1);
+    uint64_t total=0;
+    for (std::size_t i=0;i<counts_.size();++i) {
+        total+=counts_[i];
+        if (total>=count_at_percentile) {
+            return std::min(highest_equivalent(value_at_index(i)),max_);
+        }
+    }
+    return max_;
+}
+
+void Hdr_histogram::write_percentiles(std::ostream& os, double value_scale, int ticks_per_half_distance) const
+{
+    os << std::setw(12) << "Value" << std::setw(15) << "Percentile" << std::setw(11) << "TotalCount"
+       << std::setw(17) << "1/(1-Percentile)" << "\n\n";
+    os << std::fixed;
+
+    // Each halving of the distance to 100% gets the same number of lines
+    double percentile=0.0;
+    for (int line=0;total_count_!=0;++line) {
+        percentile=100.0*(1.0-std::pow(0.5,static_cast<double>(line)/ticks_per_half_distance));
+        int64_t value=value_at_percentile(percentile);
+        uint64_t count=0;
+        for (std::size_t i=0;i<counts_.size() && value_at_index(i)<=value;++i) {
+            count+=counts_[i];
+        }
+        os << std::setprecision(3) << std::setw(12) << static_cast<double>(value)/value_scale
+           << std::setprecision(12) << std::setw(15) << percentile/100.0
+           << std::setw(11) << count;
+        if (percentile<100.0) {
+            os << std::setprecision(2) << std::setw(15) << 100.0/(100.0-percentile);
+        }
+        os << '\n';
+        if (count>=total_count_) {
+            break;
+        }
+    }
+    os << std::setprecision(3)
+       << "#[Mean    = " << std::setw(12) << mean()/value_scale << ", StdDeviation   = " << std::setw(12) << stddev()/value_scale << "]\n"
+       << "#[Max     = " << std::setw(12) << static_cast<double>(max_)/value_scale << ", Total count    = " << std::setw(12) << total_count_ << "]\n"
+       << "#[Buckets = " << std::setw(12) << bucket_count_ << ", SubBuckets     = " << std::setw(12) << sub_bucket_count_ << "]\n";
+    os << std::defaultfloat;
+}
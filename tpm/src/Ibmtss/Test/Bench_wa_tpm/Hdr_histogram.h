@@ -0,0 +1,92 @@
+/*******************************************************************************
+* File:        Hdr_histogram.h
+* Description: A high dynamic range histogram of latencies
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// A histogram with a fixed relative precision over a wide range of values,
+// laid out as in Gil Tene's HdrHistogram: each power of two range is split
+// into the same number of linear sub-buckets, so recording a value is a few
+// shifts and an increment. Values are integers (microseconds here) from 1 to
+// highest, with significant_digits decimal digits of precision.
+class Hdr_histogram
+{
+public:
+    Hdr_histogram(int64_t highest, int significant_digits);
+
+    void record(int64_t value) { record(value,1); }
+    void record(int64_t value, uint64_t count);
+    // Record a value from a loop that waits for each result before sending the
+    // next, adding the samples that were missed while it was stalled, as
+    // HdrHistogram's recordValueWithExpectedInterval does
+    void record_corrected(int64_t value, int64_t expected_interval);
+    void add(Hdr_histogram const& other);
+
+    uint64_t total_count() const { return total_count_; }
+    int64_t min() const { return total_count_==0?0:min_; }
+    int64_t max() const { return max_; }
+    double mean() const;
+    double stddev() const;
+    int64_t value_at_percentile(double percentile) const;
+
+    // The percentile distribution in HdrHistogram's text (.hgrm) format, the
+    // values divided by value_scale, e.g. 1000.0 for microseconds to ms
+    void write_percentiles(std::ostream& os, double value_scale, int ticks_per_half_distance=5) const;
+
+private:
+    int64_t highest_;
+    int sub_bucket_half_count_magnitude_;
+    int64_t sub_bucket_count_;
+    int64_t sub_bucket_half_count_;
+    int64_t sub_bucket_mask_;
+    int bucket_count_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_{0};
+    int64_t min_{INT64_MAX};
+    int64_t max_{0};
+
+    std::size_t counts_index(int64_t value) const;
+    int64_t value_at_index(std::size_t index) const;
+    int64_t highest_equivalent(int64_t value) const;
+    int64_t median_equivalent(int64_t value) const;
+};
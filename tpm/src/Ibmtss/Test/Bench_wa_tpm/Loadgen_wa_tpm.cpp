@@ -0,0 +1,442 @@
+/*******************************************************************************
+* File:        Loadgen_wa_tpm.cpp
+* Description: Open and closed loop load generator for the authenticator library
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Byte_buffer.h"
+#include "Byte_array.h"
+#include "Io_utils.h"
+#include "Sha.h"
+#include "Hdr_histogram.h"
+#include "Watpm_api.h"
+
+// Models N users, each with M relying party credentials, sending a mix of
+// register (makeCredential) and assert (getAssertion) requests to one
+// authenticator.
+//
+// Open loop: requests arrive as a Poisson process, whether or not the
+// authenticator has kept up. A request's latency runs from when it arrived,
+// not from when the authenticator got round to it, so the time requests spend
+// queued behind a slow one is counted (coordinated omission correction). The
+// service time alone is reported as well.
+//
+// Closed loop: a number of clients each send a request, wait for the result,
+// think for an exponentially distributed time and send the next.
+
+namespace
+{
+using Clock=std::chrono::steady_clock;
+
+// Latencies are recorded in microseconds, up to an hour
+constexpr int64_t highest_latency_us=3600LL*1000*1000;
+constexpr int latency_digits=3;
+
+struct Options
+{
+    std::string target;
+    std::string data_dir;
+    int users=4;
+    int credentials=4;
+    double rate=2.0;
+    double register_fraction=0.1;
+    int requests=100;
+    int clients=0;
+    double think_ms=500.0;
+    uint32_t mock_command_us=1000;
+    uint64_t seed=1;
+    std::string hgrm_prefix;
+};
+
+void usage(char const* program)
+{
+    std::cerr << "Usage: " << program << " <sim|device|mock> <data directory> [options]\n"
+        "  --users <n>              users (default 4)\n"
+        "  --credentials <m>        credentials per user (default 4)\n"
+        "  --requests <count>       requests to send (default 100)\n"
+        "  --rate <per second>      open loop: mean arrival rate (default 2)\n"
+        "  --clients <k>            closed loop with k clients, instead of open loop\n"
+        "  --think <ms>             closed loop: mean think time (default 500)\n"
+        "  --register <fraction>    fraction of requests that register (default 0.1)\n"
+        "  --mock-command <us>      mock: time per TPM command (default 1000)\n"
+        "  --seed <n>               random seed (default 1)\n"
+        "  --hgrm <prefix>          write <prefix>_<kind>.hgrm histograms\n";
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    if (argc<3 || (argc%2)!=1) {
+        throw std::invalid_argument("wrong number of arguments");
+    }
+    Options o;
+    o.target=argv[1];
+    o.data_dir=argv[2];
+    if (o.target!="sim" && o.target!="device" && o.target!="mock") {
+        throw std::invalid_argument("unknown target: "+o.target);
+    }
+    for (int i=3;i<argc;i+=2) {
+        std::string name{argv[i]};
+        std::string value{argv[i+1]};
+        if (name=="--users") o.users=std::stoi(value);
+        else if (name=="--credentials") o.credentials=std::stoi(value);
+        else if (name=="--requests") o.requests=std::stoi(value);
+        else if (name=="--rate") o.rate=std::stod(value);
+        else if (name=="--clients") o.clients=std::stoi(value);
+        else if (name=="--think") o.think_ms=std::stod(value);
+        else if (name=="--register") o.register_fraction=std::stod(value);
+        else if (name=="--mock-command") o.mock_command_us=static_cast<uint32_t>(std::stoul(value));
+        else if (name=="--seed") o.seed=std::stoull(value);
+        else if (name=="--hgrm") o.hgrm_prefix=value;
+        else throw std::invalid_argument("unknown option: "+name);
+    }
+    if (o.users<1 || o.credentials<1 || o.requests<1 || o.rate<=0.0 || o.clients<0
+        || o.register_fraction<0.0 || o.register_fraction>1.0) {
+        throw std::invalid_argument("option out of range");
+    }
+    return o;
+}
+
+// A view of a Byte_buffer for the C API, the buffer must outlive the call
+Byte_array as_byte_array(Byte_buffer& bb)
+{
+    return Byte_array{static_cast<uint16_t>(bb.size()),bb.data()};
+}
+
+Byte_array as_byte_array(std::string& str)
+{
+    return Byte_array{static_cast<uint16_t>(str.size()),reinterpret_cast<Byte*>(str.data())};
+}
+
+struct Credential
+{
+    std::string relying_party;
+    Byte_buffer public_data;
+    Byte_buffer private_data;
+};
+
+struct User
+{
+    std::string name;
+    std::string auth;
+    Byte_buffer public_data;
+    Byte_buffer private_data;
+    std::vector<Credential> credentials;
+};
+
+enum class Kind { reg, assert };
+
+struct Request
+{
+    Kind kind;
+    int user;
+    int credential;
+    // When it arrived (open loop) or was sent (closed loop)
+    Clock::time_point intended;
+};
+
+struct Latencies
+{
+    // From arrival to completion
+    Hdr_histogram response{highest_latency_us,latency_digits};
+    // From starting to completion
+    Hdr_histogram service{highest_latency_us,latency_digits};
+};
+
+class Load_generator
+{
+public:
+    Load_generator(Options const& o, Watpm_api const& api) : o_(o), api_(api), random_(o.seed) {}
+
+    void setup();
+    void run_open_loop();
+    void run_closed_loop();
+    void report(std::ostream& os, double seconds) const;
+    void write_histograms() const;
+    void uninstall() { api_.uninstall_tpm(tpm_); tpm_=nullptr; }
+
+private:
+    Options o_;
+    Watpm_api api_;
+    void* tpm_{nullptr};
+    std::mt19937_64 random_;
+    std::vector<User> users_;
+    std::string rp_auth_{"rp-auth"};
+    Byte_buffer digest_{sha256_bb(Byte_buffer(std::string("client data")))};
+    uint64_t request_id_{0};
+    int failures_{0};
+    int registrations_{0};
+    std::map<Kind,Latencies> latencies_;
+
+    Request next_request(Clock::time_point intended);
+    void execute(Request const& request);
+    void check(bool ok, char const* what);
+};
+
+void Load_generator::check(bool ok, char const* what)
+{
+    if (!ok) {
+        ++failures_;
+        std::cerr << what << " failed: " << api_.get_last_error(tpm_) << '\n';
+    }
+}
+
+void Load_generator::setup()
+{
+    tpm_=api_.install_tpm();
+    if (tpm_==nullptr) {
+        throw std::runtime_error("Unable to install the TPM");
+    }
+    api_.set_log_level(tpm_,1);
+    if (api_.setup_tpm(tpm_,o_.target=="device",o_.data_dir.c_str(),"loadgen")!=0) {
+        throw std::runtime_error(vars_to_string("setup_tpm failed: ",api_.get_last_error(tpm_)));
+    }
+
+    for (int u=0;u<o_.users;++u) {
+        User user{vars_to_string("user",u),vars_to_string("auth",u),{},{},{}};
+        Key_data kd=api_.create_and_load_user_key(tpm_,as_byte_array(user.name),as_byte_array(user.auth));
+        if (kd.public_data.size==0) {
+            throw std::runtime_error(vars_to_string("create_and_load_user_key failed: ",api_.get_last_error(tpm_)));
+        }
+        user.public_data=byte_array_to_bb(kd.public_data);
+        user.private_data=byte_array_to_bb(kd.private_data);
+        for (int c=0;c<o_.credentials;++c) {
+            Credential credential{vars_to_string("rp",u,".",c,".example.com"),{},{}};
+            Relying_party_key rpk=api_.create_and_load_rp_key(tpm_,as_byte_array(credential.relying_party),
+                as_byte_array(user.auth),as_byte_array(rp_auth_));
+            if (rpk.key_blob.public_data.size==0) {
+                throw std::runtime_error(vars_to_string("create_and_load_rp_key failed: ",api_.get_last_error(tpm_)));
+            }
+            credential.public_data=byte_array_to_bb(rpk.key_blob.public_data);
+            credential.private_data=byte_array_to_bb(rpk.key_blob.private_data);
+            user.credentials.push_back(std::move(credential));
+        }
+        users_.push_back(std::move(user));
+    }
+}
+
+Request Load_generator::next_request(Clock::time_point intended)
+{
+    std::uniform_int_distribution<int> user(0,o_.users-1);
+    std::uniform_int_distribution<int> credential(0,o_.credentials-1);
+    std::bernoulli_distribution reg(o_.register_fraction);
+    Kind kind=reg(random_)?Kind::reg:Kind::assert;
+    int u=user(random_);
+    return Request{kind,u,credential(random_),intended};
+}
+
+void Load_generator::execute(Request const& request)
+{
+    Request_context context{++request_id_,request.kind==Kind::reg?1u:2u};
+    api_.set_request_context(tpm_,&context);
+    User& user=users_[static_cast<std::size_t>(request.user)];
+
+    Key_data user_kd{as_byte_array(user.public_data),as_byte_array(user.private_data)};
+    bool ok=api_.load_user_key(tpm_,user_kd,as_byte_array(user.name))==0;
+    check(ok,"load_user_key");
+    if (ok && request.kind==Kind::reg) {
+        // A new credential, self attested
+        std::string relying_party=vars_to_string("new",++registrations_,".example.com");
+        Relying_party_key rpk=api_.create_and_load_rp_key(tpm_,as_byte_array(relying_party),as_byte_array(user.auth),
+            as_byte_array(rp_auth_));
+        ok=rpk.key_blob.public_data.size!=0;
+        check(ok,"create_and_load_rp_key");
+        if (ok) {
+            Ecdsa_sig sig=api_.sign_using_rp_key(tpm_,as_byte_array(relying_party),as_byte_array(digest_),as_byte_array(rp_auth_));
+            check(sig.sig_r.size!=0,"sign_using_rp_key");
+        }
+    } else if (ok) {
+        Credential& credential=user.credentials[static_cast<std::size_t>(request.credential)];
+        Key_data rp_kd{as_byte_array(credential.public_data),as_byte_array(credential.private_data)};
+        Key_ecc_point pt=api_.load_rp_key(tpm_,rp_kd,as_byte_array(credential.relying_party),as_byte_array(user.auth));
+        ok=pt.x_coord.size!=0;
+        check(ok,"load_rp_key");
+        if (ok) {
+            Ecdsa_sig sig=api_.sign_using_rp_key(tpm_,as_byte_array(credential.relying_party),as_byte_array(digest_),
+                as_byte_array(rp_auth_));
+            check(sig.sig_r.size!=0,"sign_using_rp_key");
+        }
+    }
+    api_.set_request_context(tpm_,nullptr);
+}
+
+int64_t microseconds(Clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void Load_generator::run_open_loop()
+{
+    std::exponential_distribution<double> interarrival(o_.rate);
+    Clock::time_point arrival=Clock::now();
+    for (int i=0;i<o_.requests;++i) {
+        arrival+=std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interarrival(random_)));
+        Request request=next_request(arrival);
+        // Only wait if the authenticator is ahead of the arrivals
+        std::this_thread::sleep_until(request.intended);
+        Clock::time_point start=Clock::now();
+        execute(request);
+        Clock::time_point end=Clock::now();
+        Latencies& l=latencies_[request.kind];
+        l.response.record(microseconds(end-request.intended));
+        l.service.record(microseconds(end-start));
+    }
+}
+
+void Load_generator::run_closed_loop()
+{
+    std::exponential_distribution<double> think(1000.0/o_.think_ms);
+    auto think_time=[&]() {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(think(random_)));
+    };
+    // Each client's next request, earliest first. The authenticator serves one
+    // at a time, so a request sent while another is running waits
+    auto later=[](Request const& a, Request const& b) { return a.intended>b.intended; };
+    std::priority_queue<Request,std::vector<Request>,decltype(later)> pending(later);
+    Clock::time_point now=Clock::now();
+    for (int c=0;c<o_.clients;++c) {
+        pending.push(next_request(now+think_time()));
+    }
+    for (int i=0;i<o_.requests;++i) {
+        Request request=pending.top();
+        pending.pop();
+        std::this_thread::sleep_until(request.intended);
+        Clock::time_point start=Clock::now();
+        execute(request);
+        Clock::time_point end=Clock::now();
+        Latencies& l=latencies_[request.kind];
+        l.response.record(microseconds(end-request.intended));
+        l.service.record(microseconds(end-start));
+        pending.push(next_request(end+think_time()));
+    }
+}
+
+char const* kind_name(Kind kind)
+{
+    return kind==Kind::reg?"register":"assert";
+}
+
+void Load_generator::report(std::ostream& os, double seconds) const
+{
+    uint64_t total=0;
+    for (auto const& k : latencies_) {
+        total+=k.second.response.total_count();
+    }
+    os << (o_.clients==0?"Open loop, ":"Closed loop, ") << o_.target << ": " << total << " requests in "
+       << std::fixed << std::setprecision(1) << seconds << " s (" << std::setprecision(2)
+       << static_cast<double>(total)/seconds << " /s), " << failures_ << " failures\n";
+    os << std::left << std::setw(10) << "Request" << std::setw(10) << "Latency" << std::right << std::setw(8) << "Count"
+       << std::setw(11) << "p50 (ms)" << std::setw(11) << "p90" << std::setw(11) << "p99" << std::setw(11) << "p99.9"
+       << std::setw(11) << "Max" << '\n';
+    auto line=[&](char const* kind, char const* what, Hdr_histogram const& h) {
+        os << std::left << std::setw(10) << kind << std::setw(10) << what << std::right << std::setw(8) << h.total_count()
+           << std::setprecision(1);
+        for (double p : {50.0,90.0,99.0,99.9}) {
+            os << std::setw(11) << static_cast<double>(h.value_at_percentile(p))/1000.0;
+        }
+        os << std::setw(11) << static_cast<double>(h.max())/1000.0 << '\n';
+    };
+    for (auto const& k : latencies_) {
+        line(kind_name(k.first),"response",k.second.response);
+        line(kind_name(k.first),"service",k.second.service);
+    }
+}
+
+void Load_generator::write_histograms() const
+{
+    for (auto const& k : latencies_) {
+        for (auto const& h : {std::make_pair("response",&k.second.response),std::make_pair("service",&k.second.service)}) {
+            std::string filename=vars_to_string(o_.hgrm_prefix,'_',kind_name(k.first),'_',h.first,".hgrm");
+            std::ofstream ofs(filename);
+            if (!ofs) {
+                throw std::runtime_error("Unable to open "+filename);
+            }
+            // In milliseconds, as HdrHistogram's plotter expects
+            h.second->write_percentiles(ofs,1000.0);
+        }
+    }
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    try {
+        options=parse_options(argc,argv);
+    } catch (std::exception const& e) {
+        std::cerr << e.what() << '\n';
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Watpm_api api=options.target=="mock"?mock_api(options.mock_command_us):library_api();
+        Load_generator generator(options,api);
+        std::cout << "Creating " << options.users << " users with " << options.credentials << " credentials each" << std::endl;
+        generator.setup();
+
+        auto start=Clock::now();
+        if (options.clients==0) {
+            generator.run_open_loop();
+        } else {
+            generator.run_closed_loop();
+        }
+        double seconds=std::chrono::duration<double>(Clock::now()-start).count();
+
+        generator.report(std::cout,seconds);
+        if (!options.hgrm_prefix.empty()) {
+            generator.write_histograms();
+        }
+        generator.uninstall();
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
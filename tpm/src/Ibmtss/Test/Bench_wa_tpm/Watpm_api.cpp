@@ -0,0 +1,141 @@
+/*******************************************************************************
+* File:        Watpm_api.cpp
+* Description: The authenticator library's C API as a table of functions
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "Web_authn_access_tpm.h"
+#include "Watpm_api.h"
+
+Watpm_api library_api()
+{
+    return Watpm_api{ ::install_tpm, ::setup_tpm, ::set_log_level, ::set_request_context, ::get_last_error, ::uninstall_tpm,
+        ::create_and_load_user_key, ::load_user_key, ::create_and_load_rp_key, ::load_rp_key, ::sign_using_rp_key };
+}
+
+namespace
+{
+// The mock has one set of state, like the one TPM it stands in for
+std::atomic<uint32_t> mock_command_us{ 0 };
+std::array<Byte, 64> mock_bytes{};
+int mock_instance{ 0 };
+
+// Stand in for the TPM commands a call sends
+void tpm_commands(uint32_t count)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(count * mock_command_us));
+}
+
+Byte_array mock_array(uint16_t size)
+{
+    return Byte_array{ size, mock_bytes.data() };
+}
+
+void *mock_install_tpm()
+{
+    return &mock_instance;
+}
+
+TPM_RC mock_setup_tpm(void *, bool, const char *, const char *)
+{
+    tpm_commands(3);
+    return 0;
+}
+
+TPM_RC mock_set_log_level(void *, int)
+{
+    return 0;
+}
+
+TPM_RC mock_set_request_context(void *, Request_context const *)
+{
+    return 0;
+}
+
+const char *mock_get_last_error(void *)
+{
+    return "";
+}
+
+void mock_uninstall_tpm(void *)
+{
+    tpm_commands(1);
+}
+
+Key_data mock_create_and_load_user_key(void *, Byte_array, Byte_array)
+{
+    tpm_commands(2);
+    return Key_data{ mock_array(90), mock_array(48) };
+}
+
+TPM_RC mock_load_user_key(void *, Key_data, Byte_array)
+{
+    tpm_commands(1);
+    return 0;
+}
+
+Relying_party_key mock_create_and_load_rp_key(void *, Byte_array, Byte_array, Byte_array)
+{
+    tpm_commands(2);
+    return Relying_party_key{ Key_data{ mock_array(90), mock_array(48) }, Key_ecc_point{ mock_array(32), mock_array(32) } };
+}
+
+Key_ecc_point mock_load_rp_key(void *, Key_data, Byte_array, Byte_array)
+{
+    // Flush the last key, load the new one
+    tpm_commands(2);
+    return Key_ecc_point{ mock_array(32), mock_array(32) };
+}
+
+Ecdsa_sig mock_sign_using_rp_key(void *, Byte_array, Byte_array, Byte_array)
+{
+    tpm_commands(1);
+    return Ecdsa_sig{ mock_array(32), mock_array(32) };
+}
+}// namespace
+
+Watpm_api mock_api(uint32_t command_us)
+{
+    mock_command_us = command_us;
+    return Watpm_api{ mock_install_tpm, mock_setup_tpm, mock_set_log_level, mock_set_request_context, mock_get_last_error,
+        mock_uninstall_tpm, mock_create_and_load_user_key, mock_load_user_key, mock_create_and_load_rp_key, mock_load_rp_key,
+        mock_sign_using_rp_key };
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************
+* File:        Watpm_api.h
+* Description: The authenticator library's C API as a table of functions
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstdint>
+#include "Web_authn_structures.h"
+#include "Byte_array.h"
+
+// The calls a load test makes, so the same test can drive the library or an
+// in-process mock of it
+struct Watpm_api
+{
+    void *(*install_tpm)();
+    TPM_RC (*setup_tpm)(void *v_tpm_ptr, bool use_hw_tpm, const char *tpm_data_dir, const char *log_filename);
+    TPM_RC (*set_log_level)(void *v_tpm_ptr, int log_level);
+    TPM_RC (*set_request_context)(void *v_tpm_ptr, Request_context const *request);
+    const char *(*get_last_error)(void *v_tpm_ptr);
+    void (*uninstall_tpm)(void *v_tpm_ptr);
+    Key_data (*create_and_load_user_key)(void *v_tpm_ptr, Byte_array user, Byte_array key_auth);
+    TPM_RC (*load_user_key)(void *v_tpm_ptr, Key_data kd, Byte_array user);
+    Relying_party_key (*create_and_load_rp_key)(void *v_tpm_ptr, Byte_array relying_party, Byte_array user_auth, Byte_array rp_key_auth);
+    Key_ecc_point (*load_rp_key)(void *v_tpm_ptr, Key_data kd, Byte_array relying_party, Byte_array user_auth);
+    Ecdsa_sig (*sign_using_rp_key)(void *v_tpm_ptr, Byte_array relying_party, Byte_array signing_data, Byte_array rp_key_auth);
+};
+
+// libwatpm, with the simulator or a device
+Watpm_api library_api();
+
+// A mock of the library that does no TPM work, each TPM command it would have
+// sent takes command_us microseconds
+Watpm_api mock_api(uint32_t command_us);
@@ -0,0 +1,329 @@
+/*******************************************************************************
+* File:        Stress_wa_tpm.cpp
+* Description: Concurrent stress test, for the sanitizer builds
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "Tss_includes.h"
+#include "Byte_buffer.h"
+#include "Byte_array.h"
+#include "Io_utils.h"
+#include "Sha.h"
+#include "Tss_setup.h"
+#include "Web_authn_structures.h"
+#include "Web_authn_tpm.h"
+
+// Hammers several Web_authn_tpm instances, each on its own simulator and TSS
+// context, from several threads each. Web_authn_tpm is not thread safe, so
+// the threads take turns with an instance's key operations, but the
+// diagnostics, the getAssertion worker thread, the latency watchdog, the
+// flight recorder and the shared command observer registry all run
+// concurrently. Built with the tsan or asan preset the sanitizer reports any
+// races, memory errors or leaks it finds.
+
+#if defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define __SANITIZE_THREAD__ 1
+#endif
+#if __has_feature(address_sanitizer)
+#define __SANITIZE_ADDRESS__ 1
+#endif
+#endif
+
+#if defined(__SANITIZE_THREAD__)
+constexpr char const *sanitizer = "ThreadSanitizer";
+#elif defined(__SANITIZE_ADDRESS__)
+constexpr char const *sanitizer = "AddressSanitizer and LeakSanitizer";
+#else
+constexpr char const *sanitizer = nullptr;
+#endif
+
+namespace
+{
+enum Op { assert_op, register_op, get_assertion_op, flush_op, diagnostics_op, op_count };
+
+constexpr std::array<char const *, op_count> op_names{ "assert", "register", "getAssertion", "flush", "diagnostics" };
+// Out of 100
+constexpr std::array<int, op_count> op_weights{ 40, 10, 20, 5, 25 };
+
+struct Counts
+{
+    std::array<std::atomic<uint64_t>, op_count> ok{};
+    std::array<std::atomic<uint64_t>, op_count> failed{};
+};
+
+struct Instance
+{
+    Web_authn_tpm tpm;
+    // Held for the key operations, the diagnostics are called without it
+    std::mutex mutex;
+    std::string data_dir;
+    std::string command_port;
+    std::string platform_port;
+};
+
+struct Credential
+{
+    std::string relying_party;
+    Byte_buffer public_data;
+    Byte_buffer private_data;
+};
+
+Byte_array as_byte_array(Byte_buffer &bb)
+{
+    return Byte_array{ static_cast<uint16_t>(bb.size()), bb.data() };
+}
+
+class Worker
+{
+  public:
+    Worker(Instance &instance, Counts &counts, int id) : instance_(instance), counts_(counts), id_(id), random_(static_cast<uint64_t>(id)) {}
+    void run(std::chrono::steady_clock::time_point end);
+
+  private:
+    Instance &instance_;
+    Counts &counts_;
+    int id_;
+    std::mt19937_64 random_;
+    std::string user_;
+    std::string user_auth_;
+    std::string rp_auth_{ "rp-auth" };
+    Byte_buffer user_public_;
+    Byte_buffer user_private_;
+    std::vector<Credential> credentials_;
+    Byte_buffer digest_{ sha256_bb(Byte_buffer(std::string("client data"))) };
+    uint64_t requests_{ 0 };
+
+    bool create_keys();
+    bool load_user();
+    bool run_op(Op op);
+    void report_error(Op op);
+};
+
+void Worker::report_error(Op op)
+{
+    // Only the first few, a broken TPM would otherwise flood the output
+    static std::atomic<int> reported{ 0 };
+    if (++reported <= 10) {
+        std::cerr << "Worker " << id_ << ": " << op_names[op] << " failed: " << instance_.tpm.get_last_error() << '\n';
+    }
+}
+
+bool Worker::create_keys()
+{
+    std::lock_guard<std::mutex> lock(instance_.mutex);
+    user_ = vars_to_string("user", id_);
+    user_auth_ = vars_to_string("auth", id_);
+    Key_data kd = instance_.tpm.create_and_load_user_key(user_, user_auth_);
+    if (kd.public_data.size == 0) {
+        return false;
+    }
+    user_public_ = byte_array_to_bb(kd.public_data);
+    user_private_ = byte_array_to_bb(kd.private_data);
+    for (int c = 0; c < 2; ++c) {
+        Credential credential{ vars_to_string("rp", id_, '.', c, ".example.com"), {}, {} };
+        Relying_party_key rpk = instance_.tpm.create_and_load_rp_key(credential.relying_party, user_auth_, rp_auth_);
+        if (rpk.key_blob.public_data.size == 0) {
+            return false;
+        }
+        credential.public_data = byte_array_to_bb(rpk.key_blob.public_data);
+        credential.private_data = byte_array_to_bb(rpk.key_blob.private_data);
+        credentials_.push_back(std::move(credential));
+    }
+    return true;
+}
+
+bool Worker::load_user()
+{
+    Key_data kd{ as_byte_array(user_public_), as_byte_array(user_private_) };
+    return instance_.tpm.load_user_key(kd, user_) == 0;
+}
+
+bool Worker::run_op(Op op)
+{
+    Request_context request{ (static_cast<uint64_t>(id_) << 32) | ++requests_, static_cast<uint32_t>(op) };
+
+    if (op == diagnostics_op) {
+        // Safe to call while another thread uses the instance
+        std::string record = instance_.tpm.get_flight_record();
+        Tpm_command_stats stats = instance_.tpm.get_command_stats(TPM_CC_Sign);
+        return !record.empty() && stats.budget_us != 0;
+    }
+
+    std::lock_guard<std::mutex> lock(instance_.mutex);
+    instance_.tpm.set_request_context(&request);
+    bool ok = load_user();
+    Credential &credential = credentials_[random_() % credentials_.size()];
+    if (ok && op == assert_op) {
+        Key_data kd{ as_byte_array(credential.public_data), as_byte_array(credential.private_data) };
+        ok = instance_.tpm.load_rp_key(kd, credential.relying_party, user_auth_).x_coord.size != 0
+             && instance_.tpm.sign_using_rp_key(credential.relying_party, digest_, rp_auth_).sig_r.size != 0;
+    } else if (ok && op == register_op) {
+        std::string relying_party = vars_to_string("new", id_, '.', requests_, ".example.com");
+        ok = instance_.tpm.create_and_load_rp_key(relying_party, user_auth_, rp_auth_).key_blob.public_data.size != 0
+             && instance_.tpm.sign_using_rp_key(relying_party, digest_, rp_auth_).sig_r.size != 0;
+    } else if (ok && op == get_assertion_op) {
+        std::vector<Assertion_credential> assertion;
+        for (auto &c : credentials_) {
+            assertion.push_back(Assertion_credential{ c.public_data, c.private_data, rp_auth_, digest_ });
+        }
+        // The speculative signature for the second credential is left running, for the next caller to end
+        auto channel = static_cast<uint64_t>(id_);
+        ok = instance_.tpm.begin_assertions(channel, std::move(assertion), user_auth_).sig_r.size != 0
+             && instance_.tpm.next_assertion(channel).sig_r.size != 0;
+    } else if (ok && op == flush_op) {
+        ok = instance_.tpm.flush_data() == 0;
+    }
+    if (!ok) {
+        report_error(op);
+    }
+    instance_.tpm.set_request_context(nullptr);
+    return ok;
+}
+
+void Worker::run(std::chrono::steady_clock::time_point end)
+{
+    if (!create_keys()) {
+        report_error(register_op);
+        ++counts_.failed[register_op];
+        return;
+    }
+    std::uniform_int_distribution<int> percent(0, 99);
+    while (std::chrono::steady_clock::now() < end) {
+        int p = percent(random_);
+        int op = 0;
+        while (p >= op_weights[static_cast<std::size_t>(op)]) {
+            p -= op_weights[static_cast<std::size_t>(op)];
+            ++op;
+        }
+        if (run_op(static_cast<Op>(op))) {
+            ++counts_.ok[static_cast<std::size_t>(op)];
+        } else {
+            ++counts_.failed[static_cast<std::size_t>(op)];
+        }
+    }
+}
+}// namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 6) {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <seconds> [<instances> [<threads per instance> [<first simulator port>]]]\n"
+                  << "Instance i uses the simulator on port <first simulator port> + 2i (default 2321), and <data directory>/instance<i>\n";
+        return EXIT_FAILURE;
+    }
+    std::string data_dir{ argv[1] };
+    int seconds = std::atoi(argv[2]);
+    int instance_count = argc > 3 ? std::atoi(argv[3]) : 2;
+    int thread_count = argc > 4 ? std::atoi(argv[4]) : 4;
+    int first_port = argc > 5 ? std::atoi(argv[5]) : 2321;
+    if (seconds < 1 || instance_count < 1 || thread_count < 1 || first_port < 1) {
+        std::cerr << "Invalid arguments\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::unique_ptr<Instance>> instances;
+    for (int i = 0; i < instance_count; ++i) {
+        auto instance = std::make_unique<Instance>();
+        instance->data_dir = vars_to_string(data_dir, "/instance", i);
+        instance->command_port = std::to_string(first_port + 2 * i);
+        instance->platform_port = std::to_string(first_port + 2 * i + 1);
+        mkdir(instance->data_dir.c_str(), 0700);
+
+        Simulator_setup setup;
+        setup.data_dir.value = instance->data_dir.c_str();
+        setup.command_port.value = instance->command_port.c_str();
+        setup.platform_port.value = instance->platform_port.c_str();
+        instance->tpm.set_log_level(1);
+        if (instance->tpm.setup(setup, "stress") != 0) {
+            std::cerr << "Setup failed for the simulator on port " << instance->command_port << ": " << instance->tpm.get_last_error() << '\n';
+            return EXIT_FAILURE;
+        }
+        instances.push_back(std::move(instance));
+    }
+
+    Counts counts;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < instance_count; ++i) {
+        for (int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, i, t]() {
+                Worker worker(*instances[static_cast<std::size_t>(i)], counts, i * thread_count + t);
+                worker.run(end);
+            });
+        }
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // Tidy up, the destructors flush the keys and shut the simulators down
+    instances.clear();
+
+    uint64_t total_ok = 0;
+    uint64_t total_failed = 0;
+    std::cout << instance_count << " instances, " << thread_count << " threads each, " << std::fixed << std::setprecision(1) << elapsed << " s\n";
+    std::cout << std::left << std::setw(14) << "Operation" << std::right << std::setw(10) << "OK" << std::setw(10) << "Failed" << std::setw(10) << "/s" << '\n';
+    for (std::size_t op = 0; op < op_count; ++op) {
+        total_ok += counts.ok[op];
+        total_failed += counts.failed[op];
+        std::cout << std::left << std::setw(14) << op_names[op] << std::right << std::setw(10) << counts.ok[op] << std::setw(10)
+                  << counts.failed[op] << std::setw(10) << static_cast<double>(counts.ok[op]) / elapsed << '\n';
+    }
+    std::cout << std::left << std::setw(14) << "Total" << std::right << std::setw(10) << total_ok << std::setw(10) << total_failed << std::setw(10)
+              << static_cast<double>(total_ok) / elapsed << '\n';
+    if (sanitizer != nullptr) {
+        std::cout << "Built with " << sanitizer << ", its findings are written to stderr and make the exit status non-zero\n";
+    } else {
+        std::cout << "Not built with a sanitizer, use the tsan or asan preset to check for races and leaks\n";
+    }
+
+    return total_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
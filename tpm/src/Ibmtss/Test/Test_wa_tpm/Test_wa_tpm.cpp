@@ -37,10 +37,14 @@
 *                                                                              *
 *******************************************************************************/
 
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <random>
+#include <thread>
 #include <chrono>
 #include <cstring>
+#include <fstream>
 #include "Tss_includes.h"
 #include "Ibmtss_helpers.h"
 #include "Byte_buffer.h"
@@ -59,11 +63,20 @@
 #include "Web_authn_structures.h"
 #include "Web_authn_access_tpm.h"
 #include "Web_authn_tpm.h"
+#include "P256_verify.h"
 
 #ifndef IBM_TSS
 #define IBM_TSS
 #endif
 
+// Counts the slow command callbacks
+std::atomic<int> slow_commands{ 0 };
+
+void count_slow_command(void * /*user_data*/, uint32_t /*command_code*/, uint32_t /*elapsed_ms*/)
+{
+    ++slow_commands;
+}
+
 int main(int argc, char *argv[])
 {
     if (argc != 3) {
@@ -96,6 +109,23 @@ int main(int argc, char *argv[])
         std::cerr << get_last_error(v_tpm_ptr) << '\n';
         return EXIT_FAILURE;
     }
+    {
+        // The per component levels and the debug sampling are checked as they are set
+        Web_authn_status status;
+        bool component_ok = set_component_log_level(v_tpm_ptr, log_component_count, log_level) != 0
+                            && get_last_status(v_tpm_ptr, &status) == 0 && status.error == Web_authn_error::bad_parameter;
+        bool sampling_ok = set_debug_sampling(v_tpm_ptr, 0) != 0
+                           && get_last_status(v_tpm_ptr, &status) == 0 && status.error == Web_authn_error::bad_parameter;
+        if (!component_ok || !sampling_ok
+            || set_component_log_level(v_tpm_ptr, static_cast<int>(Log_component::sign), log_level) != 0
+            || set_debug_sampling(v_tpm_ptr, 1) != 0) {
+            std::cerr << "The log component and sampling settings were not checked\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "Log component and sampling settings OK\n";
+    }
+    // Trace from setup, to check the spans are recorded and nested
+    set_tracing(v_tpm_ptr, true);
 
     if (setup_tpm(v_tpm_ptr, use_hw_tpm, data_dir.c_str(), log_file_prefix.c_str()) != 0) {
         std::cerr << "Error setting up the TPM\n";
@@ -121,6 +151,7 @@ int main(int argc, char *argv[])
     bb_to_byte_array(rp_key_auth_ba, rp_key_auth_bb);
 
     Key_data rp_kd{ { 0, nullptr }, { 0, nullptr } };
+    Key_data rp2_kd{ { 0, nullptr }, { 0, nullptr } };
 
     Byte_buffer msg{ "This is a test message ZZZ" };
     Byte_buffer digest = sha256_bb(msg);
@@ -184,6 +215,23 @@ int main(int argc, char *argv[])
             throw std::runtime_error(error);
         }
 
+        // A truncated key blob should be reported as a bad key blob, found when unmarshalling it
+        Key_data bad_rp_kd{ { static_cast<uint16_t>(rp_kd.public_data.size / 2), rp_kd.public_data.data }, rp_kd.private_data };
+        if (load_rp_key(v_tpm_ptr, bad_rp_kd, rp_ba, usr_auth_ba).x_coord.size != 0) {
+            throw std::runtime_error("Loading a truncated RP key did not fail");
+        }
+        Web_authn_status status;
+        if (get_last_status(v_tpm_ptr, &status) != 0 || status.error != Web_authn_error::bad_key_blob
+            || status.stage != Web_authn_stage::unmarshal) {
+            throw std::runtime_error("Wrong status after loading a truncated RP key");
+        }
+        std::cout << "Truncated RP key: " << get_last_error(v_tpm_ptr) << '\n';
+        loaded_rp_key = load_rp_key(v_tpm_ptr, rp_kd, rp_ba, usr_auth_ba);
+        if (loaded_rp_key.x_coord.size == 0) {
+            std::string error = vars_to_string("Failed to reload the RP key: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+
         ecdsa_key_x = byte_array_to_bb(loaded_rp_key.x_coord);
         ecdsa_key_y = byte_array_to_bb(loaded_rp_key.y_coord);
         std::cout << "ECDSA public key x: " << ecdsa_key_x << '\n';
@@ -203,11 +251,252 @@ int main(int argc, char *argv[])
         std::cout << "ECDSA signature R: " << sig_r << '\n';
         std::cout << "ECDSA signature S: " << sig_s << '\n';
 
-        if (verify_ecdsa_signature(curve_name, ecdsa_public_key, digest, sig_r, sig_s)) {
+        bool sig_verified = verify_ecdsa_signature(curve_name, ecdsa_public_key, digest, sig_r, sig_s);
+        if (sig_verified) {
             std::cout << "OpenSSL verified the ECDSA Signature\n";
         } else {
             std::cout << "OpenSSL failed to verify the ECDSA Signature\n";
         }
+        Byte_buffer bad_digest = digest;
+        bad_digest[0] ^= 0x01;
+        if (p256_verify_ecdsa_signature(ecdsa_public_key, digest, sig_r, sig_s) != sig_verified
+            || p256_verify_ecdsa_signature(ecdsa_public_key, bad_digest, sig_r, sig_s)) {
+            throw std::runtime_error("P256_verifier and verify_ecdsa_signature disagree");
+        }
+
+        Byte_buffer compressed_key = g1_point_compressed(ecdsa_public_key);
+        std::cout << "Compressed ECDSA public key: " << compressed_key << '\n';
+        G1_point decompressed_key = ec_point_decompress(curve_name, compressed_key);
+        G1_point ossl_decompressed_key = ec_point_decompress(new_ec_group(curve_name), compressed_key);
+        if (g1_point_concat(decompressed_key) != g1_point_concat(ecdsa_public_key)
+            || g1_point_concat(ossl_decompressed_key) != g1_point_concat(ecdsa_public_key)) {
+            throw std::runtime_error("Decompressing the ECDSA public key failed");
+        }
+
+        G1_point iso_test_pk = std::make_pair(Byte_buffer(iso_test_pk_x), Byte_buffer(iso_test_pk_y));
+        if (g1_point_concat(ec_point_decompress("bnp256", g1_point_compressed(iso_test_pk))) != g1_point_concat(iso_test_pk)) {
+            throw std::runtime_error("Decompressing the bnp256 ISO test key failed");
+        }
+        std::cout << "Point decompression OK\n";
+
+        // Key data from another authenticator, here an RP key with a changed tag, is rejected by load_rp_key
+        // and begin_assertions before the TPM is used
+        Byte_buffer foreign_private_data = rp_private_data;
+        foreign_private_data[foreign_private_data.size() - 1] ^= 0x01;
+        Key_data foreign_rp_kd{ rp_kd.public_data, { static_cast<uint16_t>(foreign_private_data.size()), foreign_private_data.data() } };
+        Byte_buffer foreign_digest = sha256_bb(Byte_buffer("foreign"));
+        Byte_array foreign_digest_ba{ static_cast<uint16_t>(foreign_digest.size()), foreign_digest.data() };
+        Tpm_command_stats loads_before{};
+        Tpm_command_stats loads_after{};
+        get_command_stats(v_tpm_ptr, TPM_CC_Load, &loads_before);
+        auto reject_start = std::chrono::steady_clock::now();
+        bool load_rejected = load_rp_key(v_tpm_ptr, foreign_rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0;
+        auto reject_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - reject_start).count();
+        bool load_status_ok = get_last_status(v_tpm_ptr, &status) == 0 && status.error == Web_authn_error::bad_key_blob;
+        bool assertion_rejected = begin_assertions(v_tpm_ptr, 1, 1, &foreign_rp_kd, &rp_key_auth_ba, &foreign_digest_ba, usr_auth_ba).sig_r.size == 0;
+        bool assertion_status_ok = get_last_status(v_tpm_ptr, &status) == 0 && status.error == Web_authn_error::bad_key_blob;
+        get_command_stats(v_tpm_ptr, TPM_CC_Load, &loads_after);
+        if (!load_rejected || !load_status_ok || !assertion_rejected || !assertion_status_ok || loads_after.commands != loads_before.commands) {
+            throw std::runtime_error("A foreign RP key was not rejected before the TPM was used");
+        }
+        std::cout << "Foreign RP key rejected in " << reject_us << " us: " << get_last_error(v_tpm_ptr) << '\n';
+        // Key data without a tag, from before the tags were added, loads unless tags are required
+        Byte_buffer untagged_private_data(rp_private_data.cdata(), rp_private_data.size() - 8);
+        Key_data untagged_rp_kd{ rp_kd.public_data, { static_cast<uint16_t>(untagged_private_data.size()), untagged_private_data.data() } };
+        if (load_rp_key(v_tpm_ptr, untagged_rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0) {
+            std::string error = vars_to_string("Failed to load an untagged RP key: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        set_require_key_blob_tags(v_tpm_ptr, true);
+        bool untagged_rejected = load_rp_key(v_tpm_ptr, untagged_rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0;
+        set_require_key_blob_tags(v_tpm_ptr, false);
+        if (!untagged_rejected) {
+            throw std::runtime_error("An untagged RP key was loaded when tags are required");
+        }
+        std::cout << "Key blob tags OK\n";
+
+        // A getAssertion with three credentials, the second with a new RP key. Each signature after the
+        // first is made in the background while the previous one is being returned
+        Relying_party_key rpk2 = create_and_load_rp_key(v_tpm_ptr, rp_ba, usr_auth_ba, rp_key_auth_ba);
+        if (rpk2.key_blob.private_data.size == 0) {
+            std::string error = vars_to_string("create_and_load_rp_key failed: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        copy_byte_array(rp2_kd.private_data, rpk2.key_blob.private_data);
+        copy_byte_array(rp2_kd.public_data, rpk2.key_blob.public_data);
+        G1_point rp2_public_key = std::make_pair(byte_array_to_bb(rpk2.key_point.x_coord), byte_array_to_bb(rpk2.key_point.y_coord));
+
+        std::array<Byte_buffer, 3> assertion_digests{ sha256_bb(Byte_buffer("assertion 0")), sha256_bb(Byte_buffer("assertion 1")),
+            sha256_bb(Byte_buffer("assertion 2")) };
+        std::array<G1_point, 3> assertion_keys{ ecdsa_public_key, rp2_public_key, ecdsa_public_key };
+        std::array<Key_data, 3> assertion_kd{ rp_kd, rp2_kd, rp_kd };
+        std::array<Byte_array, 3> assertion_auth{ rp_key_auth_ba, rp_key_auth_ba, rp_key_auth_ba };
+        std::array<Byte_array, 3> assertion_digest_ba;
+        for (size_t i = 0; i < assertion_digests.size(); ++i) {
+            assertion_digest_ba[i] = Byte_array{ static_cast<uint16_t>(assertion_digests[i].size()), assertion_digests[i].data() };
+        }
+        uint64_t channel = 0x12345678;
+        for (size_t i = 0; i < assertion_digests.size(); ++i) {
+            Ecdsa_sig assertion_sig = (i == 0) ? begin_assertions(v_tpm_ptr, channel, 3, assertion_kd.data(), assertion_auth.data(),
+                                                   assertion_digest_ba.data(), usr_auth_ba)
+                                               : next_assertion(v_tpm_ptr, channel);
+            if (assertion_sig.sig_r.size == 0) {
+                std::string error = vars_to_string("Assertion ", i, " failed: ", get_last_error(v_tpm_ptr));
+                throw std::runtime_error(error);
+            }
+            if (!verify_ecdsa_signature(curve_name, assertion_keys[i], assertion_digests[i], byte_array_to_bb(assertion_sig.sig_r),
+                  byte_array_to_bb(assertion_sig.sig_s))) {
+                throw std::runtime_error(vars_to_string("The signature for assertion ", i, " did not verify"));
+            }
+        }
+        if (next_assertion(v_tpm_ptr, channel).sig_r.size != 0 || get_last_status(v_tpm_ptr, &status) != 0
+            || status.error != Web_authn_error::not_allowed) {
+            throw std::runtime_error("A fourth assertion did not fail");
+        }
+        // A different channel ends the getAssertion, discarding the second signature
+        if (begin_assertions(v_tpm_ptr, channel, 3, assertion_kd.data(), assertion_auth.data(), assertion_digest_ba.data(), usr_auth_ba)
+              .sig_r.size
+            == 0) {
+            std::string error = vars_to_string("begin_assertions failed: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        if (next_assertion(v_tpm_ptr, channel + 1).sig_r.size != 0 || next_assertion(v_tpm_ptr, channel).sig_r.size != 0) {
+            throw std::runtime_error("A getNextAssertion on another channel did not end the getAssertion");
+        }
+        // The RP key loaded by create_and_load_rp_key is still in place
+        Ecdsa_sig rp2_sig = sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_key_auth_ba);
+        if (rp2_sig.sig_r.size == 0
+            || !verify_ecdsa_signature(curve_name, rp2_public_key, digest, byte_array_to_bb(rp2_sig.sig_r), byte_array_to_bb(rp2_sig.sig_s))) {
+            throw std::runtime_error("Signing with the loaded RP key failed after the getAssertion");
+        }
+        std::cout << "Assertions OK\n";
+        // The getAssertion's loads and signs, and a sign for a request, are in the flight record
+        Request_context request{ 0xc0ffee, 2 };
+        set_request_context(v_tpm_ptr, &request);
+        Ecdsa_sig request_sig = sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_key_auth_ba);
+        set_request_context(v_tpm_ptr, nullptr);
+        std::string flight_record = get_flight_record(v_tpm_ptr);
+        if (request_sig.sig_r.size == 0 || flight_record.find("sign_credential  Load") == std::string::npos
+            || flight_record.find("sign_using_rp_key  request 0xc0ffee/2  Sign") == std::string::npos) {
+            throw std::runtime_error(vars_to_string("The flight record is missing commands:\n", flight_record));
+        }
+        Tpm_request_stats request_stats{};
+        if (get_request_stats(v_tpm_ptr, request.id, &request_stats) != 0 || request_stats.commands != 1
+            || request_stats.worst_command != TPM_CC_Sign || request_stats.tpm_us != request_stats.worst_us) {
+            throw std::runtime_error(vars_to_string("The request's commands were not counted: ", request_stats.commands));
+        }
+        std::cout << "Flight record OK, request 0x" << std::hex << request.id << std::dec << " took " << request_stats.tpm_us << " us\n";
+        std::string trace_file = data_dir + "/trace.json";
+        if (write_trace(v_tpm_ptr, trace_file.c_str()) != 0) {
+            throw std::runtime_error(vars_to_string("Unable to write the trace: ", get_last_error(v_tpm_ptr)));
+        }
+        set_tracing(v_tpm_ptr, false);
+        std::ifstream trace_is(trace_file);
+        std::string trace;
+        for (std::string line; std::getline(trace_is, line);) {
+            trace += line + '\n';
+        }
+        if (trace.find("{\"name\":\"setup\",\"cat\":\"operation\"") == std::string::npos
+            || trace.find("\"args\":{\"depth\":1,\"request\":\"0xc0ffee/2\",\"command\":\"0x15d\"") == std::string::npos) {
+            throw std::runtime_error(vars_to_string("The trace is missing spans:\n", trace));
+        }
+        std::cout << "Trace OK\n";
+        // No TPM signs in 1 ms, so the watchdog reports the sign while it is running and counts it
+        Tpm_command_stats sign_stats{};
+        set_command_budget(v_tpm_ptr, TPM_CC_Sign, 1);
+        set_slow_command_callback(v_tpm_ptr, count_slow_command, nullptr);
+        if (sign_using_rp_key(v_tpm_ptr, rp_ba, digest_ba, rp_key_auth_ba).sig_r.size == 0
+            || get_command_stats(v_tpm_ptr, TPM_CC_Sign, &sign_stats) != 0 || sign_stats.over_budget == 0
+            || slow_commands == 0) {
+            throw std::runtime_error("The slow sign was not reported");
+        }
+        set_slow_command_callback(v_tpm_ptr, nullptr, nullptr);
+        set_command_budget(v_tpm_ptr, TPM_CC_Sign, 500);
+        std::cout << "Latency watchdog OK, Sign: " << sign_stats.commands << " sent, worst " << sign_stats.worst_us << " us\n";
+        // Both RP keys have been used, so both are preloaded when the user key is loaded again. The RP key load
+        // and the getAssertion then need no TPM2_Load
+        Request_context preload_request{ 0xbeef, 1 };
+        Tpm_request_stats user_key_stats{};
+        Tpm_request_stats preload_request_stats{};
+        set_request_context(v_tpm_ptr, &preload_request);
+        bool preload_started = load_user_key(v_tpm_ptr, kd_local, usr_auth_ba) == 0
+                               && get_request_stats(v_tpm_ptr, preload_request.id, &user_key_stats) == 0
+                               && preload_rp_keys(v_tpm_ptr, usr_auth_ba, 2) == 0;
+        set_request_context(v_tpm_ptr, nullptr);
+        if (!preload_started) {
+            std::string error = vars_to_string("Unable to preload the RP keys: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        Rp_key_preload_stats preload_stats{};
+        for (int i = 0; i < 100 && preload_stats.preloaded < 2; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            get_preload_stats(v_tpm_ptr, &preload_stats);
+        }
+        // The preloading, on its own thread, is counted for the request that started it
+        get_request_stats(v_tpm_ptr, preload_request.id, &preload_request_stats);
+        Tpm_command_stats preload_loads_before{};
+        Tpm_command_stats preload_loads_after{};
+        get_command_stats(v_tpm_ptr, TPM_CC_Load, &preload_loads_before);
+        Key_ecc_point preloaded_point = load_rp_key(v_tpm_ptr, rp_kd, rp_ba, usr_auth_ba);
+        if (preloaded_point.x_coord.size == 0 || byte_array_to_bb(preloaded_point.x_coord) != ecdsa_public_key.first) {
+            std::string error = vars_to_string("Failed to load the preloaded RP key: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        Ecdsa_sig preloaded_sig = begin_assertions(v_tpm_ptr, channel, 1, &rp2_kd, &rp_key_auth_ba, assertion_digest_ba.data(), usr_auth_ba);
+        end_assertions(v_tpm_ptr);
+        if (preloaded_sig.sig_r.size == 0
+            || !verify_ecdsa_signature(curve_name, rp2_public_key, assertion_digests[0], byte_array_to_bb(preloaded_sig.sig_r),
+              byte_array_to_bb(preloaded_sig.sig_s))) {
+            std::string error = vars_to_string("Signing with the preloaded RP key failed: ", get_last_error(v_tpm_ptr));
+            throw std::runtime_error(error);
+        }
+        get_command_stats(v_tpm_ptr, TPM_CC_Load, &preload_loads_after);
+        get_preload_stats(v_tpm_ptr, &preload_stats);
+        if (preload_stats.preloaded != 2 || preload_stats.hits != 2 || preload_stats.misses != 0
+            || preload_loads_after.commands != preload_loads_before.commands) {
+            throw std::runtime_error(vars_to_string("The preloaded RP keys were not used, preloaded: ", preload_stats.preloaded,
+              ", hits: ", preload_stats.hits, ", misses: ", preload_stats.misses));
+        }
+        if (preload_request_stats.commands < user_key_stats.commands + 2) {
+            throw std::runtime_error(vars_to_string("The preloading was not counted for its request: ", preload_request_stats.commands));
+        }
+        std::cout << "Preloading OK, " << preload_stats.hits << " hits from " << preload_stats.preloaded << " preloaded keys\n";
+        // A preloaded key is not handed out without the user key's authorisation
+        if (load_user_key(v_tpm_ptr, kd_local, usr_auth_ba) != 0 || preload_rp_keys(v_tpm_ptr, usr_auth_ba, 2) != 0) {
+            throw std::runtime_error(vars_to_string("Unable to preload the RP keys again: ", get_last_error(v_tpm_ptr)));
+        }
+        for (int i = 0; i < 100 && preload_stats.preloaded < 4; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            get_preload_stats(v_tpm_ptr, &preload_stats);
+        }
+        Byte_buffer wrong_auth_bb{ "wrong" };
+        Byte_array wrong_auth_ba{ 0, nullptr };
+        bb_to_byte_array(wrong_auth_ba, wrong_auth_bb);
+        Key_ecc_point wrong_auth_pt = load_rp_key(v_tpm_ptr, rp_kd, rp_ba, wrong_auth_ba);
+        Web_authn_status wrong_auth_status;
+        bool load_refused = wrong_auth_pt.x_coord.size == 0 && get_last_status(v_tpm_ptr, &wrong_auth_status) == 0
+                            && wrong_auth_status.error == Web_authn_error::auth_failed;
+        Ecdsa_sig wrong_auth_sig = begin_assertions(v_tpm_ptr, channel, 1, &rp2_kd, &rp_key_auth_ba, assertion_digest_ba.data(), wrong_auth_ba);
+        end_assertions(v_tpm_ptr);
+        release_byte_array(wrong_auth_ba);
+        if (preload_stats.preloaded != 4 || !load_refused || wrong_auth_sig.sig_r.size != 0) {
+            throw std::runtime_error("A preloaded RP key was used with the wrong user authorisation");
+        }
+        std::cout << "Preloaded keys need the user's authorisation OK\n";
+        // Loading an RP key takes a preloaded key the getAssertion may still sign with, so ends it
+        if (begin_assertions(v_tpm_ptr, channel, 3, assertion_kd.data(), assertion_auth.data(), assertion_digest_ba.data(), usr_auth_ba)
+              .sig_r.size
+            == 0) {
+            throw std::runtime_error(vars_to_string("begin_assertions with the preloaded keys failed: ", get_last_error(v_tpm_ptr)));
+        }
+        if (load_rp_key(v_tpm_ptr, rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0) {
+            throw std::runtime_error(vars_to_string("Loading the preloaded RP key failed: ", get_last_error(v_tpm_ptr)));
+        }
+        if (next_assertion(v_tpm_ptr, channel).sig_r.size != 0 || get_last_status(v_tpm_ptr, &status) != 0
+            || status.error != Web_authn_error::not_allowed) {
+            throw std::runtime_error("Loading an RP key did not end the getAssertion");
+        }
+        std::cout << "Loading an RP key ends the getAssertion OK\n";
     } catch (std::exception const &e) {
         std::cerr << e.what() << std::endl;
         tests_ok = false;
@@ -219,6 +508,86 @@ int main(int argc, char *argv[])
     }
     uninstall_tpm(v_tpm_ptr);
 
+    // Restart with the state preserved, the keys loaded at shutdown should be
+    // restored from their saved contexts, so loading the user key needs no
+    // TPM2_Load. The RP key is only used with the user key's authorisation.
+    // Both instances keep the TSS's state in memory
+    if (tests_ok) {
+        void *first_ptr = install_tpm();
+        void *second_ptr = nullptr;
+        try {
+            if (first_ptr == nullptr || set_log_level(first_ptr, log_level) != 0 || set_preserve_state(first_ptr, true) != 0
+                || set_tss_state_in_memory(first_ptr, true) != 0 || setup_tpm(first_ptr, use_hw_tpm, data_dir.c_str(), log_file_prefix.c_str()) != 0) {
+                throw std::runtime_error("Unable to set up the TPM to save its state");
+            }
+            if (load_user_key(first_ptr, kd_local, usr_auth_ba) != 0 || load_rp_key(first_ptr, rp_kd, rp_ba, usr_auth_ba).x_coord.size == 0) {
+                throw std::runtime_error(vars_to_string("Loading the keys to save failed: ", get_last_error(first_ptr)));
+            }
+            uninstall_tpm(first_ptr);
+            first_ptr = nullptr;
+
+            second_ptr = install_tpm();
+            if (second_ptr == nullptr || set_log_level(second_ptr, log_level) != 0 || set_preserve_state(second_ptr, true) != 0
+                || set_tss_state_in_memory(second_ptr, true) != 0 || setup_tpm(second_ptr, use_hw_tpm, data_dir.c_str(), log_file_prefix.c_str()) != 0) {
+                throw std::runtime_error("Unable to set up the TPM to resume its state");
+            }
+            // Both keys are the restored ones, not loaded again
+            Tpm_command_stats loads_before{};
+            Tpm_command_stats loads_after{};
+            get_command_stats(second_ptr, TPM_CC_Load, &loads_before);
+            Tpm_timer timer;
+            if (load_user_key(second_ptr, kd_local, usr_auth_ba) != 0) {
+                throw std::runtime_error(vars_to_string("Loading the restored user key failed: ", get_last_error(second_ptr)));
+            }
+            Tpm_timer::Rep restore_us = timer.get_duration();
+            get_command_stats(second_ptr, TPM_CC_Load, &loads_after);
+            if (loads_after.commands != loads_before.commands) {
+                throw std::runtime_error("The restored user key was not used");
+            }
+            // The restored RP key is not handed out without the user key's authorisation
+            Byte_buffer wrong_auth_bb{ "wrong" };
+            Byte_array wrong_auth_ba{ 0, nullptr };
+            bb_to_byte_array(wrong_auth_ba, wrong_auth_bb);
+            Key_ecc_point wrong_auth_pt = load_rp_key(second_ptr, rp_kd, rp_ba, wrong_auth_ba);
+            release_byte_array(wrong_auth_ba);
+            Web_authn_status wrong_auth_status;
+            if (wrong_auth_pt.x_coord.size != 0 || get_last_status(second_ptr, &wrong_auth_status) != 0
+                || wrong_auth_status.error != Web_authn_error::auth_failed) {
+                throw std::runtime_error("The restored RP key was loaded with the wrong user authorisation");
+            }
+            get_command_stats(second_ptr, TPM_CC_Load, &loads_before);
+            timer.reset();
+            Key_ecc_point restored_pt = load_rp_key(second_ptr, rp_kd, rp_ba, usr_auth_ba);
+            restore_us += timer.get_duration();
+            if (restored_pt.x_coord.size == 0) {
+                throw std::runtime_error(vars_to_string("Loading the restored RP key failed: ", get_last_error(second_ptr)));
+            }
+            get_command_stats(second_ptr, TPM_CC_Load, &loads_after);
+            if (loads_after.commands != loads_before.commands) {
+                throw std::runtime_error("The restored RP key was not used");
+            }
+            std::cout << "Restored user and RP keys loaded in " << restore_us << " us\n";
+            G1_point restored_public_key = std::make_pair(byte_array_to_bb(restored_pt.x_coord), byte_array_to_bb(restored_pt.y_coord));
+            Ecdsa_sig restored_sig = sign_using_rp_key(second_ptr, rp_ba, digest_ba, rp_key_auth_ba);
+            if (restored_sig.sig_r.size == 0
+                || !verify_ecdsa_signature(curve_name, restored_public_key, digest, byte_array_to_bb(restored_sig.sig_r), byte_array_to_bb(restored_sig.sig_s))) {
+                throw std::runtime_error("Signing with the restored RP key failed");
+            }
+            std::cout << "Restart OK\n";
+        } catch (std::exception const &e) {
+            std::cerr << e.what() << std::endl;
+            tests_ok = false;
+        }
+        // A clear shutdown, so the next run starts afresh
+        if (second_ptr != nullptr) {
+            set_preserve_state(second_ptr, false);
+            uninstall_tpm(second_ptr);
+        }
+        if (first_ptr != nullptr) {
+            uninstall_tpm(first_ptr);
+        }
+    }
+
     release_byte_array(usr_ba);
     release_byte_array(usr_auth_ba);
     release_byte_array(kd_local.private_data);
@@ -227,6 +596,8 @@ int main(int argc, char *argv[])
     release_byte_array(rp_key_auth_ba);
     release_byte_array(rp_kd.private_data);
     release_byte_array(rp_kd.public_data);
+    release_byte_array(rp2_kd.private_data);
+    release_byte_array(rp2_kd.public_data);
     release_byte_array(digest_ba);
 
     return tests_ok ? EXIT_SUCCESS : EXIT_FAILURE;
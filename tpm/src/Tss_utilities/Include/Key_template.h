@@ -0,0 +1,218 @@
+/*******************************************************************************
+* File:        Key_template.h
+* Description: Compile time TPMT_PUBLIC templates for creating keys
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "Tss_includes.h"
+#include "Tss_key_helpers.h"
+#include "Hex_literal.h"
+
+// A key template is built by the compiler in its marshalled form, so it is a
+// constant of the library. The TSS's TPM2B_PUBLIC is a C struct of unions
+// that C++17 cannot initialise at compile time, so it is unmarshalled from
+// the constant bytes once, the first time the template is used.
+//
+// All templates use SHA256 for the name, no policy and an empty unique field.
+// A symmetric algorithm of TPM_ALG_AES is AES-128 in CFB mode. The detail is
+// the curve of an ECC key and the key size of an RSA key. Hash is the hash of
+// the signing scheme, or the HMAC of a keyed hash key.
+
+constexpr std::size_t key_template_symmetric_size(TPM_ALG_ID symmetric)
+{
+    return symmetric==TPM_ALG_NULL?2:6;
+}
+
+constexpr std::size_t key_template_scheme_size(TPM_ALG_ID scheme)
+{
+    return scheme==TPM_ALG_NULL?2:4;
+}
+
+// The size of the marshalled TPMT_PUBLIC
+constexpr std::size_t key_template_public_size(TPM_ALG_ID type, TPM_ALG_ID scheme, TPM_ALG_ID symmetric)
+{
+    // type, nameAlg, objectAttributes and an empty authPolicy
+    std::size_t size=2+2+4+2;
+    if (type==TPM_ALG_ECC)
+    {
+        // curveID, a NULL kdf and an empty x and y
+        size+=key_template_symmetric_size(symmetric)+key_template_scheme_size(scheme)+2+2+2+2;
+    }
+    else if (type==TPM_ALG_RSA)
+    {
+        // keyBits, exponent and an empty modulus
+        size+=key_template_symmetric_size(symmetric)+key_template_scheme_size(scheme)+2+4+2;
+    }
+    else
+    {
+        // An empty unique
+        size+=key_template_scheme_size(scheme)+2;
+    }
+    return size;
+}
+
+template<std::size_t N>
+class Key_template_writer
+{
+  public:
+    constexpr void u16(uint16_t value)
+    {
+        bytes_[next_++]=static_cast<Byte>(value>>8);
+        bytes_[next_++]=static_cast<Byte>(value);
+    }
+    constexpr void u32(uint32_t value)
+    {
+        u16(static_cast<uint16_t>(value>>16));
+        u16(static_cast<uint16_t>(value));
+    }
+    constexpr void symmetric(TPM_ALG_ID symmetric)
+    {
+        u16(symmetric);
+        if (symmetric!=TPM_ALG_NULL)
+        {
+            u16(128);
+            u16(TPM_ALG_CFB);
+        }
+    }
+    constexpr void scheme(TPM_ALG_ID scheme, TPM_ALG_ID hash)
+    {
+        u16(scheme);
+        if (scheme!=TPM_ALG_NULL)
+        {
+            u16(hash);
+        }
+    }
+    constexpr Byte_block<N> const& bytes() const { return bytes_; }
+    constexpr std::size_t size() const { return next_; }
+
+  private:
+    Byte_block<N> bytes_{};
+    std::size_t next_=0;
+};
+
+// The marshalled TPM2B_PUBLIC
+template<TPM_ALG_ID Type, uint16_t Detail, TPM_ALG_ID Scheme, TSS_TPMA_OBJECT Attributes, TPM_ALG_ID Symmetric, TPM_ALG_ID Hash>
+constexpr Byte_block<2+key_template_public_size(Type,Scheme,Symmetric)> key_template_bytes()
+{
+    constexpr std::size_t public_size=key_template_public_size(Type,Scheme,Symmetric);
+    Key_template_writer<2+public_size> writer;
+    writer.u16(static_cast<uint16_t>(public_size));
+    writer.u16(Type);
+    writer.u16(TPM_ALG_SHA256);
+    writer.u32(Attributes);
+    writer.u16(0);
+    if (Type==TPM_ALG_ECC)
+    {
+        writer.symmetric(Symmetric);
+        writer.scheme(Scheme,Hash);
+        writer.u16(Detail);
+        writer.u16(TPM_ALG_NULL);
+        writer.u16(0);
+        writer.u16(0);
+    }
+    else if (Type==TPM_ALG_RSA)
+    {
+        writer.symmetric(Symmetric);
+        writer.scheme(Scheme,Hash);
+        writer.u16(Detail);
+        // The default exponent
+        writer.u32(0);
+        writer.u16(0);
+    }
+    else
+    {
+        writer.scheme(Scheme,Hash);
+        writer.u16(0);
+    }
+    if (writer.size()!=2+public_size)
+    {
+        throw std::logic_error("Key template size mismatch");
+    }
+    return writer.bytes();
+}
+
+template<TPM_ALG_ID Type, uint16_t Detail, TPM_ALG_ID Scheme, TSS_TPMA_OBJECT Attributes,
+         TPM_ALG_ID Symmetric=TPM_ALG_NULL, TPM_ALG_ID Hash=TPM_ALG_SHA256>
+class Key_template
+{
+    static_assert(Type==TPM_ALG_ECC || Type==TPM_ALG_RSA || Type==TPM_ALG_KEYEDHASH,"Unsupported key type");
+    static_assert(Symmetric==TPM_ALG_NULL || Symmetric==TPM_ALG_AES,"Unsupported symmetric algorithm");
+    static_assert(Type!=TPM_ALG_KEYEDHASH || Symmetric==TPM_ALG_NULL,"A keyed hash key has no symmetric algorithm");
+    // Signing and decryption keys must not have a symmetric algorithm
+    static_assert((Symmetric==TPM_ALG_NULL)==((Attributes&TPMA_OBJECT_RESTRICTED)==0 || (Attributes&TPMA_OBJECT_DECRYPT)==0),
+                  "Only a restricted decryption (storage) key has a symmetric algorithm");
+
+  public:
+    // The marshalled TPM2B_PUBLIC
+    static constexpr auto marshalled=key_template_bytes<Type,Detail,Scheme,Attributes,Symmetric,Hash>();
+
+    // The template as the TSS's structure, ready to copy into a Create or
+    // CreatePrimary command
+    static TPM2B_PUBLIC const& tpm2b_public()
+    {
+        static TPM2B_PUBLIC const key_template=[]{
+            TPM2B_PUBLIC tpm2b_public{};
+            // The TSS unmarshalling functions only read the buffer
+            Byte* buffer=const_cast<Byte*>(marshalled.data());
+            auto size=static_cast<int32_t>(marshalled.size());
+            if (TPM2B_PUBLIC_Unmarshal(&tpm2b_public,&buffer,&size,NO)!=0 || size!=0)
+            {
+                throw std::runtime_error("The TSS rejected a key template");
+            }
+            return tpm2b_public;
+        }();
+        return key_template;
+    }
+};
+
+// The authenticator's keys
+using Primary_rsa_2048_template=Key_template<TPM_ALG_RSA,2048,TPM_ALG_NULL,
+                                obj_primary|TPMA_OBJECT_USERWITHAUTH,TPM_ALG_AES>;
+// Use NODA, for now
+using Storage_p256_template=Key_template<TPM_ALG_ECC,TPM_ECC_NIST_P256,TPM_ALG_NULL,
+                            obj_storage|TPMA_OBJECT_NODA|TPMA_OBJECT_USERWITHAUTH,TPM_ALG_AES>;
+using Ecdsa_p256_template=Key_template<TPM_ALG_ECC,TPM_ECC_NIST_P256,TPM_ALG_ECDSA,
+                          obj_fixed|obj_signing_tpm|TPMA_OBJECT_NODA|TPMA_OBJECT_USERWITHAUTH>;
+using Ecdsa_p384_template=Key_template<TPM_ALG_ECC,TPM_ECC_NIST_P384,TPM_ALG_ECDSA,
+                          obj_fixed|obj_signing_tpm|TPMA_OBJECT_NODA|TPMA_OBJECT_USERWITHAUTH,TPM_ALG_NULL,TPM_ALG_SHA384>;
+using Hmac_sha256_template=Key_template<TPM_ALG_KEYEDHASH,0,TPM_ALG_HMAC,
+                           obj_fixed|obj_signing_tpm|TPMA_OBJECT_NODA|TPMA_OBJECT_USERWITHAUTH>;
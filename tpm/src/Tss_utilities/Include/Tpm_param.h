@@ -41,22 +41,23 @@
 #include <string>
 #include "Tss_includes.h"
 #include "Byte_buffer.h"
+#include "Hex_literal.h"
 
-const std::string code_version("TPM WebAuthn Experiments Version 0.1");
+constexpr char code_version[]="TPM WebAuthn Experiments Version 0.1";
 
-const std::string platform_auth("p1atf0rmPwd");
-const std::string endorsement_auth("end0rseMe");
-const std::string storage_auth("myPassw0rd");
-const std::string ecdsa_auth("5cdsaPwd");
+constexpr char platform_auth[]="p1atf0rmPwd";
+constexpr char endorsement_auth[]="end0rseMe";
+constexpr char storage_auth[]="myPassw0rd";
+constexpr char ecdsa_auth[]="5cdsaPwd";
 
 // The application PCR, we will initialise this as the TPM is provisioned
 // This PCR handle should be typed as TPMI_DH_PCR, but this is a UINT32, so use
 // that here to avoid dragging in the TSS headers (from IBM TSS, or Intel TSS)
 static const uint32_t app_pcr_handle=23;
 // Data for provisioning PCR 23
-static const Byte_buffer pcr_str("Some arbitrary data for a PCR");
-static const Byte_buffer pcr_expected(Hex_string("dec619c7fb02ea23706364c4984a00227659d413626ae7834c37cc258c1f23ef"));
-static const Byte_buffer quote_digest_expected(Hex_string("0c67da2ea50ef73874d19d3688e662abacaf20bc69f2bbc9ce2434f012d1e733"));
+static constexpr auto pcr_str=string_bytes("Some arbitrary data for a PCR");
+static constexpr auto pcr_expected=hex_bytes("dec619c7fb02ea23706364c4984a00227659d413626ae7834c37cc258c1f23ef");
+static constexpr auto quote_digest_expected=hex_bytes("0c67da2ea50ef73874d19d3688e662abacaf20bc69f2bbc9ce2434f012d1e733");
 
 static const uint32_t ek_persistent_handle=0x810100c0;  
 
@@ -49,6 +49,7 @@
 #include <iomanip>
 
 #include "Byte_buffer.h"
+#include "Format_buffer.h"
 
 Byte_buffer::Byte_buffer()
 {
@@ -160,18 +161,9 @@ void Byte_buffer::truncate()
 
 std::string Byte_buffer::to_hex_string() const
 {
-    std::ostringstream os;
-    size_t str_length = byte_buf_.size();
-    if (str_length == 0) {
-        return os.str();
-    }
-
-    os << std::setfill('0') << std::hex;
-    for (size_t i = 0; i < str_length; ++i) {
-        os << std::setw(2) << 0 + byte_buf_[i];// 0 + used to force conversion to an integer for printing
-          // otherwise this will print as a character
-    }
-    return os.str();
+    Format_buffer buf;
+    buf.append_hex_bytes(byte_buf_.data(), byte_buf_.size());
+    return buf.str();
 }
 
 Byte_buffer operator+(Byte_buffer const &a, Byte_buffer const &b)
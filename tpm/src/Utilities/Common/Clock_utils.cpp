@@ -36,6 +36,7 @@
 *                                                                              *
 *******************************************************************************/
 
+#include <time.h>
 #include "Clock_utils.h"
 
 std::string time_point_to_string(const std::chrono::system_clock::time_point &tp)
@@ -46,3 +47,10 @@ std::string time_point_to_string(const std::chrono::system_clock::time_point &tp
     ts.resize(ts.size() - 1);// skip trailing newline
     return ts;
 }
+
+Thread_cpu_clock::time_point Thread_cpu_clock::now() noexcept
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return time_point(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
@@ -0,0 +1,125 @@
+/*******************************************************************************
+* File:        Format_buffer.cpp
+* Description: Formatting for vars_to_string without an ostringstream
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "Byte_buffer.h"
+#include "Format_buffer.h"
+
+namespace
+{
+constexpr char hex_digits[] = "0123456789abcdef";
+}// namespace
+
+void Format_buffer::grow(std::size_t extra)
+{
+    std::size_t new_capacity = std::max(2 * capacity_, size_ + extra);
+    std::unique_ptr<char[]> new_heap(new char[new_capacity]);
+    std::memcpy(new_heap.get(), data_, size_);
+    heap_ = std::move(new_heap);
+    data_ = heap_.get();
+    capacity_ = new_capacity;
+}
+
+void Format_buffer::append(char const *s, std::size_t n)
+{
+    if (size_ + n > capacity_) {
+        grow(n);
+    }
+    std::memcpy(data_ + size_, s, n);
+    size_ += n;
+}
+
+void Format_buffer::append_unsigned(uint64_t value)
+{
+    // Written backwards from the end, 20 decimal digits is enough for 2^64-1
+    char digits[20];
+    char *p = digits + sizeof(digits);
+    if (hex_) {
+        do {
+            *--p = hex_digits[value & 0xf];
+            value >>= 4;
+        } while (value != 0);
+    } else {
+        do {
+            *--p = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+    }
+    append(p, static_cast<std::size_t>(digits + sizeof(digits) - p));
+}
+
+void Format_buffer::append_signed(int64_t value)
+{
+    if (value < 0) {
+        append('-');
+        append_unsigned(0 - static_cast<uint64_t>(value));
+    } else {
+        append_unsigned(static_cast<uint64_t>(value));
+    }
+}
+
+void Format_buffer::append_hex_bytes(unsigned char const *bytes, std::size_t n)
+{
+    if (size_ + 2 * n > capacity_) {
+        grow(2 * n);
+    }
+    char *p = data_ + size_;
+    for (std::size_t i = 0; i < n; ++i) {
+        *p++ = hex_digits[bytes[i] >> 4];
+        *p++ = hex_digits[bytes[i] & 0xf];
+    }
+    size_ += 2 * n;
+}
+
+void Format_buffer::append_double(double value)
+{
+    char str[32];
+    int n = std::snprintf(str, sizeof(str), "%g", value);
+    if (n > 0) {
+        append(str, std::min(static_cast<std::size_t>(n), sizeof(str) - 1));
+    }
+}
+
+void format_value(Format_buffer &buf, Byte_buffer const &bb)
+{
+    buf.append_hex_bytes(bb.cdata(), bb.size());
+}
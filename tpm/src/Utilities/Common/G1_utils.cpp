@@ -0,0 +1,85 @@
+/*******************************************************************************
+* File:        G1_utils.cpp
+* Description: Utility functions for the base field, G1
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <stdexcept>
+#include "G1_utils.h"
+
+namespace
+{
+// Coordinates from OpenSSL (bn2bb) may have had leading zeros removed
+Byte_buffer padded_coord(Byte_buffer const &coord)
+{
+    if (coord.size() > g1_coord_size) {
+        throw(std::runtime_error("G1 point coordinate too large"));
+    }
+    Byte_buffer bb(coord);
+    bb.pad_left(g1_coord_size);
+    return bb;
+}
+}// namespace
+
+Byte_buffer g1_point_concat(G1_point const &pt)
+{
+    return padded_coord(pt.first) + padded_coord(pt.second);
+}
+
+Byte_buffer g1_point_uncompressed(G1_point const &pt)
+{
+    Byte_buffer bb{ g1_uncompressed_code };
+    bb += g1_point_concat(pt);
+    return bb;
+}
+
+Byte_buffer g1_point_compressed(G1_point const &pt)
+{
+    if (pt.first.empty() || pt.second.empty()) {
+        throw(std::runtime_error("g1_point_compressed: empty coordinate"));
+    }
+    bool y_odd = (pt.second[pt.second.size() - 1] & 1) != 0;
+    Byte_buffer bb{ y_odd ? g1_compressed_odd_code : g1_compressed_even_code };
+    bb += padded_coord(pt.first);
+    return bb;
+}
+
+bool g1_point_is_compressed(Byte_buffer const &bb)
+{
+    return bb.size() == g1_compressed_point_size
+           && (bb[0] == g1_compressed_even_code || bb[0] == g1_compressed_odd_code);
+}
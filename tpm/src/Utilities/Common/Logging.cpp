@@ -41,8 +41,10 @@
 #include "Clock_utils.h"
 #include "Logging.h"
 
-// Do nothing unless the pointer is reset to a 'real' log.
-Log_ptr log_ptr = Log_ptr(new Null_log);
+// Do nothing unless the pointer is set to a 'real' log. Left empty, rather
+// than pointing to a Null_log, so loading the library does not construct a
+// stream.
+Log_ptr log_ptr;
 
 std::ostream &Timed_cout_log::os()
 {
@@ -147,7 +149,7 @@ std::string generate_date_time_log_filename(
 
 void log(Log_level level, std::string const &log_msg)
 {
-    if (level <= log_ptr->debug_level()) {
+    if (log_ptr && level <= log_ptr->debug_level()) {
         log_ptr->write_to_log(log_msg);
     }
 }
@@ -39,6 +39,7 @@
 #include <openssl/bn.h>
 #include <cstring>
 #include <limits>
+#include <stdexcept>
 #include "Number_conversions.h"
 
 size_t bn2bin(BIGNUM const *bn, u8_ptr &bp)
@@ -67,3 +68,13 @@ Byte_buffer bn2bb(BIGNUM const *bn)
 
     return bb;
 }
+
+Byte_buffer bn2bb(BIGNUM const *bn, size_t width)
+{
+    Byte_buffer bb(width, 0);
+    if (BN_bn2binpad(bn, bb.data(), static_cast<int>(width)) < 0) {
+        throw(std::runtime_error("bn2bb: the number is too large for the width"));
+    }
+
+    return bb;
+}
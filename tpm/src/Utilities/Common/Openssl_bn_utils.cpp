@@ -38,6 +38,9 @@
 #include "Openssl_utils.h"
 #include "Number_conversions.h"
 #include "Openssl_bn_utils.h"
+#include "Io_utils.h"
+#include "bnp256_param.h"
+#include "p256_param.h"
 
 Bn_ctx_ptr new_bn_ctx()
 {
@@ -49,6 +52,42 @@ Bn_ptr new_bn()
     return Bn_ptr(BN_new(), ::BN_free);
 }
 
+Bn_mont_ctx_ptr new_bn_mont_ctx()
+{
+    return Bn_mont_ctx_ptr(BN_MONT_CTX_new(), ::BN_MONT_CTX_free);
+}
+
+namespace
+{
+// One context per thread, so the Bn_modulus calls do not allocate one each time
+BN_CTX *thread_bn_ctx()
+{
+    thread_local Bn_ctx_ptr ctx = new_bn_ctx();
+    return ctx.get();
+}
+
+// Temporaries from BN_CTX_get are only valid until the frame ends
+class Bn_ctx_frame
+{
+  public:
+    explicit Bn_ctx_frame(BN_CTX *ctx) : ctx_(ctx) { BN_CTX_start(ctx_); }
+    Bn_ctx_frame(Bn_ctx_frame const &) = delete;
+    Bn_ctx_frame &operator=(Bn_ctx_frame const &) = delete;
+    BIGNUM *get()
+    {
+        BIGNUM *bn = BN_CTX_get(ctx_);
+        if (bn == nullptr) {
+            throw(Openssl_error("Bn_ctx_frame: unable to get a BIGNUM"));
+        }
+        return bn;
+    }
+    ~Bn_ctx_frame() { BN_CTX_end(ctx_); }
+
+  private:
+    BN_CTX *ctx_;
+};
+} // namespace
+
 Byte_buffer bb_mod(Byte_buffer const &num, Byte_buffer const &modulus)
 {
     Bn_ctx_ptr ctx = new_bn_ctx();
@@ -230,3 +269,167 @@ Byte_buffer bb_signature_calc(Byte_buffer const &a, Byte_buffer const &b, Byte_b
 
     return bn2bb(bn_tmp.get());
 }
+
+Bn_modulus::Bn_modulus(Byte_buffer const &n) : n_(new_bn()), mont_(new_bn_mont_ctx())
+{
+    bin2bn(n.cdata(), n.size(), n_.get());
+    if (1 != BN_MONT_CTX_set(mont_.get(), n_.get(), thread_bn_ctx())) {
+        throw(Openssl_error("Bn_modulus: unable to set the Montgomery context"));
+    }
+    size_ = static_cast<size_t>(BN_num_bytes(n_.get()));
+}
+
+void Bn_modulus::to_mont(BIGNUM *r, Byte_buffer const &a, BN_CTX *ctx) const
+{
+    bin2bn(a.cdata(), a.size(), r);
+    if (BN_cmp(r, n_.get()) >= 0 && 1 != BN_nnmod(r, r, n_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: reduction failed"));
+    }
+    if (1 != BN_to_montgomery(r, r, mont_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: conversion to Montgomery form failed"));
+    }
+}
+
+Byte_buffer Bn_modulus::from_mont(BIGNUM const *a, BN_CTX *ctx) const
+{
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *r = frame.get();
+    if (1 != BN_from_montgomery(r, a, mont_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: conversion from Montgomery form failed"));
+    }
+
+    return bn2bb(r, size_);
+}
+
+void Bn_modulus::mont_mul(BIGNUM *r, BIGNUM const *a, BIGNUM const *b, BN_CTX *ctx) const
+{
+    if (1 != BN_mod_mul_montgomery(r, a, b, mont_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: Montgomery multiplication failed"));
+    }
+}
+
+void Bn_modulus::add(BIGNUM *r, BIGNUM const *a, BIGNUM const *b) const
+{
+    if (1 != BN_mod_add_quick(r, a, b, n_.get())) {
+        throw(Openssl_error("Bn_modulus: modular addition failed"));
+    }
+}
+
+void Bn_modulus::sub(BIGNUM *r, BIGNUM const *a, BIGNUM const *b) const
+{
+    if (1 != BN_mod_sub_quick(r, a, b, n_.get())) {
+        throw(Openssl_error("Bn_modulus: modular subtraction failed"));
+    }
+}
+
+Byte_buffer Bn_modulus::mod(Byte_buffer const &a) const
+{
+    BN_CTX *ctx = thread_bn_ctx();
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *a_bn = frame.get();
+    bin2bn(a.cdata(), a.size(), a_bn);
+    if (1 != BN_nnmod(a_bn, a_bn, n_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: reduction failed"));
+    }
+
+    return bn2bb(a_bn, size_);
+}
+
+Byte_buffer Bn_modulus::mod_add(Byte_buffer const &a, Byte_buffer const &b) const
+{
+    BN_CTX *ctx = thread_bn_ctx();
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *a_bn = frame.get();
+    BIGNUM *b_bn = frame.get();
+    bin2bn(a.cdata(), a.size(), a_bn);
+    bin2bn(b.cdata(), b.size(), b_bn);
+    if (1 != BN_mod_add(a_bn, a_bn, b_bn, n_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: modular addition failed"));
+    }
+
+    return bn2bb(a_bn, size_);
+}
+
+Byte_buffer Bn_modulus::mod_sub(Byte_buffer const &a, Byte_buffer const &b) const
+{
+    BN_CTX *ctx = thread_bn_ctx();
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *a_bn = frame.get();
+    BIGNUM *b_bn = frame.get();
+    bin2bn(a.cdata(), a.size(), a_bn);
+    bin2bn(b.cdata(), b.size(), b_bn);
+    if (1 != BN_mod_sub(a_bn, a_bn, b_bn, n_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: modular subtraction failed"));
+    }
+
+    return bn2bb(a_bn, size_);
+}
+
+Byte_buffer Bn_modulus::mod_mul(Byte_buffer const &a, Byte_buffer const &b) const
+{
+    BN_CTX *ctx = thread_bn_ctx();
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *a_bn = frame.get();
+    BIGNUM *b_bn = frame.get();
+    // aR*b*R^-1 = ab, so only a is converted and the result needs no conversion
+    to_mont(a_bn, a, ctx);
+    bin2bn(b.cdata(), b.size(), b_bn);
+    if (BN_cmp(b_bn, n_.get()) >= 0 && 1 != BN_nnmod(b_bn, b_bn, n_.get(), ctx)) {
+        throw(Openssl_error("Bn_modulus: reduction failed"));
+    }
+    mont_mul(a_bn, a_bn, b_bn, ctx);
+
+    return bn2bb(a_bn, size_);
+}
+
+Byte_buffer Bn_modulus::signature_calc(Byte_buffer const &a, Byte_buffer const &b, Byte_buffer const &c) const
+{
+    BN_CTX *ctx = thread_bn_ctx();
+    Bn_ctx_frame frame(ctx);
+    BIGNUM *a_bn = frame.get();
+    BIGNUM *b_bn = frame.get();
+    BIGNUM *c_bn = frame.get();
+    to_mont(b_bn, b, ctx);
+    bin2bn(c.cdata(), c.size(), c_bn);
+    bin2bn(a.cdata(), a.size(), a_bn);
+    if ((BN_cmp(c_bn, n_.get()) >= 0 && 1 != BN_nnmod(c_bn, c_bn, n_.get(), ctx))
+        || (BN_cmp(a_bn, n_.get()) >= 0 && 1 != BN_nnmod(a_bn, a_bn, n_.get(), ctx))) {
+        throw(Openssl_error("Bn_modulus: reduction failed"));
+    }
+    mont_mul(c_bn, b_bn, c_bn, ctx);
+    add(a_bn, a_bn, c_bn);
+
+    return bn2bb(a_bn, size_);
+}
+
+Bn_modulus const &get_order_modulus(std::string const &curve_name)
+{
+    std::string cn_lower = str_tolower(curve_name);
+    if (cn_lower == "bnp256") {
+        static const Bn_modulus bnp256_order_modulus{Byte_buffer(bnp256_order)};
+        return bnp256_order_modulus;
+    }
+    if (cn_lower == "prime256v1") {
+        static const Bn_modulus p256_order_modulus{Byte_buffer(p256_order)};
+        return p256_order_modulus;
+    }
+
+    std::string error = "No order modulus for the curve: " + curve_name;
+    throw(Openssl_error(error.c_str()));
+}
+
+Bn_modulus const &get_field_modulus(std::string const &curve_name)
+{
+    std::string cn_lower = str_tolower(curve_name);
+    if (cn_lower == "bnp256") {
+        static const Bn_modulus bnp256_p_modulus{Byte_buffer(bnp256_p)};
+        return bnp256_p_modulus;
+    }
+    if (cn_lower == "prime256v1") {
+        static const Bn_modulus p256_p_modulus{Byte_buffer(p256_p)};
+        return p256_p_modulus;
+    }
+
+    std::string error = "No field modulus for the curve: " + curve_name;
+    throw(Openssl_error(error.c_str()));
+}
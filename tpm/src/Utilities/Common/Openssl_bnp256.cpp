@@ -49,11 +49,11 @@ EC_GROUP *get_ec_group_bnp256(void)
 	BN_CTX* ctx = BN_CTX_new();
 	BIGNUM   *tmp_1 = nullptr, *tmp_2 = nullptr, *tmp_3 = nullptr;
 
-	if ((tmp_1 = BN_bin2bn(bnp256_p.cdata(), static_cast<int>(bnp256_p.size()), nullptr)) == nullptr)
+	if ((tmp_1 = BN_bin2bn(bnp256_p.data(), static_cast<int>(bnp256_p.size()), nullptr)) == nullptr)
 		goto err;
-	if ((tmp_2 = BN_bin2bn(bnp256_a.cdata(), static_cast<int>(bnp256_a.size()), nullptr)) == nullptr)
+	if ((tmp_2 = BN_bin2bn(bnp256_a.data(), static_cast<int>(bnp256_a.size()), nullptr)) == nullptr)
 		goto err;
-	if ((tmp_3 = BN_bin2bn(bnp256_b.cdata(), static_cast<int>(bnp256_b.size()), nullptr)) == nullptr)
+	if ((tmp_3 = BN_bin2bn(bnp256_b.data(), static_cast<int>(bnp256_b.size()), nullptr)) == nullptr)
 		goto err;
 	if ((curve = EC_GROUP_new_curve_GFp(tmp_1, tmp_2, tmp_3, nullptr)) == nullptr)
 		goto err;
@@ -66,9 +66,9 @@ EC_GROUP *get_ec_group_bnp256(void)
 	generator = EC_POINT_new(curve);
 	if (generator == nullptr)
 		goto err;
-	if ((tmp_1 = BN_bin2bn(bnp256_gX.cdata(), static_cast<int>(bnp256_gX.size()), tmp_1)) == nullptr)
+	if ((tmp_1 = BN_bin2bn(bnp256_gX.data(), static_cast<int>(bnp256_gX.size()), tmp_1)) == nullptr)
 		goto err;
-	if ((tmp_2 = BN_bin2bn(bnp256_gY.cdata(), static_cast<int>(bnp256_gY.size()), tmp_2)) == nullptr)
+	if ((tmp_2 = BN_bin2bn(bnp256_gY.data(), static_cast<int>(bnp256_gY.size()), tmp_2)) == nullptr)
 		goto err;
 	if (1!= EC_POINT_set_affine_coordinates_GFp(curve,generator,tmp_1,tmp_2,ctx))
 		goto err;
@@ -76,7 +76,7 @@ EC_GROUP *get_ec_group_bnp256(void)
 //	std::cout << "gX: " << BN_bn2hex(tmp_1) << '\n';
 //	std::cout << "gY: " << BN_bn2hex(tmp_2) << '\n';
 
-	if ((tmp_1 = BN_bin2bn(bnp256_order.cdata(), static_cast<int>(bnp256_order.size()), tmp_1)) == nullptr)
+	if ((tmp_1 = BN_bin2bn(bnp256_order.data(), static_cast<int>(bnp256_order.size()), tmp_1)) == nullptr)
 		goto err;
 	BN_one(tmp_2);
 	if (1!= EC_GROUP_set_generator(curve,generator,tmp_1,tmp_2))
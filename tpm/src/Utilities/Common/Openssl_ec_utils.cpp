@@ -42,6 +42,7 @@
 #include "Io_utils.h"
 #include "Openssl_ec_utils.h"
 #include "Openssl_bn_utils.h"
+#include "p256_param.h"
 
 Ec_group_ptr new_ec_group(std::string const &curve_name)
 {
@@ -293,3 +294,121 @@ Byte_buffer const& sigS
 	return verifiedOK;	
 }
 
+Ec_point_decompressor::Ec_point_decompressor(
+  Byte_buffer const &p,
+  Byte_buffer const &a,
+  Byte_buffer const &b,
+  Byte_buffer const &sqrt_exp) : p_(new_bn()), a_(new_bn()), b_(new_bn()), sqrt_exp_(new_bn()), mont_(new_bn_mont_ctx())
+{
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    bin2bn(p.cdata(), p.size(), p_.get());
+    bin2bn(a.cdata(), a.size(), a_.get());
+    bin2bn(b.cdata(), b.size(), b_.get());
+    bin2bn(sqrt_exp.cdata(), sqrt_exp.size(), sqrt_exp_.get());
+
+    if (1 != BN_MONT_CTX_set(mont_.get(), p_.get(), ctx.get())) {
+        throw(Openssl_error("Ec_point_decompressor: unable to set the Montgomery context"));
+    }
+    if (1 != BN_to_montgomery(a_.get(), a_.get(), mont_.get(), ctx.get())
+        || 1 != BN_to_montgomery(b_.get(), b_.get(), mont_.get(), ctx.get())) {
+        throw(Openssl_error("Ec_point_decompressor: unable to convert the curve parameters"));
+    }
+    coord_size_ = static_cast<size_t>(BN_num_bytes(p_.get()));
+}
+
+G1_point Ec_point_decompressor::decompress(Byte_buffer const &compressed) const
+{
+    if (compressed.size() != coord_size_ + 1
+        || (compressed[0] != g1_compressed_even_code && compressed[0] != g1_compressed_odd_code)) {
+        throw(Openssl_error("Ec_point_decompressor: not a compressed point"));
+    }
+
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    Bn_ptr x_bn = new_bn();
+    bin2bn(&compressed[1], coord_size_, x_bn.get());
+    if (BN_cmp(x_bn.get(), p_.get()) >= 0) {
+        throw(Openssl_error("Ec_point_decompressor: x-coordinate out of range"));
+    }
+
+    // y^2 = (x^2 + a)x + b, calculated in Montgomery form
+    Bn_ptr xm_bn = new_bn();
+    Bn_ptr rhs_bn = new_bn();
+    if (1 != BN_to_montgomery(xm_bn.get(), x_bn.get(), mont_.get(), ctx.get())
+        || 1 != BN_mod_mul_montgomery(rhs_bn.get(), xm_bn.get(), xm_bn.get(), mont_.get(), ctx.get())
+        || 1 != BN_mod_add_quick(rhs_bn.get(), rhs_bn.get(), a_.get(), p_.get())
+        || 1 != BN_mod_mul_montgomery(rhs_bn.get(), rhs_bn.get(), xm_bn.get(), mont_.get(), ctx.get())
+        || 1 != BN_mod_add_quick(rhs_bn.get(), rhs_bn.get(), b_.get(), p_.get())
+        || 1 != BN_from_montgomery(rhs_bn.get(), rhs_bn.get(), mont_.get(), ctx.get())) {
+        throw(Openssl_error("Ec_point_decompressor: calculating y^2 failed"));
+    }
+
+    Bn_ptr y_bn = new_bn();
+    Bn_ptr check_bn = new_bn();
+    if (1 != BN_mod_exp_mont(y_bn.get(), rhs_bn.get(), sqrt_exp_.get(), p_.get(), ctx.get(), mont_.get())
+        || 1 != BN_mod_sqr(check_bn.get(), y_bn.get(), p_.get(), ctx.get())) {
+        throw(Openssl_error("Ec_point_decompressor: calculating the square root failed"));
+    }
+    // Only a quadratic residue has a square root, otherwise x is not on the curve
+    if (BN_cmp(check_bn.get(), rhs_bn.get()) != 0) {
+        throw(Openssl_error("Ec_point_decompressor: the point is not on the curve"));
+    }
+
+    bool y_odd = (compressed[0] == g1_compressed_odd_code);
+    if ((BN_is_odd(y_bn.get()) == 1) != y_odd) {
+        if (BN_is_zero(y_bn.get()) == 1) {
+            throw(Openssl_error("Ec_point_decompressor: invalid compressed point"));
+        }
+        if (1 != BN_sub(y_bn.get(), p_.get(), y_bn.get())) {
+            throw(Openssl_error("Ec_point_decompressor: negating y failed"));
+        }
+    }
+
+    auto len = static_cast<int>(coord_size_);
+    Byte_buffer x_bb(coord_size_, 0);
+    Byte_buffer y_bb(coord_size_, 0);
+    BN_bn2binpad(x_bn.get(), x_bb.data(), len);
+    BN_bn2binpad(y_bn.get(), y_bb.data(), len);
+
+    return std::make_pair(x_bb, y_bb);
+}
+
+Ec_point_decompressor const &get_ec_point_decompressor(std::string const &curve_name)
+{
+    std::string cn_lower = str_tolower(curve_name);
+    if (cn_lower == "bnp256") {
+        static const Ec_point_decompressor bnp256_decompressor{Byte_buffer(bnp256_p), Byte_buffer(bnp256_a), Byte_buffer(bnp256_b), Byte_buffer(bnp256_sqrt_exp)};
+        return bnp256_decompressor;
+    }
+    if (cn_lower == "prime256v1") {
+        static const Ec_point_decompressor p256_decompressor{Byte_buffer(p256_p), Byte_buffer(p256_a), Byte_buffer(p256_b), Byte_buffer(p256_sqrt_exp)};
+        return p256_decompressor;
+    }
+
+    std::string error = "No point decompressor for the curve: " + curve_name;
+    throw(Openssl_error(error.c_str()));
+}
+
+G1_point ec_point_decompress(std::string const &curve_name, Byte_buffer const &encoded_point)
+{
+    Ec_point_decompressor const &decompressor = get_ec_point_decompressor(curve_name);
+    size_t cs = decompressor.coord_size();
+    if (!encoded_point.empty() && encoded_point[0] == g1_uncompressed_code) {
+        if (encoded_point.size() != 2 * cs + 1) {
+            throw(Openssl_error("ec_point_decompress: invalid uncompressed point"));
+        }
+        return std::make_pair(encoded_point.get_part(1, cs), encoded_point.get_part(cs + 1, cs));
+    }
+
+    return decompressor.decompress(encoded_point);
+}
+
+G1_point ec_point_decompress(Ec_group_ptr const &ecgrp, Byte_buffer const &encoded_point)
+{
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    Ec_point_ptr pt = new_ec_point(ecgrp);
+    if (1 != EC_POINT_oct2point(ecgrp.get(), pt.get(), encoded_point.cdata(), encoded_point.size(), ctx.get())) {
+        throw(Openssl_error("ec_point_decompress: EC_POINT_oct2point failed"));
+    }
+
+    return point2bb(ecgrp, pt);
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+* File:        P256_verify.cpp
+* Description: ECDSA signature verification for prime256v1 (P-256)
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#include <openssl/ecdsa.h>
+#include "Openssl_utils.h"
+#include "Number_conversions.h"
+#include "Openssl_bn_utils.h"
+#include "P256_verify.h"
+
+P256_verifier::P256_verifier() : ecgrp_(new_ec_group("prime256v1"))
+{
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    if (1 != EC_GROUP_check(ecgrp_.get(), ctx.get())) {
+        throw(Openssl_error("P256_verifier: EC_GROUP_check failed"));
+    }
+}
+
+Ec_key_ptr P256_verifier::public_key(G1_point const &public_key, BN_CTX *ctx) const
+{
+    Bn_ptr x_bn = new_bn();
+    Bn_ptr y_bn = new_bn();
+    bin2bn(public_key.first.cdata(), public_key.first.size(), x_bn.get());
+    bin2bn(public_key.second.cdata(), public_key.second.size(), y_bn.get());
+    Ec_point_ptr pt = new_ec_point(ecgrp_);
+    // Fails for a point that is not on the curve
+    if (1 != EC_POINT_set_affine_coordinates_GFp(ecgrp_.get(), pt.get(), x_bn.get(), y_bn.get(), ctx)) {
+        throw(Openssl_error("The ECDSA public key is not on the curve"));
+    }
+
+    Ec_key_ptr ec_key = new_ec_key();
+    if (1 != EC_KEY_set_group(ec_key.get(), ecgrp_.get()) || 1 != EC_KEY_set_public_key(ec_key.get(), pt.get())) {
+        throw(Openssl_error("Failed to load public key (OpenSSL)"));
+    }
+
+    return ec_key;
+}
+
+bool P256_verifier::verify(EC_KEY *ec_key, Byte_buffer const &digest, Byte_buffer const &sig_r, Byte_buffer const &sig_s)
+{
+    BIGNUM *r_bn = BN_new();// Freed when freeing ECDSA_SIG, so don't use unique pointer
+    bin2bn(sig_r.cdata(), sig_r.size(), r_bn);
+    BIGNUM *s_bn = BN_new();// Freed when freeing ECDSA_SIG, so don't use unique pointer
+    bin2bn(sig_s.cdata(), sig_s.size(), s_bn);
+    ECDSA_SIG *ossl_sig = ECDSA_SIG_new();
+    ECDSA_SIG_set0(ossl_sig, r_bn, s_bn);
+
+    int ret = ECDSA_do_verify(digest.cdata(), static_cast<int>(digest.size()), ossl_sig, ec_key);
+    ECDSA_SIG_free(ossl_sig);
+    if (ret < 0) {
+        throw(Openssl_error("ECDSA_do_verify failed"));
+    }
+
+    return ret == 1;
+}
+
+bool P256_verifier::verify(G1_point const &public_key, Byte_buffer const &digest, Byte_buffer const &sig_r, Byte_buffer const &sig_s) const
+{
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    Ec_key_ptr ec_key = this->public_key(public_key, ctx.get());
+
+    return verify(ec_key.get(), digest, sig_r, sig_s);
+}
+
+std::vector<bool> P256_verifier::verify(std::vector<Ecdsa_verify_item> const &items) const
+{
+    std::vector<bool> results(items.size(), false);
+    Bn_ctx_ptr ctx = new_bn_ctx();
+    Ec_key_ptr ec_key(nullptr, ::EC_KEY_free);
+    G1_point const *current_key = nullptr;
+    for (size_t i = 0; i < items.size(); ++i) {
+        Ecdsa_verify_item const &item = items[i];
+        if (current_key == nullptr || *current_key != item.public_key) {
+            current_key = &item.public_key;
+            try {
+                ec_key = public_key(item.public_key, ctx.get());
+            } catch (Openssl_error const &) {
+                ec_key.reset();
+            }
+        }
+        if (ec_key) {
+            results[i] = verify(ec_key.get(), item.digest, item.sig_r, item.sig_s);
+        }
+    }
+
+    return results;
+}
+
+P256_verifier const &get_p256_verifier()
+{
+    static const P256_verifier verifier;
+    return verifier;
+}
+
+bool p256_verify_ecdsa_signature(
+G1_point const& ecdsa_public_key,
+Byte_buffer const& digest_to_sign,
+Byte_buffer const& sigR,
+Byte_buffer const& sigS
+)
+{
+    return get_p256_verifier().verify(ecdsa_public_key, digest_to_sign, sigR, sigS);
+}
@@ -0,0 +1,197 @@
+/*******************************************************************************
+* File:        Timer_wheel.cpp
+* Description: Hierarchical hashed timer wheel
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#include "Timer_wheel.h"
+
+void Timer_wheel::Timer::cancel()
+{
+    if (wheel_ != nullptr) {
+        unlink(*this);
+        --wheel_->size_;
+        wheel_ = nullptr;
+    }
+}
+
+Timer_wheel::Timer_wheel(std::chrono::milliseconds tick, Clock::time_point start) : tick_(tick), start_(start), now_(start)
+{
+}
+
+Timer_wheel::~Timer_wheel()
+{
+    for (auto &level : slots_) {
+        for (auto &slot : level) {
+            while (slot != nullptr) {
+                slot->cancel();
+            }
+        }
+    }
+}
+
+uint64_t Timer_wheel::to_tick(Clock::time_point when) const
+{
+    if (when <= start_) {
+        return 0;
+    }
+    // Round up, so a timer never fires early
+    return static_cast<uint64_t>((when - start_ + tick_ - Clock::duration(1)) / tick_);
+}
+
+void Timer_wheel::link(Slot &slot, Timer &timer)
+{
+    timer.next_ = slot;
+    if (slot != nullptr) {
+        slot->pprev_ = &timer.next_;
+    }
+    slot = &timer;
+    timer.pprev_ = &slot;
+}
+
+void Timer_wheel::unlink(Timer &timer)
+{
+    *timer.pprev_ = timer.next_;
+    if (timer.next_ != nullptr) {
+        timer.next_->pprev_ = timer.pprev_;
+    }
+    timer.next_ = nullptr;
+    timer.pprev_ = nullptr;
+}
+
+void Timer_wheel::insert(Timer &timer)
+{
+    uint64_t expiry = timer.expiry_;
+    if (expiry < current_) {
+        // Already due, fire it on the next tick
+        link(slots_[0][current_ & slot_mask], timer);
+        return;
+    }
+    uint64_t delta = expiry - current_;
+    if (delta > max_delta) {
+        // Beyond the top level, it is moved down until it is in range
+        expiry = current_ + max_delta;
+        delta = max_delta;
+    }
+    std::size_t level = 0;
+    while (delta >= (uint64_t{ 1 } << (level_bits * (level + 1)))) {
+        ++level;
+    }
+    link(slots_[level][(expiry >> (level_bits * level)) & slot_mask], timer);
+}
+
+void Timer_wheel::arm_at(Timer &timer, Clock::time_point when)
+{
+    timer.cancel();
+    timer.expiry_ = to_tick(when);
+    timer.wheel_ = this;
+    ++size_;
+    insert(timer);
+}
+
+void Timer_wheel::cascade(std::size_t level)
+{
+    Slot &slot = slots_[level][(current_ >> (level_bits * level)) & slot_mask];
+    Slot timers = slot;
+    slot = nullptr;
+    if (timers != nullptr) {
+        timers->pprev_ = &timers;
+    }
+    while (timers != nullptr) {
+        Timer &timer = *timers;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+std::size_t Timer_wheel::advance(Clock::time_point now)
+{
+    if (now <= now_) {
+        return 0;
+    }
+    now_ = now;
+    // The last tick that has started
+    uint64_t last = static_cast<uint64_t>((now - start_) / tick_);
+    std::size_t fired = 0;
+    while (current_ <= last) {
+        if (size_ == 0) {
+            current_ = last + 1;
+            break;
+        }
+        // At the end of each round of a level move the timers in the next slot of the level above down
+        for (std::size_t level = 1; level < level_count && ((current_ >> (level_bits * (level - 1))) & slot_mask) == 0; ++level) {
+            cascade(level);
+        }
+        Slot &slot = slots_[0][current_ & slot_mask];
+        Slot timers = slot;
+        slot = nullptr;
+        if (timers != nullptr) {
+            timers->pprev_ = &timers;
+        }
+        // Timers armed by the callbacks go in the following ticks' slots
+        uint64_t tick = current_++;
+        while (timers != nullptr) {
+            Timer &timer = *timers;
+            unlink(timer);
+            if (timer.expiry_ > tick) {
+                // Placed at the top level, and not due yet
+                insert(timer);
+                continue;
+            }
+            timer.wheel_ = nullptr;
+            --size_;
+            ++fired;
+            timer.callback_();
+        }
+    }
+    return fired;
+}
+
+std::optional<Timer_wheel::Clock::time_point> Timer_wheel::next_expiry() const
+{
+    if (size_ == 0) {
+        return std::nullopt;
+    }
+    uint64_t tick = current_;
+    do {
+        if (slots_[0][tick & slot_mask] != nullptr) {
+            return to_time(tick);
+        }
+        ++tick;
+    } while ((tick & slot_mask) != 0);
+    // Only timers on the upper levels, the next of them can be moved down at the end of this round
+    return to_time(tick);
+}
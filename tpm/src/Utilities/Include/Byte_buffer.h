@@ -43,6 +43,7 @@
 #include <string>
 #include <vector>
 #include "Hex_string.h"
+#include "Hex_literal.h"
 
 using Byte = unsigned char;
 using Byte_ptr = Byte *;
@@ -66,6 +67,8 @@ class Byte_buffer
     explicit Byte_buffer(Hex_string const &hs);// Every two hex characters are one Byte
     explicit Byte_buffer(std::string const &str);// Each character is one Byte
     Byte_buffer(Byte const *buf, size_t len);
+    template<size_t N>
+    explicit Byte_buffer(Byte_block<N> const &block) : byte_buf_(block.begin(), block.end()) {}
     Byte &operator[](size_t pos) { return byte_buf_[pos]; }
     Byte const &operator[](size_t pos) const { return byte_buf_[pos]; }
     Byte_buffer get_part(size_t start, size_t length) const;
@@ -72,6 +72,25 @@ using F_timer_mu=Timer<std::chrono::steady_clock,F_microseconds>;
 using F_milliseconds=std::chrono::duration<float,std::milli>;
 using F_timer_ms=Timer<std::chrono::steady_clock,F_milliseconds>;
 
+// The CPU time used by the calling thread, so a timer can separate the host's
+// work from the time spent waiting for a device
+struct Thread_cpu_clock
+{
+    using duration=std::chrono::nanoseconds;
+    using rep=duration::rep;
+    using period=duration::period;
+    using time_point=std::chrono::time_point<Thread_cpu_clock>;
+    static constexpr bool is_steady=true;
+    static time_point now() noexcept;
+};
+
+// A microsecond thread CPU timer returning a float
+using F_cpu_timer_mu=Timer<Thread_cpu_clock,F_microseconds>;
+
+// The clock for timeouts and timers (CLOCK_MONOTONIC), changes to the system
+// time do not affect it
+using Monotonic_clock=std::chrono::steady_clock;
+
 template<typename Rep>
 class Timing_data
 {
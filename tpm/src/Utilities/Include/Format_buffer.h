@@ -0,0 +1,188 @@
+/*******************************************************************************
+* File:        Format_buffer.h
+* Description: Formatting for vars_to_string without an ostringstream
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+class Byte_buffer;
+
+/**
+ * Builds a string without an ostringstream, so no locale or stream state is
+ * set up. The characters go into a buffer on the stack and only move to the
+ * heap if they do not fit. Integers are written in decimal, or in hex after
+ * std::hex, as an ostream would write them.
+ */
+class Format_buffer
+{
+  public:
+    static constexpr std::size_t inline_size = 256;
+
+    Format_buffer() = default;
+    Format_buffer(Format_buffer const &) = delete;
+    Format_buffer &operator=(Format_buffer const &) = delete;
+    ~Format_buffer() = default;
+
+    void append(char const *s, std::size_t n);
+    void append(char c)
+    {
+        if (size_ == capacity_) {
+            grow(1);
+        }
+        data_[size_++] = c;
+    }
+    // In decimal, or in hex when hex() is set
+    void append_unsigned(uint64_t value);
+    void append_signed(int64_t value);
+    // Two lower case hex digits per byte
+    void append_hex_bytes(unsigned char const *bytes, std::size_t n);
+    // As an ostream with its default precision, i.e. %g
+    void append_double(double value);
+
+    void set_hex(bool hex) { hex_ = hex; }
+    bool hex() const { return hex_; }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+    std::string str() const { return std::string(data_, size_); }
+
+  private:
+    char inline_[inline_size];
+    char *data_{ inline_ };
+    std::size_t size_{ 0 };
+    std::size_t capacity_{ inline_size };
+    std::unique_ptr<char[]> heap_;
+    bool hex_{ false };
+
+    void grow(std::size_t extra);
+};
+
+using Ios_manipulator = std::ios_base &(*)(std::ios_base &);
+
+// The types Format_buffer writes itself, anything else is written with its operator<<
+template<typename T>
+constexpr bool is_fast_format()
+{
+    using U = std::remove_cv_t<std::decay_t<T>>;
+    return (std::is_integral<U>::value && !std::is_same<U, wchar_t>::value && !std::is_same<U, char16_t>::value
+             && !std::is_same<U, char32_t>::value)
+           || std::is_same<U, float>::value || std::is_same<U, double>::value || std::is_same<U, char const *>::value
+           || std::is_same<U, char *>::value || std::is_same<U, std::string>::value
+           || std::is_same<U, std::string_view>::value || std::is_same<U, Byte_buffer>::value
+           || std::is_same<U, Ios_manipulator>::value;
+}
+
+// Only std::hex and std::dec are followed, any other manipulator needs an ostream
+template<typename T>
+bool is_fast_manipulator(T const &)
+{
+    return true;
+}
+
+inline bool is_fast_manipulator(Ios_manipulator m)
+{
+    return m == std::hex || m == std::dec;
+}
+
+inline void format_value(Format_buffer &buf, char const *s)
+{
+    buf.append(s, std::char_traits<char>::length(s));
+}
+
+inline void format_value(Format_buffer &buf, std::string const &s)
+{
+    buf.append(s.data(), s.size());
+}
+
+inline void format_value(Format_buffer &buf, std::string_view s)
+{
+    buf.append(s.data(), s.size());
+}
+
+// An ostream writes the character types as characters, and bool as 1 or 0
+inline void format_value(Format_buffer &buf, char c)
+{
+    buf.append(c);
+}
+
+inline void format_value(Format_buffer &buf, signed char c)
+{
+    buf.append(static_cast<char>(c));
+}
+
+inline void format_value(Format_buffer &buf, unsigned char c)
+{
+    buf.append(static_cast<char>(c));
+}
+
+inline void format_value(Format_buffer &buf, bool b)
+{
+    buf.append(b ? '1' : '0');
+}
+
+// In hex an ostream writes a negative number as its unsigned equivalent
+template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+void format_value(Format_buffer &buf, T value)
+{
+    if constexpr (std::is_signed<T>::value) {
+        if (!buf.hex()) {
+            buf.append_signed(static_cast<int64_t>(value));
+            return;
+        }
+    }
+    buf.append_unsigned(static_cast<uint64_t>(static_cast<std::make_unsigned_t<T>>(value)));
+}
+
+inline void format_value(Format_buffer &buf, double value)
+{
+    buf.append_double(value);
+}
+
+inline void format_value(Format_buffer &buf, Ios_manipulator m)
+{
+    buf.set_hex(m == std::hex);
+}
+
+void format_value(Format_buffer &buf, Byte_buffer const &bb);
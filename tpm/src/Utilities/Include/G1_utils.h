@@ -50,9 +50,13 @@ const size_t g1_coord_size=component_size;
 const size_t g1_affine_point_size=2*g1_coord_size;
 // Size for uncompressed representation (uncompressed code) + x + y
 const size_t g1_uncompressed_point_size=g1_affine_point_size+1;
-// Size for compressed representation - (compressed code) + x-coord + 1
-// - check this !!!!)
-const size_t g1_compressed_point_size=g1_coord_size+2;
+// Size for compressed representation (SEC1) - (compressed code) + x-coord
+const size_t g1_compressed_point_size=g1_coord_size+1;
+
+// SEC1 point encoding codes, the compressed code also carries the parity of y
+const Byte g1_uncompressed_code=0x04;
+const Byte g1_compressed_even_code=0x02;
+const Byte g1_compressed_odd_code=0x03;
 
 using G1_point=std::pair<Byte_buffer,Byte_buffer>;
 
@@ -60,6 +64,12 @@ Byte_buffer g1_point_concat(G1_point const& pt);
 
 Byte_buffer g1_point_uncompressed(G1_point const& pt);
 
+// SEC1 compressed form, 02 or 03 (the parity of y) followed by x padded to g1_coord_size.
+// Decompression needs the curve, see ec_point_decompress in Openssl_ec_utils.h
+Byte_buffer g1_point_compressed(G1_point const& pt);
+
+bool g1_point_is_compressed(Byte_buffer const& bb);
+
 G1_point g1_point_from_bb(Byte_buffer const& bb);
 
 Byte_buffer g1_point_serialise(G1_point const& pt);
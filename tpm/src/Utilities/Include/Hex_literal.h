@@ -0,0 +1,90 @@
+/*******************************************************************************
+* File:        Hex_literal.h
+* Description: Compile-time byte constants from hex string literals
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+using Byte=unsigned char;
+
+// Fixed size byte constants for parameters and test vectors. Unlike a
+// Byte_buffer, a constexpr Byte_block is built by the compiler, so including
+// a header of parameters adds no dynamic initialisation to the library.
+//
+// constexpr Byte_block<2> x=hex_bytes("0a1B");
+//
+// An invalid hex character gives a compile error when the result is constexpr.
+
+template<std::size_t N>
+using Byte_block=std::array<Byte,N>;
+
+constexpr Byte hex_char_to_byte(char c)
+{
+    return (c>='0' && c<='9')?static_cast<Byte>(c-'0'):
+           (c>='a' && c<='f')?static_cast<Byte>(c-'a'+10):
+           (c>='A' && c<='F')?static_cast<Byte>(c-'A'+10):
+           throw std::invalid_argument("Invalid hex character");
+}
+
+// Every two hex characters are one Byte
+template<std::size_t L>
+constexpr Byte_block<(L-1)/2> hex_bytes(char const (&hex)[L])
+{
+    static_assert((L-1)%2==0,"A hex literal must have an even number of characters");
+    Byte_block<(L-1)/2> bytes{};
+    for (std::size_t i=0;i<bytes.size();++i)
+    {
+        bytes[i]=static_cast<Byte>(hex_char_to_byte(hex[2*i])*16+hex_char_to_byte(hex[2*i+1]));
+    }
+    return bytes;
+}
+
+// Each character is one Byte, the terminating null is not included
+template<std::size_t L>
+constexpr Byte_block<L-1> string_bytes(char const (&str)[L])
+{
+    Byte_block<L-1> bytes{};
+    for (std::size_t i=0;i<bytes.size();++i)
+    {
+        bytes[i]=static_cast<Byte>(str[i]);
+    }
+    return bytes;
+}
@@ -41,6 +41,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include "Format_buffer.h"
 
 // Define the appropriate directory seperators and their opposites
 #ifndef _WIN32
@@ -92,9 +93,18 @@ void print_buffer(
 // (A,B) - A is carried out first, then B. The result from B is returned
 // (os << t, 0) - writes t to the stream and returns 0 to the <int> initializer list
 // ... the parameter pack is expanded
+// Strings, numbers, Byte_buffers, std::hex and std::dec are written with a
+// Format_buffer, anything else (or another manipulator) uses an ostringstream
 template<typename... T>
 std::string vars_to_string(const T &... t)
 {
+    if constexpr ((is_fast_format<T>() && ...)) {
+        if ((is_fast_manipulator(t) && ...)) {
+            Format_buffer buf;
+            (void)std::initializer_list<int>{ (format_value(buf, t), 0)... };
+            return buf.str();
+        }
+    }
     std::ostringstream os;
     (void)std::initializer_list<int>{ (os << t, 0)... };
     return os.str();
@@ -68,3 +68,6 @@ size_t bn2bin(BIGNUM const* bn, u8_ptr& bp);
 
 Byte_buffer bn2bb(BIGNUM const* bn);
 
+// Always width bytes, with leading zeros, throws if the number is too large
+Byte_buffer bn2bb(BIGNUM const* bn, size_t width);
+
@@ -53,6 +53,9 @@ Bn_ctx_ptr new_bn_ctx();
 using Bn_ptr=std::unique_ptr<BIGNUM,decltype(&::BN_free)>;
 Bn_ptr new_bn();
 
+using Bn_mont_ctx_ptr=std::unique_ptr<BN_MONT_CTX,decltype(&::BN_MONT_CTX_free)>;
+Bn_mont_ctx_ptr new_bn_mont_ctx();
+
 Byte_buffer bb_mod(Byte_buffer const& num,Byte_buffer const& modulus);
 
 Byte_buffer bb_add(Byte_buffer const& a,Byte_buffer const& b);
@@ -68,3 +71,48 @@ Byte_buffer bb_mul(Byte_buffer const& a,Byte_buffer const& b);
 Byte_buffer bb_mod_mul(Byte_buffer const& a,Byte_buffer const& b,Byte_buffer const& n);
 
 Byte_buffer bb_signature_calc(Byte_buffer const& a,Byte_buffer const& b,Byte_buffer const& c, Byte_buffer const& modulus);
+
+/**
+ * Arithmetic modulo a fixed (odd) modulus, keeping its Montgomery context so
+ * it is only calculated once. Chained calculations can keep their operands in
+ * BIGNUMs (in Montgomery form for mont_mul) and only convert the final result.
+ * Results are returned as Byte_buffers of size() bytes, with leading zeros.
+ */
+class Bn_modulus
+{
+  public:
+    Bn_modulus() = delete;
+    explicit Bn_modulus(Byte_buffer const &n);
+    Bn_modulus(Bn_modulus const &) = delete;
+    Bn_modulus &operator=(Bn_modulus const &) = delete;
+    size_t size() const { return size_; }
+    BIGNUM const *n() const { return n_.get(); }
+    // r = a mod n, in Montgomery form
+    void to_mont(BIGNUM *r, Byte_buffer const &a, BN_CTX *ctx) const;
+    // a is in Montgomery form
+    Byte_buffer from_mont(BIGNUM const *a, BN_CTX *ctx) const;
+    // r = a*b*R^-1 mod n, so a*b in Montgomery form if both are, or a*b if only one is
+    void mont_mul(BIGNUM *r, BIGNUM const *a, BIGNUM const *b, BN_CTX *ctx) const;
+    // The operands must be reduced, either form
+    void add(BIGNUM *r, BIGNUM const *a, BIGNUM const *b) const;
+    void sub(BIGNUM *r, BIGNUM const *a, BIGNUM const *b) const;
+
+    Byte_buffer mod(Byte_buffer const &a) const;
+    Byte_buffer mod_add(Byte_buffer const &a, Byte_buffer const &b) const;
+    Byte_buffer mod_sub(Byte_buffer const &a, Byte_buffer const &b) const;
+    Byte_buffer mod_mul(Byte_buffer const &a, Byte_buffer const &b) const;
+    // a + b*c mod n
+    Byte_buffer signature_calc(Byte_buffer const &a, Byte_buffer const &b, Byte_buffer const &c) const;
+    ~Bn_modulus() = default;
+
+  private:
+    Bn_ptr n_;
+    Bn_mont_ctx_ptr mont_;
+    size_t size_;
+};
+
+// The shared group order for the curve, "prime256v1" or "bnp256"
+Bn_modulus const& get_order_modulus(std::string const& curve_name);
+
+// The shared field prime for the curve, "prime256v1" or "bnp256"
+Bn_modulus const& get_field_modulus(std::string const& curve_name);
@@ -105,3 +105,36 @@ Byte_buffer const& digest_to_sign,
 Byte_buffer const& sigR,
 Byte_buffer const& sigS
 );
+
+// Decompresses SEC1 compressed points for curves with p = 3 mod 4 (prime256v1 and
+// bnp256). The Montgomery context for p, the curve coefficients and the square
+// root exponent, (p+1)/4, are set up once so that each decompression is one
+// modular exponentiation.
+class Ec_point_decompressor
+{
+  public:
+    Ec_point_decompressor() = delete;
+    Ec_point_decompressor(Byte_buffer const &p, Byte_buffer const &a, Byte_buffer const &b, Byte_buffer const &sqrt_exp);
+    Ec_point_decompressor(Ec_point_decompressor const &) = delete;
+    Ec_point_decompressor &operator=(Ec_point_decompressor const &) = delete;
+    size_t coord_size() const { return coord_size_; }
+    G1_point decompress(Byte_buffer const &compressed) const;
+    ~Ec_point_decompressor() = default;
+
+  private:
+    Bn_ptr p_;
+    Bn_ptr a_;// Montgomery form
+    Bn_ptr b_;// Montgomery form
+    Bn_ptr sqrt_exp_;
+    Bn_mont_ctx_ptr mont_;
+    size_t coord_size_;
+};
+
+// The shared decompressor for the curve, "prime256v1" or "bnp256"
+Ec_point_decompressor const& get_ec_point_decompressor(std::string const& curve_name);
+
+// Accepts either the compressed or the uncompressed SEC1 form
+G1_point ec_point_decompress(std::string const& curve_name, Byte_buffer const& encoded_point);
+
+// General (slower) version using OpenSSL, works for any curve
+G1_point ec_point_decompress(Ec_group_ptr const& ecgrp, Byte_buffer const& encoded_point);
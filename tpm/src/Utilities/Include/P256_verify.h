@@ -0,0 +1,92 @@
+/*******************************************************************************
+* File:        P256_verify.h
+* Description: ECDSA signature verification for prime256v1 (P-256)
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+
+#pragma once
+
+#include <vector>
+#include "Byte_buffer.h"
+#include "G1_utils.h"
+#include "Openssl_ec_utils.h"
+
+struct Ecdsa_verify_item
+{
+    G1_point public_key;
+    Byte_buffer digest;
+    Byte_buffer sig_r;
+    Byte_buffer sig_s;
+};
+
+/**
+ * Verifies ECDSA signatures on prime256v1, giving the same results as
+ * verify_ecdsa_signature("prime256v1", ...), including throwing Openssl_error
+ * for a public key that is not on the curve. The group is created and checked
+ * once, rather than for each signature. OpenSSL's P-256 method does the
+ * arithmetic: fixed-size field elements, a precomputed table of multiples of
+ * the generator and u1*G + u2*Q in one pass.
+ *
+ * A batch reuses the public key while consecutive items share it.
+ */
+class P256_verifier
+{
+  public:
+    P256_verifier();
+    P256_verifier(P256_verifier const &) = delete;
+    P256_verifier &operator=(P256_verifier const &) = delete;
+    bool verify(G1_point const &public_key, Byte_buffer const &digest, Byte_buffer const &sig_r, Byte_buffer const &sig_s) const;
+    // As verify(), except a public key that is not on the curve fails its item, rather than throwing
+    std::vector<bool> verify(std::vector<Ecdsa_verify_item> const &items) const;
+    ~P256_verifier() = default;
+
+  private:
+    Ec_group_ptr ecgrp_;
+
+    Ec_key_ptr public_key(G1_point const &public_key, BN_CTX *ctx) const;
+    static bool verify(EC_KEY *ec_key, Byte_buffer const &digest, Byte_buffer const &sig_r, Byte_buffer const &sig_s);
+};
+
+// The shared verifier
+P256_verifier const& get_p256_verifier();
+
+bool p256_verify_ecdsa_signature(
+G1_point const& ecdsa_public_key,
+Byte_buffer const& digest_to_sign,
+Byte_buffer const& sigR,
+Byte_buffer const& sigS
+);
@@ -0,0 +1,134 @@
+/*******************************************************************************
+* File:        Timer_wheel.h
+* Description: Hierarchical hashed timer wheel
+*
+* Author:      Chris Newton
+*
+* Created:     Sunday 18 October 2026
+*
+*
+*******************************************************************************/
+
+/*******************************************************************************
+*                                                                              *
+* (C) Copyright 2020-2021 University of Surrey                                 *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+* 1. Redistributions of source code must retain the above copyright notice,    *
+* this list of conditions and the following disclaimer.                        *
+*                                                                              *
+* 2. Redistributions in binary form must reproduce the above copyright notice, *
+* this list of conditions and the following disclaimer in the documentation    *
+* and/or other materials provided with the distribution.                       *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"  *
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE    *
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE   *
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE    *
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR          *
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF         *
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS     *
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN      *
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)      *
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE   *
+* POSSIBILITY OF SUCH DAMAGE.                                                  *
+*                                                                              *
+*******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include "Clock_utils.h"
+
+/**
+ * A hierarchical hashed timer wheel (Varghese and Lauck) on the monotonic clock. Arming and cancelling
+ * a timer are O(1), and a timer is an intrusive list node, so arming it allocates nothing. The wheel has
+ * four levels of 64 slots, with 1 ms ticks timers up to about 4.6 hours away are placed directly, later
+ * ones are placed at the top level and moved down again as they get closer.
+ *
+ * Not thread safe, the wheel and its timers belong to one thread, e.g. the thread running an event loop
+ * that calls advance() when next_expiry() is reached.
+ */
+class Timer_wheel
+{
+  public:
+    using Clock = Monotonic_clock;
+
+    class Timer
+    {
+      public:
+        using Callback = std::function<void()>;
+        explicit Timer(Callback callback) : callback_(std::move(callback)) {}
+        Timer(Timer const &) = delete;
+        Timer &operator=(Timer const &) = delete;
+        ~Timer() { cancel(); }
+        bool armed() const { return wheel_ != nullptr; }
+        void cancel();
+
+      private:
+        friend class Timer_wheel;
+        Callback callback_;
+        Timer_wheel *wheel_{ nullptr };
+        Timer *next_{ nullptr };
+        Timer **pprev_{ nullptr };
+        uint64_t expiry_{ 0 };
+    };
+
+    explicit Timer_wheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1), Clock::time_point start = Clock::now());
+    Timer_wheel(Timer_wheel const &) = delete;
+    Timer_wheel &operator=(Timer_wheel const &) = delete;
+    ~Timer_wheel();
+
+    /**
+	 * Arms, or re-arms, the timer to fire once the time has passed. Timers never fire early, but can fire up
+	 * to a tick late.
+	 */
+    void arm_at(Timer &timer, Clock::time_point when);
+    void arm(Timer &timer, Clock::duration after) { arm_at(timer, Clock::now() + after); }
+    void cancel(Timer &timer) { timer.cancel(); }
+
+    /**
+	 * Fires the timers that have expired by now, in order of expiry tick. The callbacks can arm and cancel
+	 * timers. Returns the number fired.
+	 */
+    std::size_t advance(Clock::time_point now);
+
+    /**
+	 * When advance() next needs to be called, empty if no timer is armed. It may be earlier than the first
+	 * expiry, when the timers are on the upper levels, in which case advance() fires nothing.
+	 */
+    std::optional<Clock::time_point> next_expiry() const;
+
+    std::size_t size() const { return size_; }
+
+  private:
+    static constexpr unsigned level_bits = 6;
+    static constexpr std::size_t slot_count = 1u << level_bits;
+    static constexpr uint64_t slot_mask = slot_count - 1;
+    static constexpr std::size_t level_count = 4;
+    static constexpr uint64_t max_delta = (uint64_t{ 1 } << (level_bits * level_count)) - 1;
+
+    using Slot = Timer *;
+
+    Clock::duration tick_;
+    Clock::time_point start_;
+    // The last time given to advance()
+    Clock::time_point now_;
+    // The next tick to process
+    uint64_t current_{ 0 };
+    std::size_t size_{ 0 };
+    std::array<std::array<Slot, slot_count>, level_count> slots_{};
+
+    uint64_t to_tick(Clock::time_point when) const;
+    Clock::time_point to_time(uint64_t tick) const { return start_ + tick_ * tick; }
+    void insert(Timer &timer);
+    static void link(Slot &slot, Timer &timer);
+    static void unlink(Timer &timer);
+    void cascade(std::size_t level);
+};
@@ -39,7 +39,7 @@
 
 #pragma once
 
-#include "Byte_buffer.h"
+#include "Hex_literal.h"
 
 /* Extracted from Mechanism 4:
 t=
@@ -64,19 +64,20 @@ P1 = TPM(gX,gY) = generator
 
 const size_t component_size=32;
 
-const Hex_string hex_bnp256_p("FFFFFFFFFFFCF0CD46E5F25EEE71A49F0CDC65FB12980A82D3292DDBAED33013");
-const Byte_buffer bnp256_p(hex_bnp256_p);
+constexpr auto bnp256_p=hex_bytes("FFFFFFFFFFFCF0CD46E5F25EEE71A49F0CDC65FB12980A82D3292DDBAED33013");
 
-const Byte_buffer bnp256_a{0x00};
+constexpr Byte_block<1> bnp256_a{0x00};
 
-const Byte_buffer bnp256_b{0x03};
+constexpr Byte_block<1> bnp256_b{0x03};
 
-const Byte_buffer bnp256_gX{0x01};
+constexpr Byte_block<1> bnp256_gX{0x01};
 
-const Byte_buffer bnp256_gY{0x02};
+constexpr Byte_block<1> bnp256_gY{0x02};
 
-const Hex_string hex_bnp256_order("FFFFFFFFFFFCF0CD46E5F25EEE71A49E0CDC65FB1299921AF62D536CD10B500D");
-const Byte_buffer bnp256_order(hex_bnp256_order);
+constexpr auto bnp256_order=hex_bytes("FFFFFFFFFFFCF0CD46E5F25EEE71A49E0CDC65FB1299921AF62D536CD10B500D");
+
+// bnp256_p = 3 mod 4, so a square root of c is c^((bnp256_p+1)/4) mod bnp256_p
+constexpr auto bnp256_sqrt_exp=hex_bytes("3FFFFFFFFFFF3C3351B97C97BB9C6927C337197EC4A602A0B4CA4B76EBB4CC05");
 
 //static unsigned char ec_cofactor_256[] = {
 //	0x01
@@ -92,12 +93,9 @@ B1A886C3 3E5443AF 1499EF32 F0CB5186 B7F25E52 FBA05426 CFD590B1 974143DF
 
 */
 
-const Hex_string hex_iso_test_sk("05E8D2E3F942A58F652CE4B72836BB0123AF440FE74004CC0E0F37F559BAC367");
-const Byte_buffer iso_test_sk(hex_iso_test_sk);
+constexpr auto iso_test_sk=hex_bytes("05E8D2E3F942A58F652CE4B72836BB0123AF440FE74004CC0E0F37F559BAC367");
 
-const Hex_string hex_iso_test_pk_x("2F858C217C1F2818F1912A72208524628AE6FC5349A97D82D6ACB646AD3A4284");
-const Byte_buffer iso_test_pk_x(hex_iso_test_pk_x);
+constexpr auto iso_test_pk_x=hex_bytes("2F858C217C1F2818F1912A72208524628AE6FC5349A97D82D6ACB646AD3A4284");
 
-const Hex_string hex_iso_test_pk_y("B1A886C33E5443AF1499EF32F0CB5186B7F25E52FBA05426CFD590B1974143DF");
-const Byte_buffer iso_test_pk_y(hex_iso_test_pk_y);
+constexpr auto iso_test_pk_y=hex_bytes("B1A886C33E5443AF1499EF32F0CB5186B7F25E52FBA05426CFD590B1974143DF");
 
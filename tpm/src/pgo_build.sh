@@ -0,0 +1,48 @@
+#!/bin/bash
+#
+# Profile guided optimisation build of libwatpm.
+#
+#   1. build the release preset and benchmark it to get the baseline
+#   2. build the instrumented pgo-generate preset and train it by running the
+#      benchmark
+#   3. rebuild, in the same build directory, with the pgo-use preset and
+#      benchmark it against the baseline
+#
+# The final library is written to ../lib, the benchmark finds the library it
+# was built with through its build RPATH. The TPM simulator must be running
+# and the environment set up as described in ../README.md.
+#
+# Usage: ./pgo_build.sh <data directory> [<iterations>]
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <data directory> [<iterations>]"
+    exit 1
+fi
+
+data_dir=$1
+iterations=${2:-50}
+src_dir=$(cd "$(dirname "$0")" && pwd)
+cd "$src_dir"
+
+mkdir -p "$data_dir"
+results_dir=Build/pgo-results
+mkdir -p $results_dir
+
+echo "*** Release build (baseline)"
+cmake --preset release
+cmake --build --preset release -j"$(nproc)"
+Build/release/bin/bench_wa_tpm "$data_dir" "$iterations" $results_dir/release.txt
+
+echo "*** Instrumented build and training"
+rm -rf Build/pgo/pgo-profile
+cmake --preset pgo-generate
+cmake --build --preset pgo-generate -j"$(nproc)"
+Build/pgo/bin/bench_wa_tpm "$data_dir" "$iterations"
+
+echo "*** PGO build"
+# WATPM_LIBRARY_DIR is cached from the pgo-generate configuration
+cmake --preset pgo-use -DWATPM_LIBRARY_DIR="$src_dir/../lib"
+cmake --build --preset pgo-use -j"$(nproc)"
+Build/pgo/bin/bench_wa_tpm "$data_dir" "$iterations" $results_dir/pgo.txt $results_dir/release.txt
@@ -0,0 +1,45 @@
+#!/bin/bash
+#
+# Concurrency stress test of libwatpm under the sanitizers.
+#
+#   1. build the tsan preset and run stress_wa_tpm under ThreadSanitizer
+#   2. build the asan preset and run it under AddressSanitizer, with the leak
+#      and undefined behaviour checks
+#
+# Each instance needs its own simulator, as the simulator serves one
+# connection at a time: instance i uses the simulator started with
+# "tpm_server -port <first port + 2i>", run from its own directory. The
+# environment must be set up as described in ../README.md.
+#
+# Usage: ./stress_wa_tpm.sh <data directory> [<seconds> [<instances> [<threads per instance> [<first port>]]]]
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <data directory> [<seconds> [<instances> [<threads per instance> [<first port>]]]]"
+    exit 1
+fi
+
+data_dir=$1
+seconds=${2:-60}
+instances=${3:-2}
+threads=${4:-4}
+first_port=${5:-2321}
+src_dir=$(cd "$(dirname "$0")" && pwd)
+cd "$src_dir"
+
+mkdir -p "$data_dir"
+status=0
+
+for preset in tsan asan; do
+    echo "*** $preset build"
+    cmake --preset $preset
+    cmake --build --preset $preset -j"$(nproc)" --target stress_wa_tpm
+    # Keep going after a finding, so both builds are run
+    TSAN_OPTIONS="second_deadlock_stack=1 $TSAN_OPTIONS" \
+    ASAN_OPTIONS="detect_leaks=1 $ASAN_OPTIONS" \
+    UBSAN_OPTIONS="print_stacktrace=1 $UBSAN_OPTIONS" \
+        Build/$preset/bin/stress_wa_tpm "$data_dir" "$seconds" "$instances" "$threads" "$first_port" || status=1
+done
+
+exit $status